@@ -0,0 +1,289 @@
+#include "base64.h"
+#include <algorithm>
+#include <stdint.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#define BASE64_X86 1
+#endif
+
+/**
+ * @brief base64 alphabet
+ */
+static const char ENCODE_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * @brief marker for characters outside the base64 alphabet
+ */
+static const uint8_t INVALID = 0xff;
+
+/**
+ * @brief build the table mapping characters to 6-bit values
+ */
+static std::vector<uint8_t> make_decode_table( void )
+{
+    std::vector<uint8_t> table( 256, INVALID );
+
+    for ( uint8_t i = 0 ; i < 64 ; ++i ) {
+        table[static_cast<unsigned char>( ENCODE_TABLE[i] )] = i;
+    }
+
+    return table;
+}
+
+/**
+ * @brief table mapping characters to 6-bit values
+ */
+static const std::vector<uint8_t> DECODE_TABLE = make_decode_table();
+
+/**
+ * @brief portable encoder working on 3 byte groups
+ */
+static void encode_scalar( char* out, unsigned char const* in, size_t len )
+{
+    size_t i = 0;
+
+    // encode complete groups
+    for ( ; i + 3 <= len ; i += 3 ) {
+        const uint32_t v = ( uint32_t{ in[i] } << 16 ) | ( uint32_t{ in[i + 1] } << 8 ) | in[i + 2];
+        *out++ = ENCODE_TABLE[( v >> 18 ) & 0x3f];
+        *out++ = ENCODE_TABLE[( v >> 12 ) & 0x3f];
+        *out++ = ENCODE_TABLE[( v >> 6 ) & 0x3f];
+        *out++ = ENCODE_TABLE[v & 0x3f];
+    }
+
+    // encode the final partial group with padding
+    if ( i < len ) {
+        const uint32_t v = ( uint32_t{ in[i] } << 16 ) | ( i + 1 < len ? uint32_t{ in[i + 1] } << 8 : 0 );
+        *out++ = ENCODE_TABLE[( v >> 18 ) & 0x3f];
+        *out++ = ENCODE_TABLE[( v >> 12 ) & 0x3f];
+        *out++ = i + 1 < len ? ENCODE_TABLE[( v >> 6 ) & 0x3f] : '=';
+        *out++ = '=';
+    }
+}
+
+/**
+ * @brief portable decoder working on 4 character groups
+ */
+static bool decode_scalar( unsigned char* out, size_t& out_len, char const* in, size_t len )
+{
+    out_len = 0;
+
+    if ( len % 4 != 0 ) {
+        return false;
+    }
+
+    for ( size_t i = 0 ; i < len ; i += 4 ) {
+
+        // only the last group may carry padding
+        const bool last = i + 4 == len;
+        const size_t padding = last ? ( in[i + 3] == '=' ) + ( in[i + 3] == '=' && in[i + 2] == '=' ) : 0;
+
+        const uint8_t a = DECODE_TABLE[static_cast<unsigned char>( in[i] )];
+        const uint8_t b = DECODE_TABLE[static_cast<unsigned char>( in[i + 1] )];
+        const uint8_t c = padding >= 2 ? 0 : DECODE_TABLE[static_cast<unsigned char>( in[i + 2] )];
+        const uint8_t d = padding >= 1 ? 0 : DECODE_TABLE[static_cast<unsigned char>( in[i + 3] )];
+
+        if ( a == INVALID || b == INVALID || c == INVALID || d == INVALID ) {
+            return false;
+        }
+
+        const uint32_t v = ( uint32_t{ a } << 18 ) | ( uint32_t{ b } << 12 ) | ( uint32_t{ c } << 6 ) | d;
+        out[out_len++] = static_cast<unsigned char>( v >> 16 );
+
+        if ( padding < 2 ) {
+            out[out_len++] = static_cast<unsigned char>( v >> 8 );
+        }
+
+        if ( padding < 1 ) {
+            out[out_len++] = static_cast<unsigned char>( v );
+        }
+    }
+
+    return true;
+}
+
+#ifdef BASE64_X86
+
+/**
+ * @brief avx2 encoder converting 24 input bytes to 32 characters per iteration
+ *
+ * Uses the multiply based bit unpacking and lookup based translation described by Mula and Lemire.
+ */
+__attribute__(( target( "avx2" ) ))
+static void encode_avx2( char* out, unsigned char const* in, size_t len )
+{
+    // spread each 3 byte group of a lane over 4 bytes
+    const __m256i shuffle = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 );
+
+    // offsets from 6-bit values to their characters
+    const __m256i offsets = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0 );
+
+    size_t i = 0;
+
+    // each iteration reads 28 bytes so the final groups are left to the scalar encoder
+    for ( ; i + 28 <= len ; i += 24, out += 32 ) {
+
+        // load 12 bytes into each lane
+        const __m128i lo = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + i ) );
+        const __m128i hi = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + i + 12 ) );
+        const __m256i v = _mm256_shuffle_epi8( _mm256_inserti128_si256( _mm256_castsi128_si256( lo ), hi, 1 ), shuffle );
+
+        // move each 6-bit field into its own byte
+        const __m256i t0 = _mm256_mulhi_epu16( _mm256_and_si256( v, _mm256_set1_epi32( 0x0fc0fc00 ) ), _mm256_set1_epi32( 0x04000040 ) );
+        const __m256i t1 = _mm256_mullo_epi16( _mm256_and_si256( v, _mm256_set1_epi32( 0x003f03f0 ) ), _mm256_set1_epi32( 0x01000010 ) );
+        const __m256i indices = _mm256_or_si256( t0, t1 );
+
+        // select the offset for each value's range of the alphabet
+        __m256i range = _mm256_subs_epu8( indices, _mm256_set1_epi8( 51 ) );
+        range = _mm256_sub_epi8( range, _mm256_cmpgt_epi8( indices, _mm256_set1_epi8( 25 ) ) );
+
+        const __m256i chars = _mm256_add_epi8( indices, _mm256_shuffle_epi8( offsets, range ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out ), chars );
+    }
+
+    encode_scalar( out, in + i, len - i );
+}
+
+/**
+ * @brief avx2 decoder converting 32 characters to 24 output bytes per iteration
+ *
+ * Blocks containing padding or characters outside the alphabet are left to the scalar decoder.
+ */
+__attribute__(( target( "avx2" ) ))
+static bool decode_avx2( unsigned char* out, size_t& out_len, char const* in, size_t len )
+{
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a );
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+    const __m256i pack = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+    const __m256i mask_2f = _mm256_set1_epi8( 0x2f );
+
+    if ( len % 4 != 0 ) {
+        out_len = 0;
+        return false;
+    }
+
+    size_t i = 0;
+    size_t o = 0;
+
+    // each iteration stores 32 bytes, so stop while the output still has room for the overrun
+    for ( ; i + 44 <= len ; i += 32, o += 24 ) {
+
+        const __m256i str = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( in + i ) );
+
+        // classify each character by its nibbles
+        const __m256i hi_nibbles = _mm256_and_si256( _mm256_srli_epi32( str, 4 ), mask_2f );
+        const __m256i lo_nibbles = _mm256_and_si256( str, mask_2f );
+        const __m256i lo = _mm256_shuffle_epi8( lut_lo, lo_nibbles );
+        const __m256i hi = _mm256_shuffle_epi8( lut_hi, hi_nibbles );
+
+        // hand blocks with invalid characters or padding to the scalar decoder
+        if ( !_mm256_testz_si256( lo, hi ) ) {
+            break;
+        }
+
+        // translate characters to 6-bit values
+        const __m256i eq_2f = _mm256_cmpeq_epi8( str, mask_2f );
+        const __m256i roll = _mm256_shuffle_epi8( lut_roll, _mm256_add_epi8( eq_2f, hi_nibbles ) );
+        const __m256i values = _mm256_add_epi8( str, roll );
+
+        // pack 4 6-bit values into 3 bytes
+        const __m256i merged = _mm256_maddubs_epi16( values, _mm256_set1_epi32( 0x01400140 ) );
+        const __m256i packed = _mm256_shuffle_epi8( _mm256_madd_epi16( merged, _mm256_set1_epi32( 0x00011000 ) ), pack );
+        const __m256i bytes = _mm256_permutevar8x32_epi32( packed, _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, -1, -1 ) );
+
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + o ), bytes );
+    }
+
+    // decode the remaining characters
+    size_t tail_len = 0;
+    const bool status = decode_scalar( out + o, tail_len, in + i, len - i );
+    out_len = o + tail_len;
+
+    return status;
+}
+
+#endif // BASE64_X86
+
+std::vector<base64_codec> supported_base64_codecs( void )
+{
+    std::vector<base64_codec> codecs{ { "scalar", encode_scalar, decode_scalar } };
+
+#ifdef BASE64_X86
+    // query cpuid for the instruction set extensions the codecs depend on
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "avx2" ) ) {
+        codecs.push_back( { "avx2", encode_avx2, decode_avx2 } );
+    }
+#endif
+
+    return codecs;
+}
+
+/**
+ * @brief get the fastest codec supported by the cpu
+ */
+static base64_codec const& fastest_codec( void )
+{
+    static const base64_codec codec = supported_base64_codecs().back();
+    return codec;
+}
+
+size_t base64_encoded_size( size_t len )
+{
+    return ( len + 2 ) / 3 * 4;
+}
+
+std::string base64_encode( unsigned char const* data, size_t len )
+{
+    std::string text( base64_encoded_size( len ), '\0' );
+
+    fastest_codec().encode( &text[0], data, len );
+
+    return text;
+}
+
+std::pair<bool, std::vector<unsigned char>> base64_decode( char const* text, size_t len )
+{
+    auto is_space = []( char c ) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; };
+
+    // armored files usually differ from bare base64 only by a trailing line break
+    while ( len > 0 && is_space( text[len - 1] ) ) {
+        --len;
+    }
+
+    // remove any whitespace within the text
+    std::string compact;
+
+    if ( std::find_if( text, text + len, is_space ) != text + len ) {
+        compact.reserve( len );
+        std::remove_copy_if( text, text + len, std::back_inserter( compact ), is_space );
+        text = compact.data();
+        len = compact.size();
+    }
+
+    std::vector<unsigned char> data( len / 4 * 3 );
+    size_t data_len = 0;
+
+    if ( !fastest_codec().decode( data.data(), data_len, text, len ) ) {
+        return std::make_pair( false, std::vector<unsigned char>{} );
+    }
+
+    data.resize( data_len );
+
+    return std::make_pair( true, std::move( data ) );
+}
@@ -0,0 +1,78 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <stddef.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief encode kernel signature
+ *
+ * @param out output characters; must hold base64_encoded_size( len ) characters
+ * @param in input bytes
+ * @param len number of input bytes
+ */
+using base64_encode_fn = void (*)( char* out, unsigned char const* in, size_t len );
+
+/**
+ * @brief decode kernel signature
+ *
+ * @param out output bytes; must hold len / 4 * 3 bytes
+ * @param out_len set to the number of bytes decoded
+ * @param in input characters without whitespace
+ * @param len number of input characters; must be a multiple of 4
+ *
+ * @return true if the input is valid base64; false otherwise;
+ */
+using base64_decode_fn = bool (*)( unsigned char* out, size_t& out_len, char const* in, size_t len );
+
+/**
+ * @brief named base64 codec implementation
+ */
+struct base64_codec
+{
+    char const* name;
+    base64_encode_fn encode;
+    base64_decode_fn decode;
+};
+
+/**
+ * @brief get the number of characters needed to encode data
+ *
+ * @param len number of input bytes
+ *
+ * @return number of base64 characters including padding
+ */
+size_t base64_encoded_size( size_t len );
+
+/**
+ * @brief base64 encode an array of bytes using the fastest codec supported by the cpu
+ *
+ * @param data input bytes
+ * @param len number of input bytes
+ *
+ * @return base64 encoded output string
+ */
+std::string base64_encode( unsigned char const* data, size_t len );
+
+/**
+ * @brief base64 decode text using the fastest codec supported by the cpu
+ *
+ * Whitespace such as line breaks is ignored.
+ *
+ * @param text input characters
+ * @param len number of input characters
+ *
+ * @return true and decoded bytes if successful; false otherwise;
+ */
+std::pair<bool, std::vector<unsigned char>> base64_decode( char const* text, size_t len );
+
+/**
+ * @brief get the base64 codecs that the cpu is able to run
+ *
+ * @return vector of codecs ordered from slowest to fastest
+ */
+std::vector<base64_codec> supported_base64_codecs( void );
+
+#endif // BASE64_H
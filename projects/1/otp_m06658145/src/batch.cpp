@@ -0,0 +1,223 @@
+#include "batch.h"
+#include "file_io.h"
+#include "pad_ledger.h"
+#include "stream_xor.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Define constants for manifest entry operations
+enum class BATCH_OP {
+    KEY,
+    PAD_ENCRYPT,
+    PAD_DECRYPT
+};
+
+/**
+ * @brief one manifest entry and the outcome of processing it
+ */
+struct batch_entry
+{
+    BATCH_OP op;
+    std::string key_path;
+    std::string input_path;
+    std::string output_path;
+    bool status;
+    uint64_t bytes;
+    double seconds;
+};
+
+/**
+ * @brief read and validate the entries of a manifest
+ *
+ * @param manifest_path path of the manifest file
+ * @param use_pad true if entries refer to a shared pad
+ *
+ * @return true and entries if successful; false otherwise;
+ */
+static std::pair<bool, std::vector<batch_entry>> read_manifest( const char* manifest_path, bool use_pad )
+{
+    std::vector<batch_entry> entries;
+
+    // open the manifest
+    std::ifstream is( manifest_path );
+
+    if ( !is.is_open() ) {
+        std::cerr << "ERROR: failed to open file '" << manifest_path << "'\n";
+        return std::make_pair( false, entries );
+    }
+
+    std::string line;
+
+    for ( unsigned int line_number = 1 ; std::getline( is, line ) ; ++line_number ) {
+
+        // split the line into whitespace separated fields
+        std::istringstream fields( line );
+        std::string first;
+        batch_entry entry{ BATCH_OP::KEY, "", "", "", false, 0, 0 };
+
+        // skip blank lines and comments
+        if ( !( fields >> first ) || first[0] == '#' ) {
+            continue;
+        }
+
+        if ( use_pad ) {
+            if ( first == "enc" ) {
+                entry.op = BATCH_OP::PAD_ENCRYPT;
+            } else if ( first == "dec" ) {
+                entry.op = BATCH_OP::PAD_DECRYPT;
+            } else {
+                std::cerr << "ERROR: " << manifest_path << ":" << line_number << ": expected 'enc' or 'dec'\n";
+                return std::make_pair( false, entries );
+            }
+        } else {
+            entry.key_path = first;
+        }
+
+        std::string extra;
+
+        // verify the entry has exactly an input and an output path
+        if ( !( fields >> entry.input_path >> entry.output_path ) || ( fields >> extra ) ) {
+            std::cerr << "ERROR: " << manifest_path << ":" << line_number << ": invalid entry\n";
+            return std::make_pair( false, entries );
+        }
+
+        entries.push_back( std::move( entry ) );
+    }
+
+    return std::make_pair( true, std::move( entries ) );
+}
+
+/**
+ * @brief process a single manifest entry
+ *
+ * @param entry entry to process; its outcome fields are updated
+ * @param pad_path path of the shared pad file, if any
+ * @param buffer scratch memory reused across entries
+ */
+static void process_entry( batch_entry& entry, const char* pad_path, std::vector<unsigned char>& buffer )
+{
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // get the size of the input for the summary
+    const auto input_size = get_file_size( entry.input_path.c_str() );
+
+    entry.status = input_size.first;
+    entry.bytes = input_size.second;
+
+    if ( entry.status ) {
+        switch ( entry.op ) {
+
+            case BATCH_OP::KEY: {
+
+                // verify sizes of input and key match
+                const auto key_size = get_file_size( entry.key_path.c_str() );
+
+                if ( !key_size.first ) {
+                    entry.status = false;
+                } else if ( key_size.second != input_size.second ) {
+                    std::cerr << "ERROR: input and key file sizes do not match ( "
+                        << input_size.second << " != " << key_size.second << " ) for '" << entry.input_path << "'\n";
+                    entry.status = false;
+                } else {
+                    entry.status = stream_xor_file(
+                        entry.key_path.c_str(), entry.input_path.c_str(), entry.output_path.c_str(), buffer );
+                }
+
+                break;
+            }
+
+            case BATCH_OP::PAD_ENCRYPT:
+                entry.status = pad_encrypt_file( pad_path, entry.input_path.c_str(), entry.output_path.c_str(), buffer );
+                break;
+
+            case BATCH_OP::PAD_DECRYPT:
+                entry.status = pad_decrypt_file( pad_path, entry.input_path.c_str(), entry.output_path.c_str(), buffer );
+                break;
+        }
+    }
+
+    const auto end_time = std::chrono::steady_clock::now();
+
+    entry.seconds = std::chrono::duration<double>( end_time - start_time ).count();
+}
+
+int run_batch( const char* manifest_path, const char* pad_path, unsigned int threads )
+{
+    // read the manifest
+    auto manifest = read_manifest( manifest_path, pad_path != nullptr );
+
+    if ( !manifest.first ) {
+        return EXIT_FAILURE;
+    }
+
+    auto& entries = manifest.second;
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // hand out entries to the worker pool in manifest order
+    std::atomic<size_t> next{ 0 };
+    std::vector<std::thread> pool;
+
+    for ( unsigned int i = 0 ; i < threads && i < entries.size() ; ++i ) {
+        pool.emplace_back( [&]() {
+
+            // one buffer per worker reused for every entry it processes
+            std::vector<unsigned char> buffer;
+
+            for ( size_t index = next++ ; index < entries.size() ; index = next++ ) {
+                process_entry( entries[index], pad_path, buffer );
+            }
+        } );
+    }
+
+    for ( auto& worker : pool ) {
+        worker.join();
+    }
+
+    const auto end_time = std::chrono::steady_clock::now();
+
+    // print the per-file summary
+    const double mb = 1024.0 * 1024.0;
+    uint64_t total_bytes = 0;
+    size_t failures = 0;
+
+    std::cout << " status |      size (MB) |  time (ms) | throughput (MB/s) | file\n";
+    std::cout << " ------ | -------------- | ---------- | ----------------- | ----\n";
+
+    for ( const auto& entry : entries ) {
+
+        std::cout << " " << std::setw( 6 ) << ( entry.status ? "ok" : "FAILED" )
+            << " | " << std::setw( 14 ) << std::fixed << std::setprecision( 3 ) << entry.bytes / mb
+            << " | " << std::setw( 10 ) << entry.seconds * 1e3
+            << " | " << std::setw( 17 ) << ( entry.seconds > 0 ? entry.bytes / mb / entry.seconds : 0 )
+            << " | " << entry.input_path << " -> " << entry.output_path << "\n";
+
+        if ( entry.status ) {
+            total_bytes += entry.bytes;
+        } else {
+            ++failures;
+        }
+    }
+
+    // print the aggregate summary
+    const double seconds = std::chrono::duration<double>( end_time - start_time ).count();
+
+    std::cout << "\n";
+    std::cout << "batch summary\n";
+    std::cout << " files      = " << entries.size() << " (" << failures << " failed)\n";
+    std::cout << " threads    = " << threads << "\n";
+    std::cout << " total size = " << std::setprecision( 3 ) << total_bytes / mb << " MB\n";
+    std::cout << " total time = " << seconds * 1e3 << " ms\n";
+    std::cout << " throughput = " << ( seconds > 0 ? total_bytes / mb / seconds : 0 ) << " MB/s\n";
+    std::cout << " file rate  = " << ( seconds > 0 ? entries.size() / seconds : 0 ) << " files/s\n";
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,23 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/**
+ * @brief encrypt or decrypt every file listed in a manifest within one process
+ *
+ * Each non-empty manifest line not starting with '#' is an entry. Without a pad an entry is
+ * "<key_file_path> <input_file_path> <output_file_path>". With a pad an entry is
+ * "enc <plaintext_file_path> <ciphertext_file_path>" or "dec <ciphertext_file_path> <plaintext_file_path>";
+ * enc reserves the next unused slice of the pad and dec uses the slice recorded in the ciphertext header.
+ *
+ * Entries are processed by a pool of worker threads that each reuse one chunk buffer. A per-file
+ * and aggregate throughput summary is printed to stdout.
+ *
+ * @param manifest_path path of the manifest file
+ * @param pad_path path of the pad file; nullptr when entries name their own key files
+ * @param threads number of worker threads
+ *
+ * @return EXIT_SUCCESS if every entry succeeded; EXIT_FAILURE otherwise;
+ */
+int run_batch( const char* manifest_path, const char* pad_path, unsigned int threads );
+
+#endif // BATCH_H
@@ -0,0 +1,186 @@
+#include "file_io.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool is_standard_stream( const char* path )
+{
+    return strcmp( path, STANDARD_STREAM_PATH ) == 0;
+}
+
+std::pair<bool, uint64_t> get_file_size( const char* path )
+{
+    struct stat st;
+
+    if ( is_standard_stream( path ) ) {
+
+        // only a regular file redirected to standard input has a known size
+        const off_t position = lseek( STDIN_FILENO, 0, SEEK_CUR );
+
+        if ( fstat( STDIN_FILENO, &st ) != 0 || !S_ISREG( st.st_mode ) || position < 0 ) {
+            std::cerr << "ERROR: the size of standard input is not known\n";
+            return std::make_pair( false, uint64_t{ 0 } );
+        }
+
+        return std::make_pair( true, static_cast<uint64_t>( std::max<off_t>( 0, st.st_size - position ) ) );
+    }
+
+    // query the file size from the file system
+    if ( stat( path, &st ) != 0 ) {
+        std::cerr << "ERROR: failed to stat file '" << path << "' (" << strerror( errno ) << ")\n";
+        return std::make_pair( false, uint64_t{ 0 } );
+    }
+
+    return std::make_pair( true, static_cast<uint64_t>( st.st_size ) );
+}
+
+int open_input_file( const char* path )
+{
+    // a duplicate of standard input can be closed like any other descriptor
+    const int fd = is_standard_stream( path ) ?
+        fcntl( STDIN_FILENO, F_DUPFD_CLOEXEC, 0 ) :
+        open( path, O_RDONLY | O_CLOEXEC );
+
+    // verify file was opened successfully
+    if ( fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << path << "'\n";
+    }
+
+    return fd;
+}
+
+int open_output_file( const char* path )
+{
+    // a duplicate of standard output can be closed like any other descriptor
+    const int fd = is_standard_stream( path ) ?
+        fcntl( STDOUT_FILENO, F_DUPFD_CLOEXEC, 0 ) :
+        open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+
+    // verify file was opened successfully
+    if ( fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << path << "'\n";
+    }
+
+    return fd;
+}
+
+int open_in_place_file( const char* path )
+{
+    const int fd = open( path, O_RDWR | O_CLOEXEC );
+
+    // verify file was opened successfully
+    if ( fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << path << "'\n";
+    }
+
+    return fd;
+}
+
+bool is_same_file( const char* first_path, const char* second_path )
+{
+    struct stat first;
+    struct stat second;
+
+    // standard input is compared by the file it was redirected from
+    auto get_status = []( const char* path, struct stat& st ) {
+        return is_standard_stream( path ) ? fstat( STDIN_FILENO, &st ) == 0 : stat( path, &st ) == 0;
+    };
+
+    return get_status( first_path, first ) && get_status( second_path, second ) &&
+        first.st_dev == second.st_dev && first.st_ino == second.st_ino;
+}
+
+std::pair<bool, size_t> read_fully( int fd, unsigned char* data, size_t len )
+{
+    size_t total = 0;
+
+    // short reads are expected on pipes and near the end of the file
+    while ( total < len ) {
+        const ssize_t count = read( fd, data + total, len - total );
+
+        if ( count < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return std::make_pair( false, total );
+        }
+
+        // stop at the end of the file
+        if ( count == 0 ) {
+            break;
+        }
+
+        total += count;
+    }
+
+    return std::make_pair( true, total );
+}
+
+bool write_fully( int fd, unsigned char const* data, size_t len )
+{
+    size_t total = 0;
+
+    while ( total < len ) {
+        const ssize_t count = write( fd, data + total, len - total );
+
+        if ( count < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+
+        total += count;
+    }
+
+    return true;
+}
+
+std::pair<bool, size_t> pread_fully( int fd, unsigned char* data, size_t len, uint64_t offset )
+{
+    size_t total = 0;
+
+    while ( total < len ) {
+        const ssize_t count = pread( fd, data + total, len - total, offset + total );
+
+        if ( count < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return std::make_pair( false, total );
+        }
+
+        // stop at the end of the file
+        if ( count == 0 ) {
+            break;
+        }
+
+        total += count;
+    }
+
+    return std::make_pair( true, total );
+}
+
+bool pwrite_fully( int fd, unsigned char const* data, size_t len, uint64_t offset )
+{
+    size_t total = 0;
+
+    while ( total < len ) {
+        const ssize_t count = pwrite( fd, data + total, len - total, offset + total );
+
+        if ( count < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+
+        total += count;
+    }
+
+    return true;
+}
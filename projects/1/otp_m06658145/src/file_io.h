@@ -0,0 +1,117 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+/**
+ * @brief path naming standard input when reading or standard output when writing
+ */
+constexpr const char* STANDARD_STREAM_PATH = "-";
+
+/**
+ * @brief check whether a path names standard input or standard output
+ *
+ * @param path path given on the command line
+ *
+ * @return true if the path is STANDARD_STREAM_PATH; false otherwise;
+ */
+bool is_standard_stream( const char* path );
+
+/**
+ * @brief get the size of a file without reading it
+ *
+ * For STANDARD_STREAM_PATH this is the number of bytes left on standard input,
+ * which is only known when standard input is a regular file.
+ *
+ * @param path path of the file
+ *
+ * @return true and size of the file in bytes if successful; false otherwise;
+ */
+std::pair<bool, uint64_t> get_file_size( const char* path );
+
+/**
+ * @brief open a file for reading
+ *
+ * @param path path of the file; STANDARD_STREAM_PATH duplicates standard input
+ *
+ * @return file descriptor if successful; -1 otherwise;
+ */
+int open_input_file( const char* path );
+
+/**
+ * @brief create or truncate a file for writing
+ *
+ * @param path path of the file; STANDARD_STREAM_PATH duplicates standard output
+ *
+ * @return file descriptor if successful; -1 otherwise;
+ */
+int open_output_file( const char* path );
+
+/**
+ * @brief open an existing file for reading and writing without truncating it
+ *
+ * @param path path of the file
+ *
+ * @return file descriptor if successful; -1 otherwise;
+ */
+int open_in_place_file( const char* path );
+
+/**
+ * @brief check whether two paths name the same existing file
+ *
+ * @param first_path path of a file; STANDARD_STREAM_PATH names standard input
+ * @param second_path path of a file; STANDARD_STREAM_PATH names standard input
+ *
+ * @return true if both paths refer to the same device and inode; false otherwise;
+ */
+bool is_same_file( const char* first_path, const char* second_path );
+
+/**
+ * @brief read from a file descriptor until the buffer is full or end of file is reached
+ *
+ * @param fd file descriptor to read from
+ * @param data buffer to read into
+ * @param len size of the buffer in bytes
+ *
+ * @return true and number of bytes read if successful; false otherwise;
+ */
+std::pair<bool, size_t> read_fully( int fd, unsigned char* data, size_t len );
+
+/**
+ * @brief write an entire buffer to a file descriptor
+ *
+ * @param fd file descriptor to write to
+ * @param data buffer to be written
+ * @param len size of the buffer in bytes
+ *
+ * @return true if successful; false otherwise;
+ */
+bool write_fully( int fd, unsigned char const* data, size_t len );
+
+/**
+ * @brief read from a file descriptor at an offset until the buffer is full or end of file is reached
+ *
+ * @param fd file descriptor to read from
+ * @param data buffer to read into
+ * @param len size of the buffer in bytes
+ * @param offset file offset of the first byte to read
+ *
+ * @return true and number of bytes read if successful; false otherwise;
+ */
+std::pair<bool, size_t> pread_fully( int fd, unsigned char* data, size_t len, uint64_t offset );
+
+/**
+ * @brief write an entire buffer to a file descriptor at an offset
+ *
+ * @param fd file descriptor to write to
+ * @param data buffer to be written
+ * @param len size of the buffer in bytes
+ * @param offset file offset of the first byte to write
+ *
+ * @return true if successful; false otherwise;
+ */
+bool pwrite_fully( int fd, unsigned char const* data, size_t len, uint64_t offset );
+
+#endif // FILE_IO_H
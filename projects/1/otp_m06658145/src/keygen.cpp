@@ -1,21 +1,266 @@
 #include "keygen.h"
-#include <random>
-#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+
+namespace
+{
+
+/**
+ * @brief number of bytes generated from one seed before a fresh seed is drawn from the kernel
+ */
+constexpr uint64_t RESEED_INTERVAL = uint64_t{ 1 } << 30;
+
+/**
+ * @brief size of a chacha20 block in bytes
+ */
+constexpr size_t BLOCK_SIZE = 64;
+
+/**
+ * @brief chacha20 based deterministic random bit generator state
+ */
+struct drbg_state
+{
+    uint32_t key[8];
+    uint64_t counter;
+    uint64_t generated;
+    unsigned int fork_generation;
+    bool seeded;
+};
+
+/**
+ * @brief incremented in the child after every fork so inherited generator states are reseeded
+ */
+std::atomic<unsigned int> fork_generation{ 0 };
+
+/**
+ * @brief fork handler run in the child process
+ */
+void on_fork_child( void )
+{
+    ++fork_generation;
+}
+
+/**
+ * @brief register the fork handler once per process
+ *
+ * @return always true
+ */
+bool register_fork_handler( void )
+{
+    pthread_atfork( nullptr, nullptr, on_fork_child );
+    return true;
+}
+
+/**
+ * @brief one generator per thread so no locking is needed
+ */
+thread_local drbg_state drbg = {};
+
+inline uint32_t rotl32( uint32_t v, int c )
+{
+    return ( v << c ) | ( v >> ( 32 - c ) );
+}
+
+#define CHACHA_QUARTER_ROUND( a, b, c, d ) \
+    a += b; d ^= a; d = rotl32( d, 16 ); \
+    c += d; b ^= c; b = rotl32( b, 12 ); \
+    a += b; d ^= a; d = rotl32( d, 8 );  \
+    c += d; b ^= c; b = rotl32( b, 7 );
+
+/**
+ * @brief compute one chacha20 block for the current key and counter
+ *
+ * @param state generator state
+ * @param out 64 byte output block
+ */
+void chacha20_block( drbg_state const& state, unsigned char* out )
+{
+    uint32_t const input[16] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        state.key[0], state.key[1], state.key[2], state.key[3],
+        state.key[4], state.key[5], state.key[6], state.key[7],
+        static_cast<uint32_t>( state.counter ), static_cast<uint32_t>( state.counter >> 32 ), 0, 0
+    };
+
+    uint32_t x[16];
+    memcpy( x, input, sizeof( x ) );
+
+    // 20 rounds as 10 column and diagonal round pairs
+    for ( int i = 0 ; i < 10 ; ++i ) {
+        CHACHA_QUARTER_ROUND( x[0], x[4], x[8],  x[12] )
+        CHACHA_QUARTER_ROUND( x[1], x[5], x[9],  x[13] )
+        CHACHA_QUARTER_ROUND( x[2], x[6], x[10], x[14] )
+        CHACHA_QUARTER_ROUND( x[3], x[7], x[11], x[15] )
+        CHACHA_QUARTER_ROUND( x[0], x[5], x[10], x[15] )
+        CHACHA_QUARTER_ROUND( x[1], x[6], x[11], x[12] )
+        CHACHA_QUARTER_ROUND( x[2], x[7], x[8],  x[13] )
+        CHACHA_QUARTER_ROUND( x[3], x[4], x[9],  x[14] )
+    }
+
+    for ( int i = 0 ; i < 16 ; ++i ) {
+        x[i] += input[i];
+    }
+
+    memcpy( out, x, BLOCK_SIZE );
+}
+
+/**
+ * @brief four 32-bit lanes processed together; maps onto a single simd register
+ */
+typedef uint32_t lanes4 __attribute__(( vector_size( 16 ) ));
+
+/**
+ * @brief compute four consecutive chacha20 blocks for the current key and counter
+ *
+ * Each lane of the working state holds one block so the rounds run on simd registers.
+ *
+ * @param state generator state
+ * @param out 256 byte output
+ */
+void chacha20_block4( drbg_state const& state, unsigned char* out )
+{
+    lanes4 input[16];
+
+    for ( int i = 0 ; i < 4 ; ++i ) {
+        input[i] = lanes4{} + ( i == 0 ? 0x61707865u : i == 1 ? 0x3320646eu : i == 2 ? 0x79622d32u : 0x6b206574u );
+    }
+
+    for ( int i = 0 ; i < 8 ; ++i ) {
+        input[4 + i] = lanes4{} + state.key[i];
+    }
+
+    // give each lane its own block counter
+    const uint64_t c = state.counter;
+    input[12] = lanes4{ static_cast<uint32_t>( c ), static_cast<uint32_t>( c + 1 ), static_cast<uint32_t>( c + 2 ), static_cast<uint32_t>( c + 3 ) };
+    input[13] = lanes4{ static_cast<uint32_t>( c >> 32 ), static_cast<uint32_t>( ( c + 1 ) >> 32 ), static_cast<uint32_t>( ( c + 2 ) >> 32 ), static_cast<uint32_t>( ( c + 3 ) >> 32 ) };
+    input[14] = lanes4{};
+    input[15] = lanes4{};
+
+    lanes4 x[16];
+
+    for ( int i = 0 ; i < 16 ; ++i ) {
+        x[i] = input[i];
+    }
+
+    auto rotl = []( lanes4 v, int n ) { return ( v << n ) | ( v >> ( 32 - n ) ); };
+
+    // 20 rounds as 10 column and diagonal round pairs
+    for ( int i = 0 ; i < 10 ; ++i ) {
+        for ( int j = 0 ; j < 8 ; ++j ) {
+            static const int q[8][4] = {
+                { 0, 4, 8, 12 }, { 1, 5, 9, 13 }, { 2, 6, 10, 14 }, { 3, 7, 11, 15 },
+                { 0, 5, 10, 15 }, { 1, 6, 11, 12 }, { 2, 7, 8, 13 }, { 3, 4, 9, 14 }
+            };
+            lanes4& a = x[q[j][0]];
+            lanes4& b = x[q[j][1]];
+            lanes4& c4 = x[q[j][2]];
+            lanes4& d = x[q[j][3]];
+            a += b; d ^= a; d = rotl( d, 16 );
+            c4 += d; b ^= c4; b = rotl( b, 12 );
+            a += b; d ^= a; d = rotl( d, 8 );
+            c4 += d; b ^= c4; b = rotl( b, 7 );
+        }
+    }
+
+    // add the input and store each lane as its own block
+    for ( int i = 0 ; i < 16 ; ++i ) {
+        const lanes4 v = x[i] + input[i];
+        for ( int lane = 0 ; lane < 4 ; ++lane ) {
+            const uint32_t word = v[lane];
+            memcpy( out + lane * BLOCK_SIZE + i * 4, &word, sizeof( word ) );
+        }
+    }
+}
+
+#undef CHACHA_QUARTER_ROUND
+
+/**
+ * @brief draw a fresh generator key from the kernel
+ *
+ * @param state generator state
+ */
+void reseed( drbg_state& state )
+{
+    unsigned char* const seed = reinterpret_cast<unsigned char*>( state.key );
+    size_t filled = 0;
+
+    // getrandom may return fewer bytes than requested if interrupted
+    while ( filled < sizeof( state.key ) ) {
+        const ssize_t count = getrandom( seed + filled, sizeof( state.key ) - filled, 0 );
+
+        if ( count < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            abort();
+        }
+
+        filled += count;
+    }
+
+    state.counter = 0;
+    state.generated = 0;
+    state.fork_generation = fork_generation;
+    state.seeded = true;
+}
+
+} /* namespace */
+
+void keygen( unsigned char* data, size_t size )
+{
+    static const bool fork_handler_registered = register_fork_handler();
+    (void) fork_handler_registered;
+
+    // seed on first use, periodically, and in a child process after fork
+    if ( !drbg.seeded || drbg.generated >= RESEED_INTERVAL || drbg.fork_generation != fork_generation ) {
+        reseed( drbg );
+    }
+
+    unsigned char block[BLOCK_SIZE];
+
+    size_t offset = 0;
+
+    // expand the key directly into the output four blocks at a time
+    for ( ; offset + 4 * BLOCK_SIZE <= size ; offset += 4 * BLOCK_SIZE ) {
+        chacha20_block4( drbg, data + offset );
+        drbg.counter += 4;
+    }
+
+    // expand the key directly into the output one block at a time
+    for ( ; offset + BLOCK_SIZE <= size ; offset += BLOCK_SIZE ) {
+        chacha20_block( drbg, data + offset );
+        ++drbg.counter;
+    }
+
+    // copy the part of a block needed for the end of the output
+    if ( offset < size ) {
+        chacha20_block( drbg, block );
+        memcpy( data + offset, block, size - offset );
+        ++drbg.counter;
+    }
+
+    // replace the key with fresh output so earlier output cannot be reconstructed
+    chacha20_block( drbg, block );
+    memcpy( drbg.key, block, sizeof( drbg.key ) );
+    drbg.counter = 0;
+    drbg.generated += size;
+
+    // clear key material from the stack
+    explicit_bzero( block, sizeof( block ) );
+}
 
 std::vector<unsigned char> keygen( unsigned int size )
 {
     // allocate memory for key data
     std::vector<unsigned char> key_data( size );
 
-    // get a random data source device
-    std::random_device rd;
-
-    // specify distribution to be used
-    std::uniform_int_distribution<unsigned char> dist;
-
-    // create the random key using the random source device and distribution
-    std::generate( key_data.begin(), key_data.end(), [&](){ return dist( rd ); } );
+    // fill the key with random data
+    keygen( key_data.data(), key_data.size() );
 
     return key_data;
 }
-
@@ -1,6 +1,7 @@
 #ifndef KEYGEN_H
 #define KEYGEN_H
 
+#include <stddef.h>
 #include <vector>
 
 /**
@@ -12,4 +13,16 @@
  */
 std::vector<unsigned char> keygen( unsigned int size );
 
+/**
+ * @brief fill a buffer with random key data
+ *
+ * Bytes come from a per-thread ChaCha20 generator seeded from the kernel with getrandom(). The
+ * generator reseeds periodically and after a fork, and rekeys itself after every call so earlier
+ * output cannot be recovered from its state.
+ *
+ * @param data buffer to be filled
+ * @param size size of the buffer in bytes
+ */
+void keygen( unsigned char* data, size_t size );
+
 #endif // KEYGEN_H
@@ -1,14 +1,22 @@
 #include <algorithm>
 #include <boost/algorithm/string.hpp>
-#include <boost/archive/iterators/base64_from_binary.hpp>
-#include <boost/archive/iterators/transform_width.hpp>
 #include <boost/lexical_cast.hpp>
-#include <fstream>
 #include <iostream>
 #include <stdlib.h>
 #include <string>
+#include <thread>
+#include <unistd.h>
 #include <vector>
+#include "base64.h"
+#include "batch.h"
+#include "file_io.h"
 #include "keygen.h"
+#include "mmap_xor.h"
+#include "pad_ledger.h"
+#include "parallel_xor.h"
+#include "stream_xor.h"
+#include "uring_xor.h"
+#include "xor_kernel.h"
 
 // Define parameters
 namespace PARAM
@@ -21,11 +29,39 @@ namespace OP
 static const constexpr char* ENCRYPT = "enc";
 static const constexpr char* DECRYPT = "dec";
 static const constexpr char* KEYGEN  = "keygen";
+static const constexpr char* PADGEN  = "padgen";
+static const constexpr char* BATCH   = "batch";
 
 } /* namespace OP */
 
+// Define supported options
+namespace OPT
+{
+
+static const constexpr char* STREAM  = "--stream";
+static const constexpr char* MMAP    = "--mmap";
+static const constexpr char* PAD     = "--pad";
+static const constexpr char* BASE64  = "--base64";
+static const constexpr char* URING   = "--uring";
+static const constexpr char* THREADS = "-j";
+
+} /* namespace OPT */
+
 } /* namespace PARAM */
 
+/**
+ * @brief options accepted by the enc and dec operations
+ */
+struct xor_options
+{
+    bool stream = false;
+    bool mmap = false;
+    bool pad = false;
+    bool base64 = false;
+    bool uring = false;
+    unsigned int threads = 0;
+};
+
 /**
  * @brief Print the help text for the program
  *
@@ -40,9 +76,32 @@ static void print_help( const char* const exe )
 
     std::cerr << "Synopsis:\n";
     std::cerr << "\t" << exe << " (-h|--help)\n";
-    std::cerr << "\t" << exe << " enc <key_file_path> <plaintext_file_path> <ciphertext_file_path>\n";
-    std::cerr << "\t" << exe << " dec <key_file_path> <ciphertext_file_path> <plaintext_file_path>\n";
-    std::cerr << "\t" << exe << " keygen <key_size> <key_file_path>\n";
+    std::cerr << "\t" << exe << " enc [options] <key_file_path> <plaintext_file_path> <ciphertext_file_path>\n";
+    std::cerr << "\t" << exe << " dec [options] <key_file_path> <ciphertext_file_path> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " keygen [--base64] <key_size> <key_file_path>\n";
+    std::cerr << "\t" << exe << " padgen [-j <n>] <pad_size_bytes> <pad_file_path>\n";
+    std::cerr << "\t" << exe << " batch [-j <n>] [--pad <pad_file_path>] <manifest_file_path>\n";
+    std::cerr << "\n";
+
+    std::cerr << "Options:\n";
+    std::cerr << "\t--stream  process the files in fixed-size chunks using constant memory\n";
+    std::cerr << "\t--mmap    combine memory mappings of the files without intermediate copies\n";
+    std::cerr << "\t-j <n>    process aligned ranges of the files on n worker threads\n";
+    std::cerr << "\t--pad     treat the key file as a pad from padgen; enc consumes the next unused\n";
+    std::cerr << "\t          slice of the pad and dec uses the slice recorded in the ciphertext header\n";
+    std::cerr << "\t--base64  read and write the key and ciphertext files as base64 text\n";
+    std::cerr << "\t--uring   keep several chunk reads and writes in flight with io_uring\n";
+    std::cerr << "\n";
+
+    std::cerr << "Standard streams:\n";
+    std::cerr << "\tan input path of - reads standard input and an output path of - writes standard output;\n";
+    std::cerr << "\tthe data is streamed, and spliced into an output pipe; the key is always read from a file\n";
+    std::cerr << "\n";
+
+    std::cerr << "Batch manifest entries, one per line:\n";
+    std::cerr << "\t<key_file_path> <input_file_path> <output_file_path>\n";
+    std::cerr << "\tenc <plaintext_file_path> <ciphertext_file_path>    (with --pad)\n";
+    std::cerr << "\tdec <ciphertext_file_path> <plaintext_file_path>    (with --pad)\n";
 }
 
 /**
@@ -56,25 +115,25 @@ static void print_help( const char* const exe )
 static bool write_file ( const char* path, std::vector<unsigned char> const& data )
 {
     // open file
-    std::basic_ofstream<unsigned char> os( path, std::ofstream::out | std::ofstream::binary );
+    const int fd = open_output_file( path );
 
     // verify file was opened successfully
-    if ( !os.is_open() ) {
-        std::cerr << "ERROR: failed to open file '" << path << "'\n";
+    if ( fd < 0 ) {
         return false;
     }
 
     // write to file
-    os.write( data.data(), data.size() );
-
-    // verify write was successful
-    if ( !os ) {
+    if ( !write_fully( fd, data.data(), data.size() ) ) {
         std::cerr << "ERROR: failed to write to file '" << path << "'\n";
+        close( fd );
         return false;
     }
 
-    // close the file
-    os.close();
+    // close the file and verify no deferred write error occurred
+    if ( close( fd ) != 0 ) {
+        std::cerr << "ERROR: failed to write to file '" << path << "'\n";
+        return false;
+    }
 
     return true;
 }
@@ -88,198 +147,385 @@ static bool write_file ( const char* path, std::vector<unsigned char> const& dat
  */
 static std::pair<bool, std::vector<unsigned char>> read_file ( const char* path )
 {
+    // get size of file
+    const auto file_size = get_file_size( path );
+
+    if ( !file_size.first ) {
+        return std::make_pair( false, std::vector<unsigned char>{} );
+    }
+
     // open file
-    std::basic_ifstream<unsigned char> is( path, std::ifstream::in | std::ifstream::binary );
+    const int fd = open_input_file( path );
 
     // verify file was opened successfully
-    if ( !is.is_open() ) {
-        std::cerr << "ERROR: failed to open file '" << path << "'\n";
+    if ( fd < 0 ) {
         return std::make_pair( false, std::vector<unsigned char>{} );
     }
 
-    // get size of file
-    is.seekg( 0, is.end );
-    const size_t file_size = is.tellg();
-    is.seekg( 0, is.beg );
-
     // read from file
-    std::vector<unsigned char> data( file_size );
-    is.read( data.data(), file_size );
+    std::vector<unsigned char> data( file_size.second );
+    const auto read_result = read_fully( fd, data.data(), data.size() );
+
+    // close the file
+    close( fd );
 
     // verify read was successful
-    if ( !is ) {
+    if ( !read_result.first || read_result.second != data.size() ) {
         std::cerr << "ERROR: failed to read from file '" << path << "'\n";
         return std::make_pair( false, std::vector<unsigned char>{} );
     }
 
-    // close the file
-    is.close();
-
     return std::make_pair( true, std::move( data ) );
 }
 
 /**
- * @brief Base64 encode an array of bytes
+ * @brief read a binary file or a base64 armored file
  *
- * @param val input bytes
+ * @param path path of file to be read
+ * @param base64 true if the file holds base64 text
  *
- * @return base64 encoded output string
+ * @return true and vector of bytes if successful; false otherwise;
  */
-static std::string encode( const std::vector<unsigned char>& val )
+static std::pair<bool, std::vector<unsigned char>> read_armored_file( const char* path, bool base64 )
 {
-    // define a base 64 iterator type
-    using b64_iterator =
-        boost::archive::iterators::base64_from_binary<
-            boost::archive::iterators::transform_width<
-                std::vector<unsigned char>::const_iterator, 6, 8>>;
+    // read the file contents
+    auto file_data = read_file( path );
+
+    if ( !file_data.first || !base64 ) {
+        return file_data;
+    }
+
+    // decode the base64 text
+    auto decoded = base64_decode( reinterpret_cast<const char*>( file_data.second.data() ), file_data.second.size() );
 
-    // create a base64 encoded string from input binary data
-    auto tmp = std::string( b64_iterator( std::begin( val ) ), b64_iterator( std::end( val ) ) );
+    if ( !decoded.first ) {
+        std::cerr << "ERROR: invalid base64 data in file '" << path << "'\n";
+    }
 
-    // append trailing equals signs for leftover bits
-    return tmp.append( ( 3 - val.size() % 3 ) % 3, '=' );
+    return decoded;
 }
 
-int main( int argc, const char* argv[] )
+/**
+ * @brief write an array of binary data to file, optionally as base64 text
+ *
+ * @param path path to file to be written to
+ * @param data array of binary data to be written
+ * @param base64 true to write the data as a line of base64 text
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool write_armored_file( const char* path, std::vector<unsigned char> const& data, bool base64 )
 {
-    // check that the operation is specified
-    if ( argc < 2 ) {
-        std::cerr << "ERROR: insufficient argument count" << std::endl;
+    if ( !base64 ) {
+        return write_file( path, data );
+    }
+
+    // encode the data followed by a line break
+    std::vector<unsigned char> text( base64_encoded_size( data.size() ) + 1 );
+    const std::string encoded = base64_encode( data.data(), data.size() );
+    std::copy( encoded.begin(), encoded.end(), text.begin() );
+    text.back() = '\n';
+
+    return write_file( path, text );
+}
+
+/**
+ * @brief convert a thread count argument from string to an unsigned integer
+ *
+ * @param value thread count in string form
+ *
+ * @return true and thread count if successful; false otherwise;
+ */
+static std::pair<bool, unsigned int> parse_thread_count( const char* value )
+{
+    unsigned int threads = 0;
+
+    try {
+        threads = boost::lexical_cast<unsigned int>( value );
+    } catch ( boost::bad_lexical_cast const& ) {
+        threads = 0;
+    }
+
+    // verify user requested thread count
+    if ( threads < 1 ) {
+        std::cerr << "ERROR: invalid thread count '" << value << "' specified" << std::endl;
+        return std::make_pair( false, threads );
+    }
+
+    return std::make_pair( true, threads );
+}
+
+/**
+ * @brief parse the options preceding the file arguments of the enc and dec operations
+ *
+ * @param argc argument count
+ * @param argv argument vector
+ * @param index index of the first option; updated to the index of the first file argument
+ *
+ * @return true and parsed options if successful; false otherwise;
+ */
+static std::pair<bool, xor_options> parse_xor_options( int argc, const char* argv[], int& index )
+{
+    xor_options options;
+
+    // a lone - is a path naming a standard stream rather than an option
+    for ( ; index < argc && argv[index][0] == '-' && !is_standard_stream( argv[index] ) ; ++index ) {
+
+        const std::string option = argv[index];
+
+        if ( option.compare( PARAM::OPT::STREAM ) == 0 ) {
+            options.stream = true;
+        } else if ( option.compare( PARAM::OPT::MMAP ) == 0 ) {
+            options.mmap = true;
+        } else if ( option.compare( PARAM::OPT::PAD ) == 0 ) {
+            options.pad = true;
+        } else if ( option.compare( PARAM::OPT::BASE64 ) == 0 ) {
+            options.base64 = true;
+        } else if ( option.compare( PARAM::OPT::URING ) == 0 ) {
+            options.uring = true;
+        } else if ( option.compare( PARAM::OPT::THREADS ) == 0 && index + 1 < argc ) {
+
+            const auto threads = parse_thread_count( argv[++index] );
+
+            if ( !threads.first ) {
+                return std::make_pair( false, options );
+            }
+
+            options.threads = threads.second;
+
+        } else {
+            std::cerr << "ERROR: unknown option '" << option << "' specified" << std::endl;
+            return std::make_pair( false, options );
+        }
+    }
+
+    return std::make_pair( true, options );
+}
+
+/**
+ * @brief combine an input file with a key file to perform encryption or decryption
+ *
+ * @param argc argument count
+ * @param argv argument vector
+ * @param encrypt true to perform encryption; false to perform decryption
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int xor_command( int argc, const char* argv[], bool encrypt )
+{
+    // get the name of the input data used in messages
+    const char* const input_name = encrypt ? "plaintext" : "ciphertext";
+
+    // parse the options following the operation
+    int index = 2;
+    const auto options = parse_xor_options( argc, argv, index );
+
+    if ( !options.first ) {
         print_help( argv[0] );
         return EXIT_FAILURE;
     }
 
-    // get the operation
-    std::string const op = argv[1];
+    // verify argument count
+    if ( argc - index != 3 ) {
+        std::cerr << "ERROR: invalid argument count" << std::endl;
+        print_help( argv[0] );
+        return EXIT_FAILURE;
+    }
 
-    if ( op.compare( "--help" ) == 0 || op.compare( "-h" ) == 0 ) {
+    // get string pointers for arguments
+    const char* const key_file = argv[index];
+    const char* const input_file = argv[index + 1];
+    const char* const output_file = argv[index + 2];
 
-        print_help( argv[0] );
+    // the key is read from a file; standard streams are only processed sequentially
+    const bool standard_streams = is_standard_stream( input_file ) || is_standard_stream( output_file );
 
-    } else if ( op.compare( PARAM::OP::DECRYPT ) == 0 ) {
+    if ( is_standard_stream( key_file ) ) {
+        std::cerr << "ERROR: the key must be read from a file" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-        // verify argument count
-        if ( argc != 5 ) {
-            std::cerr << "ERROR: invalid argument count" << std::endl;
-            print_help( argv[0] );
-            return EXIT_FAILURE;
-        }
+    if ( standard_streams && ( options.second.mmap || options.second.threads > 0 || options.second.base64 ) ) {
+        std::cerr << "ERROR: - cannot be combined with --mmap, -j, or --base64" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-        // get string pointers for arguments
-        const char* const key_file = argv[2];
-        const char* const ciphertext_file = argv[3];
-        const char* const plaintext_file = argv[4];
+    // the io_uring backend reads and writes regular files at explicit offsets on the calling thread
+    if ( options.second.uring && ( options.second.pad || options.second.mmap || options.second.threads > 0 || options.second.base64 || standard_streams ) ) {
+        std::cerr << "ERROR: --uring cannot be combined with --pad, --mmap, -j, --base64, or -" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-        // read key data from file
-        const auto key_file_data = read_file( key_file );
+    // armored data is converted in memory
+    if ( options.second.base64 && ( options.second.pad || options.second.stream || options.second.mmap || options.second.threads > 0 ) ) {
+        std::cerr << "ERROR: --base64 cannot be combined with --pad, --stream, --mmap, or -j" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if ( options.second.pad ) {
 
-        // verify read was successful
-        if ( !key_file_data.first ) {
+        // pad slices are always processed in bounded memory on the calling thread
+        if ( options.second.mmap || options.second.threads > 0 ) {
+            std::cerr << "ERROR: --pad cannot be combined with --mmap or -j" << std::endl;
             return EXIT_FAILURE;
         }
 
-        // create an alias for the key data
-        const auto& key = key_file_data.second;
+        std::vector<unsigned char> buffer;
 
-        // read ciphertext data from file
-        const auto ciphertext_file_data = read_file( ciphertext_file );
+        if ( encrypt ) {
 
-        // verify read was successful
-        if ( !ciphertext_file_data.first ) {
-            return EXIT_FAILURE;
-        }
+            // combine the plaintext with the next unused slice of the pad
+            if ( !pad_encrypt_file( key_file, input_file, output_file, buffer ) ) {
+                return EXIT_FAILURE;
+            }
 
-        // create an alias for the ciphertext data
-        const auto& ciphertext = ciphertext_file_data.second;
+        } else {
+
+            // combine the ciphertext with the pad slice recorded in its header
+            if ( !pad_decrypt_file( key_file, input_file, output_file, buffer ) ) {
+                return EXIT_FAILURE;
+            }
 
-        // verify sizes of ciphertext and key are the same
-        if ( ciphertext.size() != key.size() ) {
-            std::cerr << "ERROR: ciphertext and key file sizes do not match ( "
-                << ciphertext.size() << " != " << key.size() << " )\n";
-            return EXIT_FAILURE;
         }
 
-        // copy the ciphertext data into the plaintext array
-        std::vector<unsigned char> plaintext( ciphertext );
+        return EXIT_SUCCESS;
+    }
 
-        // combine the ciphertext with the key to perform decryption and create the plaintext
-        for ( size_t i = 0 ; i < plaintext.size() ; ++i ) {
-            plaintext[i] ^= key[i];
-        }
+    if ( options.second.stream || options.second.mmap || options.second.uring || options.second.threads > 0 || standard_streams ) {
+
+        // get the sizes of the key and input files without reading them; a piped input is checked while streaming
+        const bool sized_input = !is_standard_stream( input_file );
+        const auto key_size = get_file_size( key_file );
+        const auto input_size = sized_input ? get_file_size( input_file ) : key_size;
 
-        // write plaintext data to output file
-        if ( !write_file( plaintext_file, plaintext ) ) {
+        if ( !key_size.first || !input_size.first ) {
             return EXIT_FAILURE;
         }
 
-    } else if ( op.compare( PARAM::OP::ENCRYPT ) == 0 ) {
-
-        // verify argument count
-        if ( argc != 5 ) {
-            std::cerr << "ERROR: invalid argument count" << std::endl;
-            print_help( argv[0] );
+        // verify sizes of input and key match
+        if ( input_size.second != key_size.second ) {
+            std::cerr << "ERROR: " << input_name << " and key file sizes do not match ( "
+                << input_size.second << " != " << key_size.second << " )\n";
             return EXIT_FAILURE;
         }
 
-        // get string pointers for arguments
-        const char* const key_file = argv[2];
-        const char* const plaintext_file = argv[3];
-        const char* const ciphertext_file = argv[4];
+        if ( options.second.uring ) {
 
-        // read key data from file
-        const auto key_file_data = read_file( key_file );
+            // keep reads and writes of several chunks in flight while completed chunks are combined
+            if ( !uring_xor_file( key_file, input_file, output_file, URING_QUEUE_DEPTH ) ) {
+                return EXIT_FAILURE;
+            }
 
-        // verify read was successful
-        if ( !key_file_data.first ) {
-            return EXIT_FAILURE;
-        }
+        } else if ( options.second.mmap ) {
 
-        // create an alias for the key data
-        const auto& key = key_file_data.second;
+            // combine the mapped input with the mapped key directly into the mapped output
+            if ( !mmap_xor_file( key_file, input_file, output_file, options.second.threads ) ) {
+                return EXIT_FAILURE;
+            }
 
-        // read plaintext data from file
-        const auto plaintext_file_data = read_file( plaintext_file );
+        } else if ( options.second.threads > 0 ) {
 
-        // verify read was successful
-        if ( !plaintext_file_data.first ) {
-            return EXIT_FAILURE;
-        }
+            // combine ranges of the input with the key on worker threads
+            if ( !parallel_xor_file( key_file, input_file, output_file, options.second.threads ) ) {
+                return EXIT_FAILURE;
+            }
 
-        // create an alias for the plaintext data
-        const auto& plaintext = plaintext_file_data.second;
+        } else {
 
-        // verify sizes of plaintext and key match
-        if ( plaintext.size() != key.size() ) {
-            std::cerr << "ERROR: plaintext and key file sizes do not match ( "
-                << plaintext.size() << " != " << key.size() << " )\n";
-            return EXIT_FAILURE;
-        }
+            // combine the input with the key chunk by chunk and write the output
+            std::vector<unsigned char> buffer;
 
-        // copy the plaintext into the ciphertext
-        std::vector<unsigned char> ciphertext( plaintext );
+            if ( !stream_xor_file( key_file, input_file, output_file, buffer ) ) {
+                return EXIT_FAILURE;
+            }
 
-        // combine the plaintext with the key to create the ciphertext
-        for ( size_t i = 0 ; i < ciphertext.size() ; ++i ) {
-            ciphertext[i] ^= key[i];
         }
 
-        // write ciphertext to output file
-        if ( !write_file( ciphertext_file, ciphertext ) ) {
-            return EXIT_FAILURE;
-        }
+        return EXIT_SUCCESS;
+    }
+
+    // read key data from file
+    const auto key_file_data = read_armored_file( key_file, options.second.base64 );
+
+    // verify read was successful
+    if ( !key_file_data.first ) {
+        return EXIT_FAILURE;
+    }
+
+    // create an alias for the key data
+    const auto& key = key_file_data.second;
+
+    // read input data from file; only ciphertext is armored
+    auto input_file_data = read_armored_file( input_file, options.second.base64 && !encrypt );
+
+    // verify read was successful
+    if ( !input_file_data.first ) {
+        return EXIT_FAILURE;
+    }
+
+    // create an alias for the input data
+    auto& data = input_file_data.second;
+
+    // verify sizes of input and key match
+    if ( data.size() != key.size() ) {
+        std::cerr << "ERROR: " << input_name << " and key file sizes do not match ( "
+            << data.size() << " != " << key.size() << " )\n";
+        return EXIT_FAILURE;
+    }
+
+    // combine the input with the key in place to create the output
+    xor_bytes( data.data(), data.data(), key.data(), data.size() );
+
+    // write the output data, now held in the input buffer, to the output file; only ciphertext is armored
+    if ( !write_armored_file( output_file, data, options.second.base64 && encrypt ) ) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main( int argc, const char* argv[] )
+{
+    // check that the operation is specified
+    if ( argc < 2 ) {
+        std::cerr << "ERROR: insufficient argument count" << std::endl;
+        print_help( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    // get the operation
+    std::string const op = argv[1];
+
+    if ( op.compare( "--help" ) == 0 || op.compare( "-h" ) == 0 ) {
+
+        print_help( argv[0] );
+
+    } else if ( op.compare( PARAM::OP::DECRYPT ) == 0 ) {
+
+        // combine the ciphertext with the key to perform decryption and create the plaintext
+        return xor_command( argc, argv, false );
+
+    } else if ( op.compare( PARAM::OP::ENCRYPT ) == 0 ) {
+
+        // combine the plaintext with the key to create the ciphertext
+        return xor_command( argc, argv, true );
 
     } else if ( op.compare( PARAM::OP::KEYGEN ) == 0 ) {
 
+        // check whether the key file should be armored
+        const bool base64 = argc > 2 && std::string( argv[2] ).compare( PARAM::OPT::BASE64 ) == 0;
+        const int index = base64 ? 3 : 2;
+
         // verify argument count
-        if ( argc != 4 ) {
+        if ( argc - index != 2 ) {
             std::cerr << "ERROR: invalid argument count" << std::endl;
             print_help( argv[0] );
             return EXIT_FAILURE;
         }
 
         // get string pointers for arguments
-        const char* const key_size = argv[2];
-        const char* const key_file = argv[3];
+        const char* const key_size = argv[index];
+        const char* const key_file = argv[index + 1];
 
         // convert argument from string to an unsigned integer
         const unsigned int key_size_int = boost::lexical_cast<unsigned int>( key_size );
@@ -297,13 +543,102 @@ int main( int argc, const char* argv[] )
         const auto key_data { keygen( key_bytes ) };
 
         // convert binary key data to base64 and print to the terminal
-        std::cout << "key = " << encode( key_data ) << "\n";
+        std::cout << "key = " << base64_encode( key_data.data(), key_data.size() ) << "\n";
 
         // write key data to output file
-        if ( !write_file( key_file, key_data ) ) {
+        if ( !write_armored_file( key_file, key_data, base64 ) ) {
+            return EXIT_FAILURE;
+        }
+
+    } else if ( op.compare( PARAM::OP::PADGEN ) == 0 ) {
+
+        // get the generator thread count; defaults to one thread per core
+        int index = 2;
+        unsigned int threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+        if ( argc > index + 1 && std::string( argv[index] ).compare( PARAM::OPT::THREADS ) == 0 ) {
+
+            const auto thread_count = parse_thread_count( argv[index + 1] );
+
+            if ( !thread_count.first ) {
+                return EXIT_FAILURE;
+            }
+
+            threads = thread_count.second;
+            index += 2;
+        }
+
+        // verify argument count
+        if ( argc - index != 2 ) {
+            std::cerr << "ERROR: invalid argument count" << std::endl;
+            print_help( argv[0] );
+            return EXIT_FAILURE;
+        }
+
+        // get string pointers for arguments
+        const char* const pad_size = argv[index];
+        const char* const pad_file = argv[index + 1];
+
+        // convert argument from string to an unsigned integer
+        uint64_t pad_size_int = 0;
+
+        try {
+            pad_size_int = boost::lexical_cast<uint64_t>( pad_size );
+        } catch ( boost::bad_lexical_cast const& ) {
+            pad_size_int = 0;
+        }
+
+        // verify user requested pad length
+        if ( pad_size_int < 1 ) {
+            std::cerr << "ERROR: invalid pad size specified\n";
+            return EXIT_FAILURE;
+        }
+
+        // generate the pad and its ledger
+        if ( !create_pad( pad_file, pad_size_int, threads ) ) {
+            return EXIT_FAILURE;
+        }
+
+    } else if ( op.compare( PARAM::OP::BATCH ) == 0 ) {
+
+        // get the worker thread count and pad; defaults to one thread per core and per-entry keys
+        int index = 2;
+        unsigned int threads = std::max( 1u, std::thread::hardware_concurrency() );
+        const char* pad_file = nullptr;
+
+        for ( ; argc > index + 1 && argv[index][0] == '-' ; index += 2 ) {
+
+            const std::string option = argv[index];
+
+            if ( option.compare( PARAM::OPT::THREADS ) == 0 ) {
+
+                const auto thread_count = parse_thread_count( argv[index + 1] );
+
+                if ( !thread_count.first ) {
+                    return EXIT_FAILURE;
+                }
+
+                threads = thread_count.second;
+
+            } else if ( option.compare( PARAM::OPT::PAD ) == 0 ) {
+                pad_file = argv[index + 1];
+            } else {
+                std::cerr << "ERROR: unknown option '" << option << "' specified" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+        }
+
+        // verify argument count
+        if ( argc - index != 1 ) {
+            std::cerr << "ERROR: invalid argument count" << std::endl;
+            print_help( argv[0] );
             return EXIT_FAILURE;
         }
 
+        // process every manifest entry in this process
+        return run_batch( argv[index], pad_file, threads );
+
     } else {
 
         // no known operation was specified
@@ -0,0 +1,139 @@
+#include "mmap_xor.h"
+#include "file_io.h"
+#include "stream_xor.h"
+#include "xor_kernel.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief map an entire file read-only for sequential access
+ *
+ * @param path path of the file
+ * @param size size of the file in bytes
+ *
+ * @return address of the mapping if successful; MAP_FAILED otherwise;
+ */
+static void* map_input_file( const char* path, size_t size )
+{
+    const int fd = open_input_file( path );
+
+    if ( fd < 0 ) {
+        return MAP_FAILED;
+    }
+
+    // the mapping keeps its own reference to the file
+    void* const addr = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if ( addr == MAP_FAILED ) {
+        std::cerr << "ERROR: failed to map file '" << path << "'\n";
+        return MAP_FAILED;
+    }
+
+    // ask the kernel for aggressive read ahead
+    madvise( addr, size, MADV_SEQUENTIAL );
+
+    return addr;
+}
+
+bool mmap_xor_file( const char* key_path, const char* input_path, const char* output_path, unsigned int threads )
+{
+    // get the size of the input
+    const auto input_size = get_file_size( input_path );
+
+    if ( !input_size.first ) {
+        return false;
+    }
+
+    const size_t size = input_size.second;
+
+    // an output that is also an input is mapped over it without truncating; each byte is read before it is written
+    const bool in_place = is_same_file( output_path, input_path ) || is_same_file( output_path, key_path );
+
+    // create the output file; it must be readable to be mapped shared
+    const int output_fd = in_place ?
+        open( output_path, O_RDWR | O_CLOEXEC ) :
+        open( output_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+
+    if ( output_fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << output_path << "'\n";
+        return false;
+    }
+
+    // empty files cannot be mapped and need no further work
+    if ( size == 0 ) {
+        return close( output_fd ) == 0;
+    }
+
+    // reserve blocks for the output so a full disk is reported here rather than as a fault in the mapping
+    const int reserved = posix_fallocate( output_fd, 0, size );
+
+    // size the output to match the input
+    if ( ( reserved != 0 && reserved != EINVAL && reserved != EOPNOTSUPP ) || ftruncate( output_fd, size ) != 0 ) {
+        std::cerr << "ERROR: failed to write to file '" << output_path << "'\n";
+        close( output_fd );
+        return false;
+    }
+
+    // map the output
+    void* const output = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, output_fd, 0 );
+    close( output_fd );
+
+    if ( output == MAP_FAILED ) {
+        std::cerr << "ERROR: failed to map file '" << output_path << "'\n";
+        return false;
+    }
+
+    // map the inputs
+    void* const key = map_input_file( key_path, size );
+    void* const input = key == MAP_FAILED ? MAP_FAILED : map_input_file( input_path, size );
+
+    if ( key == MAP_FAILED || input == MAP_FAILED ) {
+        if ( key != MAP_FAILED ) {
+            munmap( key, size );
+        }
+        munmap( output, size );
+        return false;
+    }
+
+    // split the mappings into slices aligned to the chunk size
+    const size_t workers = std::max( threads, 1u );
+    const size_t slice = ( ( size + workers - 1 ) / workers + STREAM_CHUNK_SIZE - 1 ) / STREAM_CHUNK_SIZE * STREAM_CHUNK_SIZE;
+
+    // combine the slices directly from the input mappings into the output mapping
+    auto combine = [&]( size_t offset ) {
+        const size_t length = std::min( slice, size - offset );
+        xor_bytes(
+            static_cast<unsigned char*>( output ) + offset,
+            static_cast<unsigned char const*>( input ) + offset,
+            static_cast<unsigned char const*>( key ) + offset,
+            length );
+    };
+
+    std::vector<std::thread> pool;
+
+    for ( size_t offset = slice ; offset < size ; offset += slice ) {
+        pool.emplace_back( combine, offset );
+    }
+
+    // the calling thread handles the first slice
+    combine( 0 );
+
+    for ( auto& worker : pool ) {
+        worker.join();
+    }
+
+    // the dirty output pages are written back by the page cache after unmapping
+    munmap( input, size );
+    munmap( key, size );
+    munmap( output, size );
+
+    return true;
+}
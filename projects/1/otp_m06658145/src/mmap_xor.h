@@ -0,0 +1,19 @@
+#ifndef MMAP_XOR_H
+#define MMAP_XOR_H
+
+/**
+ * @brief xor an input file with a key file through memory mappings without intermediate copies
+ *
+ * The key and input files are mapped read-only and the output file is sized and mapped writable,
+ * so the xor kernel reads from and writes to the page cache directly.
+ *
+ * @param key_path path of the key file; must be at least as large as the input file
+ * @param input_path path of the input file
+ * @param output_path path of the output file
+ * @param threads number of threads combining slices of the mappings
+ *
+ * @return true if successful; false otherwise;
+ */
+bool mmap_xor_file( const char* key_path, const char* input_path, const char* output_path, unsigned int threads );
+
+#endif // MMAP_XOR_H
@@ -0,0 +1,311 @@
+#include "pad_ledger.h"
+#include "file_io.h"
+#include "random_file.h"
+#include "stream_xor.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief magic value identifying ciphertext produced from a pad
+ */
+static const unsigned char PAD_MAGIC[8] = { 'O', 'T', 'P', 'P', 'A', 'D', '0', '1' };
+
+/**
+ * @brief size of a ledger record; the next free offset as 20 decimal digits and a newline
+ */
+static const size_t LEDGER_RECORD_SIZE = 21;
+
+/**
+ * @brief store a 64-bit integer in little endian byte order
+ */
+static void store_le64( unsigned char* out, uint64_t value )
+{
+    for ( size_t i = 0 ; i < 8 ; ++i ) {
+        out[i] = static_cast<unsigned char>( value >> ( 8 * i ) );
+    }
+}
+
+/**
+ * @brief load a 64-bit integer stored in little endian byte order
+ */
+static uint64_t load_le64( unsigned char const* in )
+{
+    uint64_t value = 0;
+
+    for ( size_t i = 0 ; i < 8 ; ++i ) {
+        value |= static_cast<uint64_t>( in[i] ) << ( 8 * i );
+    }
+
+    return value;
+}
+
+/**
+ * @brief write a ledger record holding the next free pad offset
+ *
+ * @param fd descriptor of the ledger file
+ * @param offset next free pad offset
+ *
+ * @return true if the record was written and synced to disk; false otherwise;
+ */
+static bool write_ledger_record( int fd, uint64_t offset )
+{
+    char record[LEDGER_RECORD_SIZE + 1];
+    snprintf( record, sizeof( record ), "%020llu\n", static_cast<unsigned long long>( offset ) );
+
+    // a single fixed size write replaces the previous record in place
+    return pwrite_fully( fd, reinterpret_cast<unsigned char const*>( record ), LEDGER_RECORD_SIZE, 0 )
+        && fdatasync( fd ) == 0;
+}
+
+std::string get_ledger_path( const char* pad_path )
+{
+    return std::string( pad_path ) + ".ledger";
+}
+
+bool create_pad( const char* pad_path, uint64_t size, unsigned int threads )
+{
+    // generate the pad with parallel generator streams
+    if ( !generate_random_file( pad_path, size, threads ) ) {
+        return false;
+    }
+
+    // create the ledger with no bytes consumed
+    const std::string ledger_path = get_ledger_path( pad_path );
+    const int ledger_fd = open_output_file( ledger_path.c_str() );
+
+    if ( ledger_fd < 0 ) {
+        return false;
+    }
+
+    if ( !write_ledger_record( ledger_fd, 0 ) || close( ledger_fd ) != 0 ) {
+        std::cerr << "ERROR: failed to write to file '" << ledger_path << "'\n";
+        return false;
+    }
+
+    return true;
+}
+
+std::pair<bool, uint64_t> reserve_pad( const char* pad_path, uint64_t length )
+{
+    // get the size of the pad
+    const auto pad_size = get_file_size( pad_path );
+
+    if ( !pad_size.first ) {
+        return std::make_pair( false, uint64_t{ 0 } );
+    }
+
+    // open the ledger
+    const std::string ledger_path = get_ledger_path( pad_path );
+    const int ledger_fd = open( ledger_path.c_str(), O_RDWR | O_CLOEXEC );
+
+    if ( ledger_fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << ledger_path << "'\n";
+        return std::make_pair( false, uint64_t{ 0 } );
+    }
+
+    // serialize reservations between processes
+    if ( flock( ledger_fd, LOCK_EX ) != 0 ) {
+        std::cerr << "ERROR: failed to lock file '" << ledger_path << "'\n";
+        close( ledger_fd );
+        return std::make_pair( false, uint64_t{ 0 } );
+    }
+
+    // read the next free offset
+    unsigned char record[LEDGER_RECORD_SIZE + 1] = { 0 };
+    const auto record_read = pread_fully( ledger_fd, record, LEDGER_RECORD_SIZE, 0 );
+
+    char* end = nullptr;
+    const uint64_t offset = strtoull( reinterpret_cast<const char*>( record ), &end, 10 );
+
+    if ( !record_read.first || record_read.second != LEDGER_RECORD_SIZE || *end != '\n' ) {
+        std::cerr << "ERROR: invalid ledger file '" << ledger_path << "'\n";
+        close( ledger_fd );
+        return std::make_pair( false, uint64_t{ 0 } );
+    }
+
+    // verify the pad has enough unused bytes left
+    if ( offset > pad_size.second || length > pad_size.second - offset ) {
+        std::cerr << "ERROR: insufficient pad remaining ( " << pad_size.second - std::min( offset, pad_size.second )
+            << " < " << length << " )\n";
+        close( ledger_fd );
+        return std::make_pair( false, uint64_t{ 0 } );
+    }
+
+    // record the reservation before any pad byte is used
+    if ( !write_ledger_record( ledger_fd, offset + length ) ) {
+        std::cerr << "ERROR: failed to write to file '" << ledger_path << "'\n";
+        close( ledger_fd );
+        return std::make_pair( false, uint64_t{ 0 } );
+    }
+
+    // closing the ledger releases the lock
+    close( ledger_fd );
+
+    return std::make_pair( true, offset );
+}
+
+bool pad_encrypt_file( const char* pad_path, const char* input_path, const char* output_path, std::vector<unsigned char>& buffer )
+{
+    // get the size of the plaintext
+    const auto input_size = get_file_size( input_path );
+
+    if ( !input_size.first ) {
+        return false;
+    }
+
+    // open the pad, plaintext, and ciphertext files before consuming any pad bytes
+    const int pad_fd = open_input_file( pad_path );
+
+    if ( pad_fd < 0 ) {
+        return false;
+    }
+
+    const int input_fd = open_input_file( input_path );
+
+    if ( input_fd < 0 ) {
+        close( pad_fd );
+        return false;
+    }
+
+    const int output_fd = open_output_file( output_path );
+
+    if ( output_fd < 0 ) {
+        close( input_fd );
+        close( pad_fd );
+        return false;
+    }
+
+    // reserve a slice of the pad matching the plaintext size
+    const auto reservation = reserve_pad( pad_path, input_size.second );
+    bool status = reservation.first;
+
+    if ( status ) {
+
+        // build the header recording the pad slice
+        unsigned char header[PAD_HEADER_SIZE];
+        memcpy( header, PAD_MAGIC, sizeof( PAD_MAGIC ) );
+        store_le64( header + 8, reservation.second );
+        store_le64( header + 16, input_size.second );
+
+        // write the header followed by the ciphertext; sequential io also works on pipes
+        status = write_fully( output_fd, header, sizeof( header ) )
+            && lseek( pad_fd, static_cast<off_t>( reservation.second ), SEEK_SET ) >= 0
+            && stream_xor( pad_fd, pad_path, input_fd, input_path, output_fd, output_path, input_size.second, buffer );
+
+        if ( !status ) {
+            std::cerr << "ERROR: failed to encrypt '" << input_path << "' into '" << output_path << "'\n";
+        }
+    }
+
+    // close the output file and report any deferred write errors
+    if ( close( output_fd ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << output_path << "'\n";
+        status = false;
+    }
+
+    close( input_fd );
+    close( pad_fd );
+
+    return status;
+}
+
+bool pad_decrypt_file( const char* pad_path, const char* input_path, const char* output_path, std::vector<unsigned char>& buffer )
+{
+    // get the size of the pad
+    const auto pad_size = get_file_size( pad_path );
+
+    if ( !pad_size.first ) {
+        return false;
+    }
+
+    // get the size of the ciphertext unless it arrives through a pipe
+    const bool standard_input = is_standard_stream( input_path );
+    const auto input_size = standard_input ? std::make_pair( true, uint64_t{ 0 } ) : get_file_size( input_path );
+
+    if ( !input_size.first ) {
+        return false;
+    }
+
+    // open the ciphertext
+    const int input_fd = open_input_file( input_path );
+
+    if ( input_fd < 0 ) {
+        return false;
+    }
+
+    // read the header
+    unsigned char header[PAD_HEADER_SIZE];
+    const auto header_read = read_fully( input_fd, header, sizeof( header ) );
+
+    if ( !header_read.first || header_read.second != sizeof( header ) || memcmp( header, PAD_MAGIC, sizeof( PAD_MAGIC ) ) != 0 ) {
+        std::cerr << "ERROR: '" << input_path << "' does not contain a pad header\n";
+        close( input_fd );
+        return false;
+    }
+
+    const uint64_t offset = load_le64( header + 8 );
+    const uint64_t length = load_le64( header + 16 );
+
+    // verify the header matches the ciphertext and the pad
+    if ( !standard_input && length != input_size.second - PAD_HEADER_SIZE ) {
+        std::cerr << "ERROR: ciphertext and header sizes do not match ( "
+            << input_size.second - PAD_HEADER_SIZE << " != " << length << " )\n";
+        close( input_fd );
+        return false;
+    }
+
+    if ( offset > pad_size.second || length > pad_size.second - offset ) {
+        std::cerr << "ERROR: pad slice exceeds pad file size ( " << offset << " + " << length
+            << " > " << pad_size.second << " )\n";
+        close( input_fd );
+        return false;
+    }
+
+    // open the pad and plaintext files
+    const int pad_fd = open_input_file( pad_path );
+
+    if ( pad_fd < 0 ) {
+        close( input_fd );
+        return false;
+    }
+
+    const int output_fd = open_output_file( output_path );
+
+    if ( output_fd < 0 ) {
+        close( pad_fd );
+        close( input_fd );
+        return false;
+    }
+
+    // combine the ciphertext with only the recorded slice of the pad
+    bool status = lseek( pad_fd, static_cast<off_t>( offset ), SEEK_SET ) >= 0
+        && stream_xor( pad_fd, pad_path, input_fd, input_path, output_fd, output_path, length, buffer );
+
+    // a piped ciphertext is only known to match its header once it ends
+    unsigned char extra;
+    if ( status && standard_input && read_fully( input_fd, &extra, 1 ).second != 0 ) {
+        std::cerr << "ERROR: ciphertext is longer than its header records\n";
+        status = false;
+    }
+
+    if ( !status ) {
+        std::cerr << "ERROR: failed to decrypt '" << input_path << "' into '" << output_path << "'\n";
+    }
+
+    // close the output file and report any deferred write errors
+    if ( close( output_fd ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << output_path << "'\n";
+        status = false;
+    }
+
+    close( pad_fd );
+    close( input_fd );
+
+    return status;
+}
@@ -0,0 +1,75 @@
+#ifndef PAD_LEDGER_H
+#define PAD_LEDGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief size of the header written before ciphertext produced from a pad
+ *
+ * The header holds an 8 byte magic value followed by the pad offset and the message length,
+ * each stored as a little endian 64-bit integer.
+ */
+constexpr size_t PAD_HEADER_SIZE = 24;
+
+/**
+ * @brief get the path of the ledger that tracks consumption of a pad
+ *
+ * @param pad_path path of the pad file
+ *
+ * @return path of the ledger file
+ */
+std::string get_ledger_path( const char* pad_path );
+
+/**
+ * @brief generate a pad file of random bytes and an empty ledger next to it
+ *
+ * @param pad_path path of the pad file
+ * @param size size of the pad in bytes
+ * @param threads number of generator threads
+ *
+ * @return true if successful; false otherwise;
+ */
+bool create_pad( const char* pad_path, uint64_t size, unsigned int threads );
+
+/**
+ * @brief atomically reserve the next unused bytes of a pad
+ *
+ * The ledger is locked while it is updated and synced to disk before the reservation is returned,
+ * so pad bytes are never handed out twice even across processes or crashes.
+ *
+ * @param pad_path path of the pad file
+ * @param length number of bytes to reserve
+ *
+ * @return true and offset of the reserved bytes if successful; false otherwise;
+ */
+std::pair<bool, uint64_t> reserve_pad( const char* pad_path, uint64_t length );
+
+/**
+ * @brief encrypt a file with the next unused slice of a pad
+ *
+ * @param pad_path path of the pad file
+ * @param input_path path of the plaintext file; STANDARD_STREAM_PATH if standard input is a regular file
+ * @param output_path path of the ciphertext file or STANDARD_STREAM_PATH; written as a header followed by the ciphertext
+ * @param buffer scratch memory; reused across calls to avoid repeated allocation
+ *
+ * @return true if successful; false otherwise;
+ */
+bool pad_encrypt_file( const char* pad_path, const char* input_path, const char* output_path, std::vector<unsigned char>& buffer );
+
+/**
+ * @brief decrypt a file using the slice of a pad recorded in its header
+ *
+ * @param pad_path path of the pad file
+ * @param input_path path of the ciphertext file or STANDARD_STREAM_PATH
+ * @param output_path path of the plaintext file or STANDARD_STREAM_PATH
+ * @param buffer scratch memory; reused across calls to avoid repeated allocation
+ *
+ * @return true if successful; false otherwise;
+ */
+bool pad_decrypt_file( const char* pad_path, const char* input_path, const char* output_path, std::vector<unsigned char>& buffer );
+
+#endif // PAD_LEDGER_H
@@ -0,0 +1,139 @@
+#include "parallel_xor.h"
+#include "file_io.h"
+#include "stream_xor.h"
+#include "xor_kernel.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+bool xor_range(
+    int key_fd,
+    uint64_t key_offset,
+    int input_fd,
+    uint64_t input_offset,
+    int output_fd,
+    uint64_t output_offset,
+    uint64_t length,
+    std::vector<unsigned char>& buffer )
+{
+    // split the scratch memory into a data chunk and a key chunk
+    buffer.resize( 2 * STREAM_CHUNK_SIZE );
+    unsigned char* const data = buffer.data();
+    unsigned char* const key = buffer.data() + STREAM_CHUNK_SIZE;
+
+    for ( uint64_t done = 0 ; done < length ; ) {
+
+        // get the size of the next chunk
+        const size_t chunk = static_cast<size_t>( std::min<uint64_t>( STREAM_CHUNK_SIZE, length - done ) );
+
+        // read the input and key data for the chunk
+        const auto data_read = pread_fully( input_fd, data, chunk, input_offset + done );
+        const auto key_read = pread_fully( key_fd, key, chunk, key_offset + done );
+
+        // verify both reads returned the full chunk
+        if ( !data_read.first || data_read.second != chunk || !key_read.first || key_read.second != chunk ) {
+            return false;
+        }
+
+        // combine the data with the key in place
+        xor_bytes( data, data, key, chunk );
+
+        // write the combined chunk at its matching offset
+        if ( !pwrite_fully( output_fd, data, chunk, output_offset + done ) ) {
+            return false;
+        }
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+bool parallel_xor_file( const char* key_path, const char* input_path, const char* output_path, unsigned int threads )
+{
+    // get the size of the input
+    const auto input_size = get_file_size( input_path );
+
+    if ( !input_size.first ) {
+        return false;
+    }
+
+    // open the key, input, and output files
+    const int key_fd = open_input_file( key_path );
+
+    if ( key_fd < 0 ) {
+        return false;
+    }
+
+    const int input_fd = open_input_file( input_path );
+
+    if ( input_fd < 0 ) {
+        close( key_fd );
+        return false;
+    }
+
+    // an output that is also an input is rewritten in place; each range is read before it is written back
+    const int output_fd = open_xor_output_file( key_path, input_path, output_path );
+
+    if ( output_fd < 0 ) {
+        close( input_fd );
+        close( key_fd );
+        return false;
+    }
+
+    bool status = true;
+
+    // size the output up front so every worker can write its range independently
+    if ( ftruncate( output_fd, input_size.second ) != 0 ) {
+        std::cerr << "ERROR: failed to write to file '" << output_path << "'\n";
+        status = false;
+    }
+
+    // split the input into ranges aligned to the chunk size
+    const uint64_t size = input_size.second;
+    const uint64_t per_thread = ( size + std::max( threads, 1u ) - 1 ) / std::max( threads, 1u );
+    const uint64_t range_size = std::max<uint64_t>(
+        STREAM_CHUNK_SIZE, ( per_thread + STREAM_CHUNK_SIZE - 1 ) / STREAM_CHUNK_SIZE * STREAM_CHUNK_SIZE );
+
+    // get the number of ranges that actually contain data
+    const uint64_t ranges = ( size + range_size - 1 ) / range_size;
+
+    // record the result of each worker
+    std::vector<char> results( ranges, 1 );
+    std::vector<std::thread> workers;
+
+    if ( status ) {
+        for ( uint64_t i = 0 ; i < ranges ; ++i ) {
+            workers.emplace_back( [&, i]() {
+                const uint64_t offset = i * range_size;
+                const uint64_t length = std::min( range_size, size - offset );
+                std::vector<unsigned char> buffer;
+                results[i] = xor_range( key_fd, offset, input_fd, offset, output_fd, offset, length, buffer );
+            } );
+        }
+    }
+
+    // wait for all workers to complete
+    for ( auto& worker : workers ) {
+        worker.join();
+    }
+
+    // report a failure in any range
+    if ( status && std::find( results.begin(), results.end(), 0 ) != results.end() ) {
+        std::cerr << "ERROR: failed to combine '" << input_path << "' with '" << key_path
+            << "' into '" << output_path << "'\n";
+        status = false;
+    }
+
+    // close the output file and report any deferred write errors
+    if ( close( output_fd ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << output_path << "'\n";
+        status = false;
+    }
+
+    close( input_fd );
+    close( key_fd );
+
+    return status;
+}
@@ -0,0 +1,45 @@
+#ifndef PARALLEL_XOR_H
+#define PARALLEL_XOR_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief xor a range of an input descriptor with a range of a key descriptor using positioned i/o
+ *
+ * The range is processed in chunks of STREAM_CHUNK_SIZE bytes so memory use is bounded.
+ *
+ * @param key_fd descriptor of the key data
+ * @param key_offset offset of the first key byte to use
+ * @param input_fd descriptor of the input data
+ * @param input_offset offset of the first input byte to use
+ * @param output_fd descriptor the result is written to
+ * @param output_offset offset the first result byte is written to
+ * @param length number of bytes to process
+ * @param buffer scratch memory; resized to hold one data chunk and one key chunk
+ *
+ * @return true if successful; false otherwise;
+ */
+bool xor_range(
+    int key_fd,
+    uint64_t key_offset,
+    int input_fd,
+    uint64_t input_offset,
+    int output_fd,
+    uint64_t output_offset,
+    uint64_t length,
+    std::vector<unsigned char>& buffer );
+
+/**
+ * @brief xor an input file with a key file by splitting the files into ranges processed by worker threads
+ *
+ * @param key_path path of the key file
+ * @param input_path path of the input file
+ * @param output_path path of the output file
+ * @param threads number of worker threads
+ *
+ * @return true if successful; false otherwise;
+ */
+bool parallel_xor_file( const char* key_path, const char* input_path, const char* output_path, unsigned int threads );
+
+#endif // PARALLEL_XOR_H
@@ -0,0 +1,125 @@
+#include "random_file.h"
+#include "file_io.h"
+#include "keygen.h"
+#include "stream_xor.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief print generation progress to stderr
+ *
+ * @param done number of bytes written so far
+ * @param size total number of bytes
+ * @param seconds elapsed time in seconds
+ * @param final true for the closing summary line
+ */
+static void report_progress( uint64_t done, uint64_t size, double seconds, bool final )
+{
+    const double mb = 1024.0 * 1024.0;
+    const double rate = seconds > 0 ? done / seconds / mb : 0;
+
+    // overwrite the progress line in place on a terminal
+    std::cerr << ( isatty( STDERR_FILENO ) ? "\r" : "" )
+        << "generated " << std::fixed << std::setprecision( 1 ) << done / mb << " / " << size / mb << " MB"
+        << " (" << std::setprecision( 1 ) << rate << " MB/s)"
+        << ( final || !isatty( STDERR_FILENO ) ? "\n" : "" ) << std::flush;
+}
+
+bool generate_random_file( const char* path, uint64_t size, unsigned int threads )
+{
+    // open the output file
+    const int fd = open_output_file( path );
+
+    if ( fd < 0 ) {
+        return false;
+    }
+
+    // reserve space so workers can write their regions in any order without fragmenting the file
+    const int reserved = posix_fallocate( fd, 0, size );
+
+    if ( ( reserved != 0 && reserved != EINVAL && reserved != EOPNOTSUPP ) || ftruncate( fd, size ) != 0 ) {
+        std::cerr << "ERROR: failed to write to file '" << path << "'\n";
+        close( fd );
+        return false;
+    }
+
+    // split the file into regions aligned to the chunk size
+    const uint64_t workers = std::max( threads, 1u );
+    const uint64_t region_size = std::max<uint64_t>(
+        STREAM_CHUNK_SIZE, ( ( size + workers - 1 ) / workers + STREAM_CHUNK_SIZE - 1 ) / STREAM_CHUNK_SIZE * STREAM_CHUNK_SIZE );
+    const uint64_t regions = ( size + region_size - 1 ) / region_size;
+
+    // shared progress and status
+    std::atomic<uint64_t> done{ 0 };
+    std::atomic<uint64_t> finished{ 0 };
+    std::atomic<bool> failed{ false };
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> pool;
+
+    for ( uint64_t i = 0 ; i < regions ; ++i ) {
+        pool.emplace_back( [&, i]() {
+
+            // each thread owns its generator state and one chunk buffer
+            std::vector<unsigned char> chunk_data( STREAM_CHUNK_SIZE );
+            const uint64_t begin = i * region_size;
+            const uint64_t end = std::min( size, begin + region_size );
+
+            for ( uint64_t offset = begin ; offset < end && !failed ; ) {
+
+                const size_t chunk = static_cast<size_t>( std::min<uint64_t>( STREAM_CHUNK_SIZE, end - offset ) );
+
+                keygen( chunk_data.data(), chunk );
+
+                if ( !pwrite_fully( fd, chunk_data.data(), chunk, offset ) ) {
+                    failed = true;
+                    break;
+                }
+
+                offset += chunk;
+                done += chunk;
+            }
+
+            ++finished;
+        } );
+    }
+
+    // report progress about once a second until every worker finishes
+    auto last_report = start_time;
+
+    while ( finished < regions ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+
+        const auto now = std::chrono::steady_clock::now();
+
+        if ( now - last_report >= std::chrono::seconds( 1 ) ) {
+            report_progress( done, size, std::chrono::duration<double>( now - start_time ).count(), false );
+            last_report = now;
+        }
+    }
+
+    for ( auto& worker : pool ) {
+        worker.join();
+    }
+
+    // make sure the data is on disk before reporting success
+    if ( failed || fsync( fd ) != 0 || close( fd ) != 0 ) {
+        std::cerr << "ERROR: failed to write to file '" << path << "'\n";
+        return false;
+    }
+
+    const auto end_time = std::chrono::steady_clock::now();
+
+    report_progress( done, size, std::chrono::duration<double>( end_time - start_time ).count(), true );
+
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef RANDOM_FILE_H
+#define RANDOM_FILE_H
+
+#include <stdint.h>
+
+/**
+ * @brief stream random key data into a file using parallel generator threads
+ *
+ * The file is split into disjoint chunk-aligned regions. Each worker thread fills its region from
+ * its own independently seeded generator and writes it chunk by chunk, so memory use is bounded
+ * by one chunk per thread regardless of the file size. Progress and throughput are reported on
+ * stderr.
+ *
+ * @param path path of the output file
+ * @param size size of the output in bytes
+ * @param threads number of generator threads
+ *
+ * @return true if successful; false otherwise;
+ */
+bool generate_random_file( const char* path, uint64_t size, unsigned int threads );
+
+#endif // RANDOM_FILE_H
@@ -0,0 +1,221 @@
+#include "stream_xor.h"
+#include "file_io.h"
+#include "xor_kernel.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ * @brief get the chunk size to use when splicing into a descriptor
+ *
+ * The pipe is grown to STREAM_CHUNK_SIZE if allowed so that each chunk fits in the pipe.
+ *
+ * @param fd output descriptor
+ *
+ * @return pipe size in bytes if the descriptor is a pipe; zero otherwise;
+ */
+static size_t get_splice_size( int fd )
+{
+    struct stat st;
+
+    if ( fstat( fd, &st ) != 0 || !S_ISFIFO( st.st_mode ) ) {
+        return 0;
+    }
+
+    // a larger pipe means fewer splice calls; failure leaves the current size
+    fcntl( fd, F_SETPIPE_SZ, static_cast<int>( STREAM_CHUNK_SIZE ) );
+
+    const int size = fcntl( fd, F_GETPIPE_SZ );
+
+    return size > 0 ? static_cast<size_t>( size ) : 0;
+}
+
+/**
+ * @brief hand whole pages of memory to a pipe
+ *
+ * @param fd pipe to write to
+ * @param data page aligned memory that is unmapped afterwards without being written again
+ * @param len number of bytes
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool vmsplice_fully( int fd, unsigned char* data, size_t len )
+{
+    size_t total = 0;
+
+    while ( total < len ) {
+        struct iovec iov = { data + total, len - total };
+        const ssize_t count = vmsplice( fd, &iov, 1, SPLICE_F_GIFT );
+
+        if ( count < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+
+        total += count;
+    }
+
+    return true;
+}
+
+bool stream_xor(
+    int key_fd,
+    const char* key_path,
+    int input_fd,
+    const char* input_path,
+    int output_fd,
+    const char* output_path,
+    uint64_t length,
+    std::vector<unsigned char>& buffer )
+{
+    // size the chunks to the output pipe when splicing
+    const size_t splice_size = get_splice_size( output_fd );
+    const size_t chunk_size = splice_size > 0 ? splice_size : STREAM_CHUNK_SIZE;
+
+    const bool splice = splice_size > 0;
+
+    // split the scratch memory into a data chunk and a key chunk, or use it for the key only
+    buffer.resize( splice ? chunk_size : 2 * chunk_size );
+    unsigned char* const key = buffer.data() + ( splice ? 0 : chunk_size );
+
+    // spliced pages stay referenced by the pipe, and by any pipe they are spliced on to, after
+    // vmsplice returns, so every spliced chunk is read into fresh pages that are never reused
+    void* splice_map = MAP_FAILED;
+
+    bool status = true;
+
+    for ( uint64_t remaining = length ; remaining > 0 ; ) {
+
+        // replace the pages given to the pipe by the previous chunk
+        if ( splice ) {
+            if ( splice_map != MAP_FAILED ) {
+                munmap( splice_map, chunk_size );
+            }
+
+            splice_map = mmap( nullptr, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+            if ( splice_map == MAP_FAILED ) {
+                std::cerr << "ERROR: failed to allocate memory for file '" << output_path << "'\n";
+                status = false;
+                break;
+            }
+        }
+
+        unsigned char* const data = splice ? static_cast<unsigned char*>( splice_map ) : buffer.data();
+
+        // read the next chunk of input data
+        const auto data_read = read_fully( input_fd, data, std::min<uint64_t>( chunk_size, remaining ) );
+
+        // verify read was successful
+        if ( !data_read.first ) {
+            std::cerr << "ERROR: failed to read from file '" << input_path << "'\n";
+            status = false;
+            break;
+        }
+
+        // stop at the end of the input, which must not come early when a length is given
+        if ( data_read.second == 0 ) {
+            if ( length != STREAM_TO_END ) {
+                std::cerr << "ERROR: file '" << input_path << "' ended " << remaining << " bytes early\n";
+                status = false;
+            }
+            break;
+        }
+
+        // read a matching chunk of key data
+        const auto key_read = read_fully( key_fd, key, data_read.second );
+
+        // verify read was successful and returned enough key material
+        if ( !key_read.first || key_read.second != data_read.second ) {
+            std::cerr << "ERROR: failed to read from file '" << key_path << "'\n";
+            status = false;
+            break;
+        }
+
+        // combine the data with the key in place
+        xor_bytes( data, data, key, data_read.second );
+
+        // write the combined chunk to the output
+        const bool written = splice ?
+            vmsplice_fully( output_fd, data, data_read.second ) :
+            write_fully( output_fd, data, data_read.second );
+
+        if ( !written ) {
+            std::cerr << "ERROR: failed to write to file '" << output_path << "'\n";
+            status = false;
+            break;
+        }
+
+        remaining -= data_read.second;
+    }
+
+    if ( splice_map != MAP_FAILED ) {
+        munmap( splice_map, chunk_size );
+    }
+
+    return status;
+}
+
+int open_xor_output_file( const char* key_path, const char* input_path, const char* output_path )
+{
+    // truncating an output that is also an input would lose its data before it is read
+    const bool in_place = !is_standard_stream( output_path ) &&
+        ( is_same_file( output_path, input_path ) || is_same_file( output_path, key_path ) );
+
+    return in_place ? open_in_place_file( output_path ) : open_output_file( output_path );
+}
+
+bool stream_xor_file( const char* key_path, const char* input_path, const char* output_path, std::vector<unsigned char>& buffer )
+{
+    // open the key file
+    const int key_fd = open_input_file( key_path );
+
+    if ( key_fd < 0 ) {
+        return false;
+    }
+
+    // open the input file
+    const int input_fd = open_input_file( input_path );
+
+    if ( input_fd < 0 ) {
+        close( key_fd );
+        return false;
+    }
+
+    // open the output file, rewriting the input in place if both name the same file
+    const int output_fd = open_xor_output_file( key_path, input_path, output_path );
+
+    if ( output_fd < 0 ) {
+        close( input_fd );
+        close( key_fd );
+        return false;
+    }
+
+    // process the files chunk by chunk
+    bool status = stream_xor( key_fd, key_path, input_fd, input_path, output_fd, output_path, STREAM_TO_END, buffer );
+
+    // the key must end with the input, which is only known afterwards when reading a pipe
+    unsigned char extra;
+    if ( status && read_fully( key_fd, &extra, 1 ).second != 0 ) {
+        std::cerr << "ERROR: input '" << input_path << "' is shorter than key '" << key_path << "'\n";
+        status = false;
+    }
+
+    // close the output file and report any deferred write errors
+    if ( close( output_fd ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << output_path << "'\n";
+        status = false;
+    }
+
+    close( input_fd );
+    close( key_fd );
+
+    return status;
+}
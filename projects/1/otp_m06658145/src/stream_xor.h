@@ -0,0 +1,75 @@
+#ifndef STREAM_XOR_H
+#define STREAM_XOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief number of data bytes processed per chunk in streaming mode
+ */
+constexpr size_t STREAM_CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * @brief length passed to stream_xor to process the input until end of file
+ */
+constexpr uint64_t STREAM_TO_END = UINT64_MAX;
+
+/**
+ * @brief xor data read from a descriptor with key data read from a descriptor and write the result
+ *
+ * Data is processed in chunks of STREAM_CHUNK_SIZE bytes until length bytes are processed or
+ * the input reaches end of file. When the output is a pipe the chunks are sized to the pipe and
+ * their pages are handed to it with vmsplice instead of being copied; each chunk is only reused
+ * after the pipe has drained it.
+ *
+ * @param key_fd descriptor of the key data, positioned at the first key byte to use
+ * @param key_path path of the key data used in error messages
+ * @param input_fd descriptor of the input data
+ * @param input_path path of the input data used in error messages
+ * @param output_fd descriptor the result is written to
+ * @param output_path path of the output data used in error messages
+ * @param length number of input bytes to process; STREAM_TO_END to stop at end of file
+ * @param buffer scratch memory; resized to hold one key chunk and, unless spliced, one data chunk
+ *
+ * @return true if successful; false otherwise; reaching end of file before length bytes fails
+ */
+bool stream_xor(
+    int key_fd,
+    const char* key_path,
+    int input_fd,
+    const char* input_path,
+    int output_fd,
+    const char* output_path,
+    uint64_t length,
+    std::vector<unsigned char>& buffer );
+
+/**
+ * @brief open the output of an xor of an input file with a key file
+ *
+ * An output that names the input or the key is opened without truncating it, so that each
+ * chunk can be read before the combined chunk is written back over it at the same offset.
+ *
+ * @param key_path path of the key file
+ * @param input_path path of the input file; STANDARD_STREAM_PATH for standard input
+ * @param output_path path of the output file; STANDARD_STREAM_PATH for standard output
+ *
+ * @return file descriptor if successful; -1 otherwise;
+ */
+int open_xor_output_file( const char* key_path, const char* input_path, const char* output_path );
+
+/**
+ * @brief xor an input file with a key file using a fixed amount of memory
+ *
+ * The key must be exactly as long as the input, which is checked as the data is streamed.
+ *
+ * @param key_path path of the key file
+ * @param input_path path of the input file; STANDARD_STREAM_PATH for standard input
+ * @param output_path path of the output file; STANDARD_STREAM_PATH for standard output
+ * @param buffer scratch memory; reused across calls to avoid repeated allocation
+ *
+ * @return true if successful; false otherwise;
+ */
+bool stream_xor_file( const char* key_path, const char* input_path, const char* output_path, std::vector<unsigned char>& buffer );
+
+#endif // STREAM_XOR_H
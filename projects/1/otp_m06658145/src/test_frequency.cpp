@@ -1,6 +1,300 @@
 #include "keygen.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
 #include <iostream>
+#include <stdint.h>
+#include <string.h>
 #include <stdlib.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief statistics accumulated over one contiguous stream of generator output
+ *
+ * Bits are taken from each 64-bit little endian word starting at the least significant bit.
+ */
+struct stream_statistics
+{
+    // number of occurrences of each byte value
+    uint64_t histogram[256] = {0};
+
+    // number of bytes and one bits seen
+    uint64_t bytes = 0;
+    uint64_t ones = 0;
+
+    // number of adjacent bit pairs that differ
+    uint64_t transitions = 0;
+
+    // first and last bit and byte of the stream, used to join streams
+    unsigned int first_bit = 0;
+    unsigned int last_bit = 0;
+    unsigned int first_byte = 0;
+    unsigned int last_byte = 0;
+
+    // sum of products of adjacent byte values for the serial correlation
+    uint64_t sum_products = 0;
+
+    // seconds spent inside the generator
+    double generator_seconds = 0;
+};
+
+/**
+ * @brief add a buffer of generator output to the statistics of a stream
+ *
+ * Cloned for cpus with a popcnt instruction, which the bit counts depend on for speed.
+ *
+ * @param stats statistics of the stream so far
+ * @param data buffer continuing the stream; size must be a multiple of 8
+ * @param size number of bytes in the buffer
+ */
+__attribute__(( target_clones( "popcnt", "default" ) ))
+static void accumulate_statistics( stream_statistics& stats, unsigned char const* data, size_t size )
+{
+    // remember the beginning of the stream
+    if ( stats.bytes == 0 ) {
+        stats.first_bit = data[0] & 1;
+        stats.first_byte = data[0];
+    } else {
+        // join the previous buffer to this one
+        stats.transitions += stats.last_bit != ( data[0] & 1u );
+        stats.sum_products += stats.last_byte * uint64_t{ data[0] };
+    }
+
+    // count bits and transitions one word at a time
+    uint64_t previous_bit = data[0] & 1;
+    for ( size_t i = 0 ; i < size ; i += sizeof( uint64_t ) ) {
+        uint64_t word;
+        memcpy( &word, data + i, sizeof( word ) );
+        stats.ones += __builtin_popcountll( word );
+        stats.transitions += __builtin_popcountll( ( word ^ ( word >> 1 ) ) & 0x7fffffffffffffffULL );
+        stats.transitions += previous_bit != ( word & 1 );
+        previous_bit = word >> 63;
+    }
+
+    // count byte values; four histograms break the store to load dependency on repeated values
+    uint32_t histograms[4][256] = {{0}};
+    for ( size_t i = 0 ; i < size ; i += 4 ) {
+        ++histograms[0][data[i]];
+        ++histograms[1][data[i + 1]];
+        ++histograms[2][data[i + 2]];
+        ++histograms[3][data[i + 3]];
+    }
+
+    // sum products of adjacent bytes in blocks small enough for a vectorizable 32-bit accumulator
+    const size_t block_size = 32768;
+    uint64_t sum_products = 0;
+    for ( size_t block = 0 ; block + 1 < size ; block += block_size ) {
+        const size_t end = std::min( block + block_size, size - 1 );
+        uint32_t block_sum = 0;
+        for ( size_t i = block ; i < end ; ++i ) {
+            block_sum += uint32_t{ data[i] } * data[i + 1];
+        }
+        sum_products += block_sum;
+    }
+
+    // fold the buffer into the stream
+    for ( unsigned int value = 0 ; value < 256 ; ++value ) {
+        stats.histogram[value] += uint64_t{ histograms[0][value] } + histograms[1][value] + histograms[2][value] + histograms[3][value];
+    }
+    stats.sum_products += sum_products;
+    stats.bytes += size;
+    stats.last_bit = data[size - 1] >> 7;
+    stats.last_byte = data[size - 1];
+}
+
+/**
+ * @brief join the statistics of a stream onto the end of another stream
+ *
+ * @param stats statistics of the leading stream
+ * @param next statistics of the following stream
+ */
+static void merge_statistics( stream_statistics& stats, stream_statistics const& next )
+{
+    if ( next.bytes == 0 ) {
+        return;
+    }
+
+    if ( stats.bytes == 0 ) {
+        stats = next;
+        return;
+    }
+
+    for ( unsigned int value = 0 ; value < 256 ; ++value ) {
+        stats.histogram[value] += next.histogram[value];
+    }
+    stats.transitions += next.transitions + ( stats.last_bit != next.first_bit );
+    stats.sum_products += next.sum_products + stats.last_byte * uint64_t{ next.first_byte };
+    stats.bytes += next.bytes;
+    stats.ones += next.ones;
+    stats.last_bit = next.last_bit;
+    stats.last_byte = next.last_byte;
+    stats.generator_seconds += next.generator_seconds;
+}
+
+/**
+ * @brief regularized upper incomplete gamma function Q( a, x )
+ *
+ * Uses the series expansion below a + 1 and the continued fraction above it.
+ */
+static double upper_incomplete_gamma( double a, double x )
+{
+    if ( x <= 0 ) {
+        return 1.0;
+    }
+
+    const double log_prefix = a * std::log( x ) - x - std::lgamma( a );
+
+    if ( x < a + 1 ) {
+        // series for the lower function P( a, x )
+        double term = 1.0 / a;
+        double total = term;
+        for ( unsigned int n = 1 ; n < 1000 && std::fabs( term ) > std::fabs( total ) * 1e-15 ; ++n ) {
+            term *= x / ( a + n );
+            total += term;
+        }
+        return 1.0 - total * std::exp( log_prefix );
+    }
+
+    // modified lentz evaluation of the continued fraction for Q( a, x )
+    const double tiny = 1e-300;
+    double b = x + 1 - a;
+    double c = 1 / tiny;
+    double d = 1 / b;
+    double h = d;
+    for ( unsigned int n = 1 ; n < 1000 ; ++n ) {
+        const double an = -( n * ( n - a ) );
+        b += 2;
+        d = an * d + b;
+        d = std::fabs( d ) < tiny ? tiny : d;
+        c = b + an / c;
+        c = std::fabs( c ) < tiny ? tiny : c;
+        d = 1 / d;
+        const double delta = d * c;
+        h *= delta;
+        if ( std::fabs( delta - 1 ) < 1e-15 ) {
+            break;
+        }
+    }
+    return std::exp( log_prefix ) * h;
+}
+
+/**
+ * @brief print one line of the statistical test results
+ */
+static void print_statistic( const char* name, double statistic, double p_value )
+{
+    // significance level used to flag a failure
+    const double alpha = 0.01;
+
+    std::cout << " " << std::left << std::setw( 19 ) << name << std::right
+        << " | " << std::setw( 14 ) << std::setprecision( 6 ) << statistic
+        << " | " << std::setw( 8 ) << std::setprecision( 6 ) << p_value
+        << " | " << ( p_value >= alpha ? "pass" : "FAIL" ) << "\n";
+}
+
+/**
+ * @brief stream generator output through several threads and test it statistically
+ *
+ * @param total_bytes number of bytes to generate
+ * @param threads number of generator threads
+ */
+static void test_statistical_suite( uint64_t total_bytes, unsigned int threads )
+{
+    // size of the buffer filled by each call to the generator
+    const size_t buffer_size = 1024 * 1024;
+
+    // split the work into whole buffers per thread
+    const uint64_t buffers = std::max<uint64_t>( 1, ( total_bytes + buffer_size - 1 ) / buffer_size );
+    threads = static_cast<unsigned int>( std::min<uint64_t>( threads, buffers ) );
+    std::vector<stream_statistics> results( threads );
+
+    // get the time point at the beginning of the test run
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // each thread tests its own stream of generator output
+    std::vector<std::thread> workers;
+    for ( unsigned int t = 0 ; t < threads ; ++t ) {
+        const uint64_t count = buffers / threads + ( t < buffers % threads );
+        workers.emplace_back( [&results, t, count, buffer_size]() {
+            std::vector<unsigned char> buffer( buffer_size );
+            for ( uint64_t i = 0 ; i < count ; ++i ) {
+                const auto generate_start = std::chrono::steady_clock::now();
+                keygen( buffer.data(), buffer.size() );
+                const auto generate_end = std::chrono::steady_clock::now();
+                results[t].generator_seconds += std::chrono::duration<double>( generate_end - generate_start ).count();
+                accumulate_statistics( results[t], buffer.data(), buffer.size() );
+            }
+        } );
+    }
+
+    for ( auto& worker : workers ) {
+        worker.join();
+    }
+
+    // get the time point at the end of the test run
+    const auto end_time = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>( end_time - start_time ).count();
+
+    // merge the per thread streams in order as one long stream
+    stream_statistics stats;
+    for ( auto const& result : results ) {
+        merge_statistics( stats, result );
+    }
+
+    const double n_bytes = static_cast<double>( stats.bytes );
+    const double n_bits = n_bytes * 8;
+
+    // byte level chi-square with 255 degrees of freedom; byte sums come from the histogram
+    const double expected = n_bytes / 256;
+    double chi_square = 0;
+    double sum = 0;
+    double sum_squares = 0;
+    for ( unsigned int value = 0 ; value < 256 ; ++value ) {
+        const double difference = stats.histogram[value] - expected;
+        chi_square += difference * difference / expected;
+        sum += static_cast<double>( stats.histogram[value] ) * value;
+        sum_squares += static_cast<double>( stats.histogram[value] ) * value * value;
+    }
+    const double chi_square_p = upper_incomplete_gamma( 255 / 2.0, chi_square / 2 );
+
+    // monobit frequency test as a z-score
+    const double monobit = std::fabs( 2 * static_cast<double>( stats.ones ) - n_bits ) / std::sqrt( n_bits );
+    const double monobit_p = std::erfc( monobit / std::sqrt( 2.0 ) );
+
+    // runs test as a z-score; the number of runs is one more than the number of transitions
+    const double pi = stats.ones / n_bits;
+    const double runs = ( static_cast<double>( stats.transitions ) + 1 - 2 * n_bits * pi * ( 1 - pi ) ) / ( 2 * std::sqrt( n_bits ) * pi * ( 1 - pi ) );
+    const double runs_p = std::erfc( std::fabs( runs ) / std::sqrt( 2.0 ) );
+
+    // lag one serial correlation of byte values
+    const double mean = sum / n_bytes;
+    const double variance = sum_squares / n_bytes - mean * mean;
+    const double covariance = stats.sum_products / ( n_bytes - 1 ) - mean * mean;
+    const double correlation = covariance / variance;
+    const double correlation_p = std::erfc( std::fabs( correlation ) * std::sqrt( n_bytes / 2 ) );
+
+    std::cout << "statistical test parameters\n";
+    std::cout << " bytes   = " << stats.bytes << "\n";
+    std::cout << " threads = " << threads << "\n";
+    std::cout << "\n";
+
+    std::cout << "statistical test results\n";
+    std::cout << " test                |      statistic |  p-value | result\n";
+    std::cout << " ------------------- | -------------- | -------- | ------\n";
+    std::cout << std::fixed;
+    print_statistic( "byte chi-square", chi_square, chi_square_p );
+    print_statistic( "monobit", monobit, monobit_p );
+    print_statistic( "runs", runs, runs_p );
+    print_statistic( "serial correlation", correlation, correlation_p );
+    std::cout << "\n";
+
+    std::cout << "statistical test throughput\n";
+    std::cout << std::setprecision( 2 );
+    std::cout << " generator = " << std::setw( 10 ) << n_bytes / stats.generator_seconds * threads / 1e6 << " MB/s\n";
+    std::cout << " suite     = " << std::setw( 10 ) << n_bytes / seconds / 1e6 << " MB/s (" << seconds << " s)\n";
+}
 
 static void test_frequency_distribution( void )
 {
@@ -44,7 +338,18 @@ static void test_frequency_distribution( void )
 
 int main( int argc, const char *argv[] )
 {
+    // get the amount of generator output to test in megabytes and the thread count
+    const uint64_t megabytes = argc > 1 ? strtoull( argv[1], nullptr, 10 ) : 1024;
+    const unsigned int threads = argc > 2 ? strtoul( argv[2], nullptr, 10 ) : std::max( 1u, std::thread::hardware_concurrency() );
+
+    if ( megabytes == 0 || threads == 0 ) {
+        std::cerr << "usage: " << argv[0] << " [megabytes] [threads]\n";
+        return EXIT_FAILURE;
+    }
+
     test_frequency_distribution();
+    std::cout << "\n";
+    test_statistical_suite( megabytes * 1024 * 1024, threads );
     return EXIT_SUCCESS;
 }
 
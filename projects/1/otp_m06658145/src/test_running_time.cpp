@@ -1,107 +1,712 @@
+#include "base64.h"
+#include "file_io.h"
 #include "keygen.h"
+#include "mmap_xor.h"
+#include "parallel_xor.h"
+#include "perf_counters.h"
+#include "stream_xor.h"
+#include "uring_xor.h"
+#include "xor_kernel.h"
 #include <algorithm>
 #include <chrono>
+#include <fcntl.h>
 #include <iomanip>
 #include <iostream>
-#include <numeric>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <string.h>
 #include <stdlib.h>
+#include <thread>
+#include <unistd.h>
 
-static void test_running_time( void )
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+/**
+ * @brief write a file filled with a single byte value
+ *
+ * @param path path of the file
+ * @param size size of the file in bytes
+ * @param value byte value to fill the file with
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool create_test_file( const char* path, size_t size, unsigned char value )
+{
+    // write the file a chunk at a time so large files do not need a matching buffer
+    const std::vector<unsigned char> data( std::min<size_t>( size, 1024 * 1024 ), value );
+
+    const int fd = open_output_file( path );
+
+    if ( fd < 0 ) {
+        return false;
+    }
+
+    bool status = true;
+
+    for ( size_t offset = 0 ; status && offset < size ; offset += data.size() ) {
+        status = write_fully( fd, data.data(), std::min<size_t>( data.size(), size - offset ) );
+    }
+
+    return close( fd ) == 0 && status;
+}
+
+/**
+ * @brief output format of the size sweep table
+ */
+enum class sweep_format { csv, json };
+
+/**
+ * @brief get the smallest cost of reading the clock twice, which is subtracted from each measurement
+ *
+ * @return timer overhead in nanoseconds
+ */
+static double measure_timer_overhead( void )
+{
+    double best = 1e9;
+
+    for ( unsigned int i = 0 ; i < 10000 ; ++i ) {
+        const auto start_time = std::chrono::steady_clock::now();
+        const auto end_time = std::chrono::steady_clock::now();
+        best = std::min( best, std::chrono::duration<double, std::nano>( end_time - start_time ).count() );
+    }
+
+    return best;
+}
+
+/**
+ * @brief get the time stamp counter frequency by comparing it against the steady clock
+ *
+ * @return time stamp counter ticks per nanosecond; zero if there is no time stamp counter
+ */
+static double measure_tsc_ghz( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    const auto start_time = std::chrono::steady_clock::now();
+    const uint64_t start_ticks = __rdtsc();
+
+    // spin for long enough to make the clock resolution irrelevant
+    while ( std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds( 50 ) ) {
+    }
+
+    const uint64_t end_ticks = __rdtsc();
+    const auto end_time = std::chrono::steady_clock::now();
+
+    return ( end_ticks - start_ticks ) / std::chrono::duration<double, std::nano>( end_time - start_time ).count();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief parse a byte count with an optional K, M, or G binary suffix
+ *
+ * @param text byte count argument
+ *
+ * @return byte count; zero if the argument is invalid
+ */
+static uint64_t parse_size( const char* text )
+{
+    char* end = nullptr;
+    uint64_t size = strtoull( text, &end, 10 );
+
+    switch ( *end ) {
+        case 'G': size *= 1024; // fall through
+        case 'M': size *= 1024; // fall through
+        case 'K': size *= 1024; ++end; break;
+        default: break;
+    }
+
+    return *end == '\0' ? size : 0;
+}
+
+/**
+ * @brief time an operation over payload sizes from 16 bytes upward in each otp data path
+ *
+ * Each measurement runs a batch of operations between two clock reads, subtracts the
+ * timer overhead, and keeps the median of several batches. Cycles are time stamp counter
+ * ticks, which run at the nominal rather than the current core frequency. Hardware counters
+ * cover every batch of a measurement and only count user space, so the file paths leave out
+ * the time spent in system calls; counters that cannot be opened are left empty or null.
+ *
+ * @param max_size largest payload size in bytes
+ * @param format output format of the result table
+ */
+static void test_size_sweep( uint64_t max_size, sweep_format format )
+{
+    // set the parameters for the test
+    const char key_file[]        = "sweep_key.bin";
+    const char input_file[]      = "sweep_input.bin";
+    const char output_file[]     = "sweep_output.bin";
+    const uint64_t min_size      = 16;
+    const uint64_t memory_bytes  = 256 * 1024 * 1024;
+    const uint64_t file_bytes    = 64 * 1024 * 1024;
+    const unsigned int batches   = 5;
+
+    const double timer_overhead = measure_timer_overhead();
+    const double tsc_ghz = measure_tsc_ghz();
+
+    // count hardware events over the batches of every measurement
+    perf_counters counters;
+    const std::string counter_error = counters.any_available() ? "" : counters.error();
+
+    if ( format == sweep_format::csv ) {
+        std::cout << "# timer_overhead_ns=" << timer_overhead << " tsc_ghz=" << tsc_ghz;
+        std::cout << ( counter_error.empty() ? "" : " perf_counters=\"unavailable: " + counter_error + "\"" ) << "\n";
+        std::cout << "path,bytes,iterations,ns_per_op,gb_per_s,cycles_per_byte,"
+                     "core_cycles_per_byte,ipc,instructions_per_byte,cache_misses_per_kb,branch_misses_per_kb,llc_load_misses_per_kb\n";
+    } else {
+        std::cout << "{\n  \"timer_overhead_ns\": " << timer_overhead << ",\n  \"tsc_ghz\": " << tsc_ghz << ",\n";
+        std::cout << ( counter_error.empty() ? "" : "  \"perf_counters\": \"unavailable: " + counter_error + "\",\n" ) << "  \"results\": [";
+    }
+
+    // format a counter ratio as a csv field or json value; empty or null when unavailable
+    auto counter_field = [&]( double count, double divisor ) {
+        std::ostringstream field;
+
+        if ( count >= 0 && divisor > 0 ) {
+            field << count / divisor;
+        } else if ( format == sweep_format::json ) {
+            field << "null";
+        }
+
+        return field.str();
+    };
+
+    bool first_row = true;
+
+    // time a batch of operations several times and print the median
+    auto measure = [&]( const char* path, uint64_t size, uint64_t bytes_per_batch, uint64_t max_iterations, auto const& operation ) {
+        const uint64_t iterations = std::min( max_iterations, std::max<uint64_t>( 1, bytes_per_batch / size ) );
+        std::vector<double> results( batches );
+
+        counters.start();
+
+        for ( auto& result : results ) {
+            const auto start_time = std::chrono::steady_clock::now();
+            for ( uint64_t i = 0 ; i < iterations ; ++i ) {
+                if ( !operation() ) {
+                    counters.stop();
+                    return false;
+                }
+            }
+            const auto end_time = std::chrono::steady_clock::now();
+            const double elapsed = std::chrono::duration<double, std::nano>( end_time - start_time ).count();
+            result = std::max( 0.0, elapsed - timer_overhead ) / iterations;
+        }
+
+        counters.stop();
+
+        std::sort( results.begin(), results.end() );
+        const double ns_per_op = results[batches / 2];
+        const double gbps = ns_per_op > 0 ? size / ns_per_op : 0;
+        const double cycles_per_byte = ns_per_op * tsc_ghz / size;
+
+        // get the counter ratios over every byte of every batch
+        const double counted_bytes = static_cast<double>( batches ) * iterations * size;
+        const double cycles = counters.value( perf_counter::CYCLES );
+        const double instructions = counters.value( perf_counter::INSTRUCTIONS );
+
+        const std::string counter_fields[] = {
+            counter_field( cycles, counted_bytes ),
+            counter_field( cycles >= 0 ? instructions : -1.0, cycles ),
+            counter_field( instructions, counted_bytes ),
+            counter_field( counters.value( perf_counter::CACHE_MISSES ), counted_bytes / 1024 ),
+            counter_field( counters.value( perf_counter::BRANCH_MISSES ), counted_bytes / 1024 ),
+            counter_field( counters.value( perf_counter::LLC_LOAD_MISSES ), counted_bytes / 1024 ),
+        };
+
+        if ( format == sweep_format::csv ) {
+            std::cout << path << "," << size << "," << iterations << "," << ns_per_op << "," << gbps << "," << cycles_per_byte;
+            for ( auto const& field : counter_fields ) {
+                std::cout << "," << field;
+            }
+            std::cout << "\n";
+        } else {
+            std::cout << ( first_row ? "\n" : ",\n" )
+                << "    { \"path\": \"" << path << "\", \"bytes\": " << size << ", \"iterations\": " << iterations
+                << ", \"ns_per_op\": " << ns_per_op << ", \"gb_per_s\": " << gbps << ", \"cycles_per_byte\": " << cycles_per_byte
+                << ", \"core_cycles_per_byte\": " << counter_fields[0] << ", \"ipc\": " << counter_fields[1]
+                << ", \"instructions_per_byte\": " << counter_fields[2] << ", \"cache_misses_per_kb\": " << counter_fields[3]
+                << ", \"branch_misses_per_kb\": " << counter_fields[4] << ", \"llc_load_misses_per_kb\": " << counter_fields[5] << " }";
+        }
+
+        first_row = false;
+        return true;
+    };
+
+    // reused by the streaming path
+    std::vector<unsigned char> stream_buffer;
+
+    for ( uint64_t size = min_size ; size <= max_size ; size *= 4 ) {
+
+        // in memory: the xor kernel over preallocated buffers; skipped when the buffers do not fit
+        try {
+            const std::vector<unsigned char> key( size, 0x5a );
+            const std::vector<unsigned char> plaintext( size, 0xa5 );
+            std::vector<unsigned char> ciphertext( size );
+
+            measure( "memory", size, memory_bytes, 1 << 20, [&]() {
+                xor_bytes( ciphertext.data(), plaintext.data(), key.data(), size );
+                return true;
+            } );
+        } catch ( std::bad_alloc const& ) {
+            std::cerr << "skipping memory path at " << size << " bytes: out of memory" << std::endl;
+        }
+
+        // create the input files for the file paths
+        if ( !create_test_file( key_file, size, 0x5a ) || !create_test_file( input_file, size, 0xa5 ) ) {
+            std::cerr << "failed to create size sweep test files" << std::endl;
+            break;
+        }
+
+        // streaming: fixed size chunks through a reused buffer
+        const bool stream_status = measure( "stream", size, file_bytes, 100, [&]() {
+            return stream_xor_file( key_file, input_file, output_file, stream_buffer );
+        } );
+
+        // file to file: positioned reads and writes of whole ranges
+        const bool file_status = stream_status && measure( "file", size, file_bytes, 100, [&]() {
+            return parallel_xor_file( key_file, input_file, output_file, 1 );
+        } );
+
+        // file to file: memory mappings of all three files
+        const bool mmap_status = file_status && measure( "mmap", size, file_bytes, 100, [&]() {
+            return mmap_xor_file( key_file, input_file, output_file, 1 );
+        } );
+
+        if ( !mmap_status ) {
+            std::cerr << "size sweep test failed" << std::endl;
+            break;
+        }
+    }
+
+    if ( format == sweep_format::json ) {
+        std::cout << "\n  ]\n}\n";
+    }
+
+    // remove the test files
+    unlink( key_file );
+    unlink( input_file );
+    unlink( output_file );
+}
+
+/**
+ * @brief measure the throughput of every xor kernel supported by the cpu
+ */
+static void test_xor_kernel_throughput( void )
 {
-    // security parameter is 128 bits
-    const unsigned int security_parameter = 128;
+    // buffer sizes chosen to fit in l1, l2, and main memory respectively
+    const size_t sizes[] = { 16 * 1024, 256 * 1024, 64 * 1024 * 1024 };
+
+    // number of bytes processed per measurement
+    const size_t bytes_per_test = size_t{ 1 } * 1024 * 1024 * 1024;
+
+    std::cout << "xor kernel throughput test results\n";
+    std::cout << " kernel |     size | throughput\n";
+    std::cout << " ------ | -------- | ----------\n";
+
+    for ( const auto size : sizes ) {
+
+        // allocate inputs and an output buffer; data values do not affect xor throughput
+        const std::vector<unsigned char> key( size, 0x5a );
+        const std::vector<unsigned char> plaintext( size, 0xa5 );
+        std::vector<unsigned char> ciphertext( size );
+
+        // get the number of passes over the buffers
+        const size_t passes = std::max<size_t>( 1, bytes_per_test / size );
+
+        for ( const auto& kernel : supported_xor_kernels() ) {
+
+            // get the time point at the beginning of the test run
+            const auto start_time = std::chrono::high_resolution_clock::now();
 
-    // get key size in bytes
-    const unsigned int security_parameter_bytes = ( security_parameter + 8 - 1 ) / 8;
+            // combine the buffers repeatedly
+            for ( size_t i = 0 ; i < passes ; ++i ) {
+                kernel.fn( ciphertext.data(), plaintext.data(), key.data(), size );
+            }
 
-    // set the number of iterations
-    const unsigned int runs = 5000;
+            // get the time point at the end of the test run
+            const auto end_time = std::chrono::high_resolution_clock::now();
 
-    // allocate an array with an element for each test run
-    std::vector<std::chrono::high_resolution_clock::duration> results( runs );
+            // calculate throughput in bytes per nanosecond which is equal to GB/s
+            const double seconds = std::chrono::duration<double>( end_time - start_time ).count();
+            const double gbps = passes * size / seconds / 1e9;
 
-    // generate a random key
-    const auto key = keygen( security_parameter_bytes );
+            std::cout << " " << std::setw( 6 ) << kernel.name
+                << " | " << std::setw( 6 ) << size / 1024 << "KB"
+                << " | " << std::setw( 6 ) << std::fixed << std::setprecision( 2 ) << gbps << " GB/s\n";
+        }
+    }
+
+    std::cout << "\n";
+}
 
-    // generate a random plaintext
-    const auto plaintext = keygen( security_parameter_bytes );
+/**
+ * @brief measure the throughput of every base64 codec supported by the cpu
+ */
+static void test_base64_throughput( void )
+{
+    // set the parameters for the test
+    const size_t size = 1024 * 1024;
+    const size_t passes = 256;
 
-    // run the test repeatedly
-    for ( unsigned int i = 0 ; i < runs ; ++i ) {
+    // fill the input with key material so every table entry is exercised
+    std::vector<unsigned char> data( size );
+    keygen( data.data(), data.size() );
+    std::vector<char> text( base64_encoded_size( size ) );
+    std::vector<unsigned char> decoded( size );
 
-        // get the time point at the beginning of the test run
+    // measure the throughput of an operation in input GB/s
+    auto measure = [&]( size_t bytes, auto const& operation ) {
         const auto start_time = std::chrono::high_resolution_clock::now();
+        for ( size_t i = 0 ; i < passes ; ++i ) {
+            operation();
+        }
+        const auto end_time = std::chrono::high_resolution_clock::now();
+        return passes * bytes / std::chrono::duration<double>( end_time - start_time ).count() / 1e9;
+    };
+
+    std::cout << "base64 throughput test results\n";
+    std::cout << "  codec |   encode |   decode\n";
+    std::cout << " ------ | -------- | --------\n";
+
+    // memcpy of the same data is the upper bound for either direction
+    const double copy = measure( size, [&](){ memcpy( decoded.data(), data.data(), size ); } );
+    std::cout << " memcpy | " << std::setw( 8 ) << std::fixed << std::setprecision( 2 ) << copy << " | " << std::setw( 8 ) << copy << " GB/s\n";
+
+    for ( const auto& codec : supported_base64_codecs() ) {
+        size_t decoded_size = 0;
+        const double encode = measure( size, [&](){ codec.encode( text.data(), data.data(), size ); } );
+        const double decode = measure( text.size(), [&](){ codec.decode( decoded.data(), decoded_size, text.data(), text.size() ); } );
 
-        // allocate a buffer for the ciphertext
-        std::vector<unsigned char> ciphertext( plaintext.size() );
+        // verify the round trip
+        const bool valid = decoded_size == size && decoded == data;
 
-        // combine the plaintext with the key to create the ciphertext
-        for ( size_t i = 0 ; i < ciphertext.size() ; ++i ) {
-            ciphertext[i] = plaintext[i] ^ key[i];
+        std::cout << " " << std::setw( 6 ) << codec.name
+            << " | " << std::setw( 8 ) << encode
+            << " | " << std::setw( 8 ) << decode << " GB/s" << ( valid ? "" : " (round trip FAILED)" ) << "\n";
+    }
+
+    std::cout << "\n";
+}
+
+/**
+ * @brief write a file back and drop it from the page cache so the next read comes from the device
+ *
+ * @param path path of the file
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool evict_file( const char* path )
+{
+    const int fd = open( path, O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 ) {
+        return false;
+    }
+
+    // dirty pages cannot be dropped, so write them back first
+    const bool status = fdatasync( fd ) == 0 && posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED ) == 0;
+
+    return close( fd ) == 0 && status;
+}
+
+/**
+ * @brief compare the io_uring backend at several queue depths against the blocking streaming path on a cold page cache
+ */
+static void test_uring_queue_depth( void )
+{
+    // set the parameters for the test
+    const char key_file[]    = "uring_key.bin";
+    const char input_file[]  = "uring_input.bin";
+    const char output_file[] = "uring_output.bin";
+    const size_t file_size   = 256 * 1024 * 1024;
+
+    if ( !create_test_file( key_file, file_size, 0x5a ) || !create_test_file( input_file, file_size, 0xa5 ) ) {
+        std::cerr << "failed to create io_uring test files" << std::endl;
+        return;
+    }
+
+    // time one run starting from a cold page cache; like otp itself the run does not wait for writeback
+    auto measure = [&]( auto const& operation ) {
+        if ( !evict_file( key_file ) || !evict_file( input_file ) ) {
+            return 0.0;
+        }
+
+        const auto start_time = std::chrono::steady_clock::now();
+        const bool status = operation();
+        const auto end_time = std::chrono::steady_clock::now();
+
+        // keep the dirty output from slowing down the next run
+        return status && evict_file( output_file ) ? file_size / std::chrono::duration<double>( end_time - start_time ).count() / 1e9 : 0.0;
+    };
+
+    std::cout << "io_uring queue depth test results\n";
+    std::cout << " file size = " << file_size / ( 1024 * 1024 ) << " MB, cold page cache\n";
+    std::cout << " path     | depth | throughput   | speedup\n";
+    std::cout << " -------- | ----- | ------------ | -------\n";
+
+    // the blocking streaming path is the baseline
+    std::vector<unsigned char> buffer;
+    const double baseline = measure( [&]() { return stream_xor_file( key_file, input_file, output_file, buffer ); } );
+
+    std::cout << " blocking | " << std::setw( 5 ) << 1
+        << " | " << std::setw( 7 ) << std::fixed << std::setprecision( 2 ) << baseline << " GB/s"
+        << " | " << std::setw( 6 ) << 1.0 << "x\n";
+
+    for ( unsigned int depth = 1 ; depth <= 64 ; depth *= 2 ) {
+
+        const double gbps = measure( [&]() { return uring_xor_file( key_file, input_file, output_file, depth ); } );
+
+        std::cout << " io_uring | " << std::setw( 5 ) << depth
+            << " | " << std::setw( 7 ) << gbps << " GB/s"
+            << " | " << std::setw( 6 ) << ( baseline > 0 ? gbps / baseline : 0.0 ) << "x\n";
+    }
+
+    std::cout << "\n";
+
+    // remove the test files
+    unlink( key_file );
+    unlink( input_file );
+    unlink( output_file );
+}
+
+/**
+ * @brief measure single stream throughput from an input pipe through the xor kernel to an output pipe
+ */
+static void test_pipe_throughput( void )
+{
+    // set the parameters for the test
+    const char key_file[]   = "pipe_key.bin";
+    const uint64_t size     = 256 * 1024 * 1024;
+    const size_t chunk_size = 1024 * 1024;
+
+    if ( !create_test_file( key_file, size, 0x5a ) ) {
+        std::cerr << "failed to create pipe test files" << std::endl;
+        return;
+    }
+
+    // move data from a producer thread through a transfer step to a consumer thread
+    auto measure = [&]( auto const& transfer ) {
+        int input_pipe[2];
+        int output_pipe[2];
+
+        if ( pipe( input_pipe ) != 0 || pipe( output_pipe ) != 0 ) {
+            return 0.0;
         }
 
-        // get the time point at the end of the test run
+        const auto start_time = std::chrono::steady_clock::now();
+
+        // the producer writes the input data
+        std::thread producer( [&]() {
+            const std::vector<unsigned char> data( chunk_size, 0xa5 );
+            for ( uint64_t written = 0 ; written < size ; written += chunk_size ) {
+                write_fully( input_pipe[1], data.data(), chunk_size );
+            }
+            close( input_pipe[1] );
+        } );
+
+        // the consumer drains the output
+        std::thread consumer( [&]() {
+            std::vector<unsigned char> data( chunk_size );
+            while ( read_fully( output_pipe[0], data.data(), chunk_size ).second > 0 ) {
+            }
+            close( output_pipe[0] );
+        } );
+
+        const bool status = transfer( input_pipe[0], output_pipe[1] );
+        close( input_pipe[0] );
+        close( output_pipe[1] );
+
+        producer.join();
+        consumer.join();
+
+        const auto end_time = std::chrono::steady_clock::now();
+
+        return status ? size / std::chrono::duration<double>( end_time - start_time ).count() / 1e9 : 0.0;
+    };
+
+    // copying between the pipes without xor is the reference
+    const double relay = measure( []( int input_fd, int output_fd ) {
+        std::vector<unsigned char> data( chunk_size );
+        for ( ;; ) {
+            const auto data_read = read_fully( input_fd, data.data(), data.size() );
+            if ( !data_read.first || data_read.second == 0 ) {
+                return data_read.first;
+            }
+            if ( !write_fully( output_fd, data.data(), data_read.second ) ) {
+                return false;
+            }
+        }
+    } );
+
+    // stream the data through the xor kernel and splice it into the output pipe
+    const double spliced = measure( [&]( int input_fd, int output_fd ) {
+        const int key_fd = open_input_file( key_file );
+        std::vector<unsigned char> buffer;
+        const bool status = key_fd >= 0 && stream_xor( key_fd, key_file, input_fd, "input pipe", output_fd, "output pipe", STREAM_TO_END, buffer );
+        close( key_fd );
+        return status;
+    } );
+
+    std::cout << "pipe throughput test results\n";
+    std::cout << " data size              = " << size / ( 1024 * 1024 ) << " MB\n";
+    std::cout << " read/write relay       = " << std::setw( 10 ) << std::fixed << std::setprecision( 2 ) << relay << " GB/s\n";
+    std::cout << " stream_xor to vmsplice = " << std::setw( 10 ) << spliced << " GB/s\n";
+    std::cout << "\n";
+
+    // remove the test files
+    unlink( key_file );
+}
+
+/**
+ * @brief measure key generation throughput against the previous per-byte random_device generator
+ */
+static void test_keygen_throughput( void )
+{
+    // set the parameters for the test
+    const size_t reference_size = 4 * 1024 * 1024;
+    const size_t bulk_size      = 256 * 1024 * 1024;
+
+    // measure the throughput of a generator filling a buffer
+    auto measure = []( size_t size, auto const& generate ) {
+        std::vector<unsigned char> data( size );
+        const auto start_time = std::chrono::high_resolution_clock::now();
+        generate( data );
         const auto end_time = std::chrono::high_resolution_clock::now();
+        return size / std::chrono::duration<double>( end_time - start_time ).count() / 1e6;
+    };
+
+    // the generator keygen() used before: one random_device call per byte
+    const double reference = measure( reference_size, []( std::vector<unsigned char>& data ) {
+        std::random_device rd;
+        std::uniform_int_distribution<unsigned char> dist;
+        std::generate( data.begin(), data.end(), [&](){ return dist( rd ); } );
+    } );
+
+    // the buffered generator filling one large buffer
+    const double bulk = measure( bulk_size, []( std::vector<unsigned char>& data ) {
+        keygen( data.data(), data.size() );
+    } );
 
-        // calculate the elapsed time for the test run
-        const auto duration = end_time - start_time;
-
-        // record the duration
-        results[i] = duration;
-
-    }
-
-    // get the total run time of all test runs
-    const std::chrono::high_resolution_clock::duration total_runtime = std::accumulate(
-        results.begin(),
-        results.end(),
-        std::chrono::high_resolution_clock::duration{ 0 },
-        [&]( auto const& run, auto const& cur ) { return run + cur; }
-    );
-
-    // sort the result data
-    std::sort( results.begin(), results.end() );
-
-    // calculate stats
-    const auto min    = std::chrono::duration_cast<std::chrono::nanoseconds>( results[0] ).count();
-    const auto max    = std::chrono::duration_cast<std::chrono::nanoseconds>( results[results.size() - 1] ).count();
-    const auto total  = std::chrono::duration_cast<std::chrono::nanoseconds>( total_runtime ).count();
-    const auto mean   = std::chrono::duration_cast<std::chrono::nanoseconds>( total_runtime / runs ).count();;
-
-    // calculate the median
-    const auto median = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        ( results.size() % 1 ) ?
-        results[results.size() / 2 + 1] :
-        ( results[results.size() / 2] + results[results.size() / 2 + 1] ) / 2 ).count();
-
-    // calculate the variance
-    const auto variance = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::accumulate(
-            results.begin(),
-            results.end(),
-            std::chrono::high_resolution_clock::duration{ 0 },
-            [&]( const auto& run, const auto& cur ) { return run + ( cur - ( total_runtime / runs ) ) * 2; }
-        )
-    ).count();
-
-    // output parameters to the cli
-    std::cout << "run time test parameters\n";
-    std::cout << " security parameter = " << security_parameter_bytes * 8 << " bits\n";
-    std::cout << " iterations         = " << runs << "\n";
+    // the buffered generator producing many aes sized keys
+    const double small = measure( reference_size, []( std::vector<unsigned char>& data ) {
+        for ( size_t i = 0 ; i < data.size() ; i += 32 ) {
+            keygen( data.data() + i, 32 );
+        }
+    } );
+
+    std::cout << "keygen throughput test results\n";
+    std::cout << " per-byte random_device = " << std::setw( 10 ) << std::fixed << std::setprecision( 2 ) << reference << " MB/s\n";
+    std::cout << " chacha20 32 byte keys  = " << std::setw( 10 ) << small << " MB/s\n";
+    std::cout << " chacha20 bulk fill     = " << std::setw( 10 ) << bulk << " MB/s\n";
     std::cout << "\n";
+}
+
+/**
+ * @brief measure how the file to file xor speeds up as worker threads are added
+ */
+static void test_thread_scaling( void )
+{
+    // set the parameters for the test
+    const char key_file[]    = "xor_key.bin";
+    const char input_file[]  = "xor_input.bin";
+    const char output_file[] = "xor_output.bin";
+    const size_t file_size   = 256 * 1024 * 1024;
+    const unsigned int runs  = 3;
+
+    // create the input files; repeated runs keep them in the page cache
+    if ( !create_test_file( key_file, file_size, 0x5a ) || !create_test_file( input_file, file_size, 0xa5 ) ) {
+        std::cerr << "failed to create thread scaling test files" << std::endl;
+        return;
+    }
+
+    // sweep thread counts up to twice the number of hardware threads
+    const unsigned int max_threads = std::max( 2u, 2 * std::thread::hardware_concurrency() );
+
+    std::cout << "thread scaling test results\n";
+    std::cout << " file size = " << file_size / ( 1024 * 1024 ) << " MB\n";
+    std::cout << " threads | throughput   | speedup\n";
+    std::cout << " ------- | ------------ | -------\n";
+
+    double baseline = 0;
+
+    for ( unsigned int threads = 1 ; threads <= max_threads ; threads *= 2 ) {
 
-    // output results to the cli
-    std::cout << "run time test results\n";
-    std::cout << " min run time      = " << std::setw( 10 ) << min      << " ns\n";
-    std::cout << " max run time      = " << std::setw( 10 ) << max      << " ns\n";
-    std::cout << " mean run time     = " << std::setw( 10 ) << mean     << " ns\n";
-    std::cout << " run time variance = " << std::setw( 10 ) << variance << " ns\n";
-    std::cout << " median run time   = " << std::setw( 10 ) << median   << " ns\n";
-    std::cout << " total run time    = " << std::setw( 10 ) << total    << " ns\n";
+        // keep the best of several runs to reduce noise
+        double best = 0;
+
+        for ( unsigned int i = 0 ; i < runs ; ++i ) {
+
+            const auto start_time = std::chrono::high_resolution_clock::now();
+
+            if ( !parallel_xor_file( key_file, input_file, output_file, threads ) ) {
+                std::cerr << "thread scaling test failed" << std::endl;
+                return;
+            }
+
+            const auto end_time = std::chrono::high_resolution_clock::now();
+
+            const double seconds = std::chrono::duration<double>( end_time - start_time ).count();
+            best = std::max( best, file_size / seconds / 1e9 );
+        }
+
+        // use the single threaded run as the speedup baseline
+        if ( threads == 1 ) {
+            baseline = best;
+        }
+
+        std::cout << " " << std::setw( 7 ) << threads
+            << " | " << std::setw( 7 ) << std::fixed << std::setprecision( 2 ) << best << " GB/s"
+            << " | " << std::setw( 6 ) << best / baseline << "x\n";
+    }
+
+    std::cout << "\n";
+
+    // remove the test files
+    unlink( key_file );
+    unlink( input_file );
+    unlink( output_file );
 }
 
 int main( int argc, const char *argv[] )
 {
-    test_running_time();
+    // largest payload of the size sweep and its output format
+    uint64_t max_size = 256 * 1024 * 1024;
+    sweep_format format = sweep_format::csv;
+
+    // with arguments only the size sweep runs so its output can be redirected as is
+    for ( int i = 1 ; i < argc ; ++i ) {
+        const std::string argument = argv[i];
+
+        if ( argument == "--csv" ) {
+            format = sweep_format::csv;
+        } else if ( argument == "--json" ) {
+            format = sweep_format::json;
+        } else if ( ( max_size = parse_size( argv[i] ) ) < 16 ) {
+            std::cerr << "usage: " << argv[0] << " [--csv|--json] [max_size[K|M|G]]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ( argc > 1 ) {
+        test_size_sweep( max_size, format );
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << "size sweep test results\n";
+    test_size_sweep( max_size, format );
+    std::cout << "\n";
+    test_xor_kernel_throughput();
+    test_thread_scaling();
+    test_pipe_throughput();
+    test_uring_queue_depth();
+    test_keygen_throughput();
+    test_base64_throughput();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,462 @@
+#include "uring_xor.h"
+#include "file_io.h"
+#include "stream_xor.h"
+#include "xor_kernel.h"
+#include <algorithm>
+#include <errno.h>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief io_uring instance with its submission and completion rings mapped
+ */
+struct uring
+{
+    int fd = -1;
+
+    // submission ring
+    void* sq_map = MAP_FAILED;
+    size_t sq_map_size = 0;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    // completion ring; shares the submission mapping on kernels that support it
+    void* cq_map = MAP_FAILED;
+    size_t cq_map_size = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    // number of queued entries not yet passed to the kernel
+    unsigned int pending = 0;
+
+    // number of queued entries whose completion has not been taken from the ring
+    unsigned int outstanding = 0;
+};
+
+/**
+ * @brief unmap the rings and close an io_uring instance
+ */
+static void uring_close( uring& ring )
+{
+    if ( ring.sqes != nullptr ) {
+        munmap( ring.sqes, ring.sqes_size );
+    }
+
+    if ( ring.cq_map != MAP_FAILED && ring.cq_map != ring.sq_map ) {
+        munmap( ring.cq_map, ring.cq_map_size );
+    }
+
+    if ( ring.sq_map != MAP_FAILED ) {
+        munmap( ring.sq_map, ring.sq_map_size );
+    }
+
+    if ( ring.fd >= 0 ) {
+        close( ring.fd );
+    }
+}
+
+/**
+ * @brief create an io_uring instance and map its rings
+ *
+ * @param ring instance to set up
+ * @param entries number of submission entries
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool uring_open( uring& ring, unsigned int entries )
+{
+    io_uring_params params;
+    memset( &params, 0, sizeof( params ) );
+
+    ring.fd = static_cast<int>( syscall( __NR_io_uring_setup, entries, &params ) );
+
+    if ( ring.fd < 0 ) {
+        return false;
+    }
+
+    // map the submission ring, and the completion ring with it when the kernel allows
+    ring.sq_map_size = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+    ring.cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+
+    const bool single_map = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+
+    if ( single_map ) {
+        ring.sq_map_size = ring.cq_map_size = std::max( ring.sq_map_size, ring.cq_map_size );
+    }
+
+    ring.sq_map = mmap( nullptr, ring.sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING );
+
+    if ( ring.sq_map == MAP_FAILED ) {
+        return false;
+    }
+
+    ring.cq_map = single_map ? ring.sq_map :
+        mmap( nullptr, ring.cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING );
+
+    if ( ring.cq_map == MAP_FAILED ) {
+        return false;
+    }
+
+    // map the submission entries
+    ring.sqes_size = params.sq_entries * sizeof( io_uring_sqe );
+    void* const sqes = mmap( nullptr, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES );
+
+    if ( sqes == MAP_FAILED ) {
+        return false;
+    }
+
+    ring.sqes = static_cast<io_uring_sqe*>( sqes );
+
+    // locate the ring fields within the mappings
+    unsigned char* const sq = static_cast<unsigned char*>( ring.sq_map );
+    unsigned char* const cq = static_cast<unsigned char*>( ring.cq_map );
+    ring.sq_head  = reinterpret_cast<unsigned*>( sq + params.sq_off.head );
+    ring.sq_tail  = reinterpret_cast<unsigned*>( sq + params.sq_off.tail );
+    ring.sq_mask  = reinterpret_cast<unsigned*>( sq + params.sq_off.ring_mask );
+    ring.sq_array = reinterpret_cast<unsigned*>( sq + params.sq_off.array );
+    ring.cq_head  = reinterpret_cast<unsigned*>( cq + params.cq_off.head );
+    ring.cq_tail  = reinterpret_cast<unsigned*>( cq + params.cq_off.tail );
+    ring.cq_mask  = reinterpret_cast<unsigned*>( cq + params.cq_off.ring_mask );
+    ring.cqes     = reinterpret_cast<io_uring_cqe*>( cq + params.cq_off.cqes );
+
+    return true;
+}
+
+/**
+ * @brief queue a read or write of a byte range
+ *
+ * The ring always has room because each chunk has at most two operations in flight.
+ *
+ * @param ring io_uring instance
+ * @param opcode read or write opcode, fixed buffer or not
+ * @param fd file descriptor
+ * @param data buffer
+ * @param len number of bytes
+ * @param offset file offset
+ * @param buffer_index index of the registered buffer holding data; ignored for unregistered opcodes
+ * @param user_data value returned with the completion
+ */
+static void uring_queue(
+    uring& ring,
+    uint8_t opcode,
+    int fd,
+    unsigned char* data,
+    uint32_t len,
+    uint64_t offset,
+    uint16_t buffer_index,
+    uint64_t user_data )
+{
+    const unsigned tail = *ring.sq_tail;
+    const unsigned index = tail & *ring.sq_mask;
+
+    io_uring_sqe& sqe = ring.sqes[index];
+    memset( &sqe, 0, sizeof( sqe ) );
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>( data );
+    sqe.len = len;
+    sqe.off = offset;
+    sqe.buf_index = buffer_index;
+    sqe.user_data = user_data;
+
+    // publish the entry before the new tail
+    ring.sq_array[index] = index;
+    __atomic_store_n( ring.sq_tail, tail + 1, __ATOMIC_RELEASE );
+    ++ring.pending;
+    ++ring.outstanding;
+}
+
+/**
+ * @brief pass queued entries to the kernel and wait for at least one completion
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool uring_submit_and_wait( uring& ring )
+{
+    for ( ;; ) {
+        const long submitted = syscall( __NR_io_uring_enter, ring.fd, ring.pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0 );
+
+        if ( submitted >= 0 ) {
+            ring.pending -= static_cast<unsigned int>( submitted );
+            return true;
+        }
+
+        if ( errno != EINTR ) {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief take the next completion from the ring if there is one
+ *
+ * @return true and the completion if one was available; false otherwise;
+ */
+static std::pair<bool, io_uring_cqe> uring_next_completion( uring& ring )
+{
+    const unsigned head = *ring.cq_head;
+
+    if ( head == __atomic_load_n( ring.cq_tail, __ATOMIC_ACQUIRE ) ) {
+        return std::make_pair( false, io_uring_cqe{} );
+    }
+
+    const io_uring_cqe cqe = ring.cqes[head & *ring.cq_mask];
+    __atomic_store_n( ring.cq_head, head + 1, __ATOMIC_RELEASE );
+    --ring.outstanding;
+
+    return std::make_pair( true, cqe );
+}
+
+/**
+ * @brief wait until the kernel is done with every operation that was passed to it
+ *
+ * Closing the ring does not wait for operations in flight, so after an error their buffers
+ * must stay mapped until this returns true. Entries not yet passed to the kernel are dropped.
+ *
+ * @return true if no operation is left in flight; false otherwise;
+ */
+static bool uring_drain( uring& ring )
+{
+    // the kernel has not read the entries past its head yet, so they can be taken back
+    __atomic_store_n( ring.sq_tail, *ring.sq_tail - ring.pending, __ATOMIC_RELEASE );
+    ring.outstanding -= ring.pending;
+    ring.pending = 0;
+
+    // discard completions until the last one has arrived
+    while ( ring.outstanding > 0 ) {
+        if ( !uring_submit_and_wait( ring ) ) {
+            return false;
+        }
+
+        while ( uring_next_completion( ring ).first ) {
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief one chunk of the file moving through the read, xor, and write stages
+ */
+struct uring_chunk
+{
+    uint64_t offset = 0;
+    uint32_t length = 0;
+
+    // bytes completed by each operation; short transfers are resubmitted for the rest
+    uint32_t data_done = 0;
+    uint32_t key_done = 0;
+    uint32_t write_done = 0;
+
+    // true once the chunk was combined and its write was queued
+    bool writing = false;
+};
+
+bool uring_xor_file( const char* key_path, const char* input_path, const char* output_path, unsigned int queue_depth )
+{
+    // operations are identified by chunk index and kind in the completion user data
+    enum : uint64_t { OP_DATA = 0, OP_KEY = 1, OP_WRITE = 2, OP_KINDS = 3 };
+
+    // registered buffer indices are 16 bits wide and the kernel limits their number
+    queue_depth = std::min( std::max( queue_depth, 1u ), URING_MAX_QUEUE_DEPTH );
+
+    // get the size of the input
+    const auto input_size = get_file_size( input_path );
+
+    if ( !input_size.first ) {
+        return false;
+    }
+
+    // set up the ring with room for a read of the key and the data of every chunk
+    uring ring;
+
+    if ( !uring_open( ring, 2 * queue_depth ) ) {
+        std::cerr << "ERROR: io_uring is not available (" << strerror( errno ) << ")\n";
+        uring_close( ring );
+        return false;
+    }
+
+    // open the key, input, and output files
+    const int key_fd = open_input_file( key_path );
+
+    if ( key_fd < 0 ) {
+        uring_close( ring );
+        return false;
+    }
+
+    const int input_fd = open_input_file( input_path );
+
+    if ( input_fd < 0 ) {
+        close( key_fd );
+        uring_close( ring );
+        return false;
+    }
+
+    // an output that is also an input is rewritten in place; each chunk is read before it is written back
+    const int output_fd = open_xor_output_file( key_path, input_path, output_path );
+
+    if ( output_fd < 0 ) {
+        close( input_fd );
+        close( key_fd );
+        uring_close( ring );
+        return false;
+    }
+
+    bool status = true;
+
+    // size the output up front so chunks can be written in any order
+    if ( ftruncate( output_fd, input_size.second ) != 0 ) {
+        std::cerr << "ERROR: failed to write to file '" << output_path << "'\n";
+        status = false;
+    }
+
+    // allocate a data and a key buffer for every chunk in one page aligned mapping
+    const size_t buffers_size = 2 * size_t{ queue_depth } * STREAM_CHUNK_SIZE;
+    void* const buffers_map = mmap( nullptr, buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+    if ( buffers_map == MAP_FAILED ) {
+        std::cerr << "ERROR: failed to allocate io_uring buffers\n";
+        status = false;
+    }
+
+    unsigned char* const buffers = static_cast<unsigned char*>( buffers_map );
+
+    // register the buffers so the kernel does not map them for every operation; without
+    // registration, for example when the locked memory limit is low, plain reads and writes are used
+    bool fixed = false;
+
+    if ( status ) {
+        std::vector<iovec> iovecs( 2 * queue_depth );
+        for ( size_t i = 0 ; i < iovecs.size() ; ++i ) {
+            iovecs[i].iov_base = buffers + i * STREAM_CHUNK_SIZE;
+            iovecs[i].iov_len = STREAM_CHUNK_SIZE;
+        }
+        fixed = syscall( __NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, iovecs.data(), iovecs.size() ) == 0;
+    }
+
+    const uint8_t read_opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    const uint8_t write_opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+
+    std::vector<uring_chunk> chunks( queue_depth );
+    uint64_t next_offset = 0;
+    unsigned int in_flight = 0;
+
+    // get the data and key buffers of a chunk and their registered indices
+    auto data_buffer = [&]( uint64_t index ) { return buffers + ( 2 * index ) * STREAM_CHUNK_SIZE; };
+    auto key_buffer = [&]( uint64_t index ) { return buffers + ( 2 * index + 1 ) * STREAM_CHUNK_SIZE; };
+
+    // queue the reads of the next unread part of the file into a chunk
+    auto start_chunk = [&]( uint64_t index ) {
+        uring_chunk& chunk = chunks[index];
+        chunk = uring_chunk();
+        chunk.offset = next_offset;
+        chunk.length = static_cast<uint32_t>( std::min<uint64_t>( STREAM_CHUNK_SIZE, input_size.second - next_offset ) );
+        next_offset += chunk.length;
+        ++in_flight;
+
+        uring_queue( ring, read_opcode, input_fd, data_buffer( index ), chunk.length, chunk.offset,
+            static_cast<uint16_t>( 2 * index ), index * OP_KINDS + OP_DATA );
+        uring_queue( ring, read_opcode, key_fd, key_buffer( index ), chunk.length, chunk.offset,
+            static_cast<uint16_t>( 2 * index + 1 ), index * OP_KINDS + OP_KEY );
+    };
+
+    // fill the queue
+    for ( uint64_t index = 0 ; status && index < queue_depth && next_offset < input_size.second ; ++index ) {
+        start_chunk( index );
+    }
+
+    // process completions until every chunk has been written
+    while ( status && in_flight > 0 ) {
+
+        if ( !uring_submit_and_wait( ring ) ) {
+            std::cerr << "ERROR: io_uring submission failed (" << strerror( errno ) << ")\n";
+            status = false;
+            break;
+        }
+
+        for ( auto completion = uring_next_completion( ring ) ; status && completion.first ; completion = uring_next_completion( ring ) ) {
+
+            const uint64_t index = completion.second.user_data / OP_KINDS;
+            const uint64_t kind = completion.second.user_data % OP_KINDS;
+            const int result = completion.second.res;
+            uring_chunk& chunk = chunks[index];
+
+            // a failed operation or a file that ended early stops the pipeline
+            if ( result <= 0 ) {
+                const char* const path = kind == OP_WRITE ? output_path : ( kind == OP_KEY ? key_path : input_path );
+                std::cerr << "ERROR: failed to " << ( kind == OP_WRITE ? "write to" : "read from" ) << " file '" << path << "'"
+                    << ( result < 0 ? std::string( " (" ) + strerror( -result ) + ")" : std::string() ) << "\n";
+                status = false;
+                break;
+            }
+
+            // account for the completed bytes and resubmit the rest of a short transfer
+            uint32_t& done = kind == OP_WRITE ? chunk.write_done : ( kind == OP_KEY ? chunk.key_done : chunk.data_done );
+            done += static_cast<uint32_t>( result );
+
+            if ( done < chunk.length ) {
+                const int fd = kind == OP_WRITE ? output_fd : ( kind == OP_KEY ? key_fd : input_fd );
+                unsigned char* const buffer = kind == OP_KEY ? key_buffer( index ) : data_buffer( index );
+                uring_queue( ring, kind == OP_WRITE ? write_opcode : read_opcode, fd, buffer + done, chunk.length - done,
+                    chunk.offset + done, static_cast<uint16_t>( kind == OP_KEY ? 2 * index + 1 : 2 * index ), completion.second.user_data );
+                continue;
+            }
+
+            if ( kind == OP_WRITE ) {
+
+                // the chunk is finished; reuse it for the next part of the file
+                --in_flight;
+                if ( next_offset < input_size.second ) {
+                    start_chunk( index );
+                }
+
+            } else if ( !chunk.writing && chunk.data_done == chunk.length && chunk.key_done == chunk.length ) {
+
+                // both reads are complete; combine in place and queue the write from the same buffer
+                xor_bytes( data_buffer( index ), data_buffer( index ), key_buffer( index ), chunk.length );
+                chunk.writing = true;
+                uring_queue( ring, write_opcode, output_fd, data_buffer( index ), chunk.length, chunk.offset,
+                    static_cast<uint16_t>( 2 * index ), index * OP_KINDS + OP_WRITE );
+            }
+        }
+    }
+
+    // after an error, operations still in flight may write into the buffers until they complete
+    const bool drained = uring_drain( ring );
+
+    if ( !drained ) {
+        std::cerr << "ERROR: failed to wait for io_uring operations (" << strerror( errno ) << ")\n";
+        status = false;
+    }
+
+    uring_close( ring );
+
+    // leave the buffers mapped if the kernel may still be using them
+    if ( buffers_map != MAP_FAILED && drained ) {
+        munmap( buffers_map, buffers_size );
+    }
+
+    // close the output file and report any deferred write errors
+    if ( close( output_fd ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << output_path << "'\n";
+        status = false;
+    }
+
+    close( input_fd );
+    close( key_fd );
+
+    return status;
+}
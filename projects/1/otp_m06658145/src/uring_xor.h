@@ -0,0 +1,30 @@
+#ifndef URING_XOR_H
+#define URING_XOR_H
+
+/**
+ * @brief number of chunks the io_uring backend keeps in flight by default
+ */
+constexpr unsigned int URING_QUEUE_DEPTH = 16;
+
+/**
+ * @brief largest number of chunks the io_uring backend keeps in flight
+ */
+constexpr unsigned int URING_MAX_QUEUE_DEPTH = 1024;
+
+/**
+ * @brief xor an input file with a key file using asynchronous io_uring reads and writes
+ *
+ * Up to queue_depth chunks of STREAM_CHUNK_SIZE bytes are in flight at once. Each chunk's key and
+ * data reads are queued together, the chunk is combined as soon as both complete, and its write is
+ * queued from the same registered buffer while other chunks are still being read.
+ *
+ * @param key_path path of the key file
+ * @param input_path path of the input file
+ * @param output_path path of the output file
+ * @param queue_depth number of chunks in flight; clamped to 1 through URING_MAX_QUEUE_DEPTH
+ *
+ * @return true if successful; false otherwise;
+ */
+bool uring_xor_file( const char* key_path, const char* input_path, const char* output_path, unsigned int queue_depth );
+
+#endif // URING_XOR_H
@@ -0,0 +1,163 @@
+#include "xor_kernel.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#define XOR_KERNEL_X86 1
+#endif
+
+/**
+ * @brief portable xor kernel working on machine words
+ */
+static void xor_scalar( unsigned char* out, unsigned char const* a, unsigned char const* b, size_t len )
+{
+    size_t i = 0;
+
+    // combine a word at a time; memcpy keeps unaligned access well defined
+    for ( ; i + sizeof( uint64_t ) <= len ; i += sizeof( uint64_t ) ) {
+        uint64_t x;
+        uint64_t y;
+        memcpy( &x, a + i, sizeof( x ) );
+        memcpy( &y, b + i, sizeof( y ) );
+        x ^= y;
+        memcpy( out + i, &x, sizeof( x ) );
+    }
+
+    // combine the remaining bytes
+    for ( ; i < len ; ++i ) {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+#ifdef XOR_KERNEL_X86
+
+/**
+ * @brief sse2 xor kernel combining 64 bytes per iteration
+ */
+__attribute__(( target( "sse2" ) ))
+static void xor_sse2( unsigned char* out, unsigned char const* a, unsigned char const* b, size_t len )
+{
+    size_t i = 0;
+
+    for ( ; i + 64 <= len ; i += 64 ) {
+        __m128i const x0 = _mm_loadu_si128( reinterpret_cast<__m128i const*>( a + i ) );
+        __m128i const x1 = _mm_loadu_si128( reinterpret_cast<__m128i const*>( a + i + 16 ) );
+        __m128i const x2 = _mm_loadu_si128( reinterpret_cast<__m128i const*>( a + i + 32 ) );
+        __m128i const x3 = _mm_loadu_si128( reinterpret_cast<__m128i const*>( a + i + 48 ) );
+        __m128i const y0 = _mm_loadu_si128( reinterpret_cast<__m128i const*>( b + i ) );
+        __m128i const y1 = _mm_loadu_si128( reinterpret_cast<__m128i const*>( b + i + 16 ) );
+        __m128i const y2 = _mm_loadu_si128( reinterpret_cast<__m128i const*>( b + i + 32 ) );
+        __m128i const y3 = _mm_loadu_si128( reinterpret_cast<__m128i const*>( b + i + 48 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ),      _mm_xor_si128( x0, y0 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i + 16 ), _mm_xor_si128( x1, y1 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i + 32 ), _mm_xor_si128( x2, y2 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i + 48 ), _mm_xor_si128( x3, y3 ) );
+    }
+
+    for ( ; i + 16 <= len ; i += 16 ) {
+        __m128i const x = _mm_loadu_si128( reinterpret_cast<__m128i const*>( a + i ) );
+        __m128i const y = _mm_loadu_si128( reinterpret_cast<__m128i const*>( b + i ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ), _mm_xor_si128( x, y ) );
+    }
+
+    xor_scalar( out + i, a + i, b + i, len - i );
+}
+
+/**
+ * @brief avx2 xor kernel combining 128 bytes per iteration
+ */
+__attribute__(( target( "avx2" ) ))
+static void xor_avx2( unsigned char* out, unsigned char const* a, unsigned char const* b, size_t len )
+{
+    size_t i = 0;
+
+    for ( ; i + 128 <= len ; i += 128 ) {
+        __m256i const x0 = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( a + i ) );
+        __m256i const x1 = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( a + i + 32 ) );
+        __m256i const x2 = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( a + i + 64 ) );
+        __m256i const x3 = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( a + i + 96 ) );
+        __m256i const y0 = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( b + i ) );
+        __m256i const y1 = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( b + i + 32 ) );
+        __m256i const y2 = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( b + i + 64 ) );
+        __m256i const y3 = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( b + i + 96 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i ),      _mm256_xor_si256( x0, y0 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i + 32 ), _mm256_xor_si256( x1, y1 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i + 64 ), _mm256_xor_si256( x2, y2 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i + 96 ), _mm256_xor_si256( x3, y3 ) );
+    }
+
+    for ( ; i + 32 <= len ; i += 32 ) {
+        __m256i const x = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( a + i ) );
+        __m256i const y = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( b + i ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i ), _mm256_xor_si256( x, y ) );
+    }
+
+    xor_sse2( out + i, a + i, b + i, len - i );
+}
+
+/**
+ * @brief avx-512 xor kernel combining 256 bytes per iteration
+ */
+__attribute__(( target( "avx512f" ) ))
+static void xor_avx512( unsigned char* out, unsigned char const* a, unsigned char const* b, size_t len )
+{
+    size_t i = 0;
+
+    for ( ; i + 256 <= len ; i += 256 ) {
+        __m512i const x0 = _mm512_loadu_si512( a + i );
+        __m512i const x1 = _mm512_loadu_si512( a + i + 64 );
+        __m512i const x2 = _mm512_loadu_si512( a + i + 128 );
+        __m512i const x3 = _mm512_loadu_si512( a + i + 192 );
+        __m512i const y0 = _mm512_loadu_si512( b + i );
+        __m512i const y1 = _mm512_loadu_si512( b + i + 64 );
+        __m512i const y2 = _mm512_loadu_si512( b + i + 128 );
+        __m512i const y3 = _mm512_loadu_si512( b + i + 192 );
+        _mm512_storeu_si512( out + i,       _mm512_xor_si512( x0, y0 ) );
+        _mm512_storeu_si512( out + i + 64,  _mm512_xor_si512( x1, y1 ) );
+        _mm512_storeu_si512( out + i + 128, _mm512_xor_si512( x2, y2 ) );
+        _mm512_storeu_si512( out + i + 192, _mm512_xor_si512( x3, y3 ) );
+    }
+
+    for ( ; i + 64 <= len ; i += 64 ) {
+        __m512i const x = _mm512_loadu_si512( a + i );
+        __m512i const y = _mm512_loadu_si512( b + i );
+        _mm512_storeu_si512( out + i, _mm512_xor_si512( x, y ) );
+    }
+
+    xor_avx2( out + i, a + i, b + i, len - i );
+}
+
+#endif // XOR_KERNEL_X86
+
+std::vector<xor_kernel> supported_xor_kernels( void )
+{
+    std::vector<xor_kernel> kernels{ { "scalar", xor_scalar } };
+
+#ifdef XOR_KERNEL_X86
+    // query cpuid for the instruction set extensions the kernels depend on
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "sse2" ) ) {
+        kernels.push_back( { "sse2", xor_sse2 } );
+    }
+
+    if ( __builtin_cpu_supports( "avx2" ) ) {
+        kernels.push_back( { "avx2", xor_avx2 } );
+    }
+
+    if ( __builtin_cpu_supports( "avx512f" ) ) {
+        kernels.push_back( { "avx512", xor_avx512 } );
+    }
+#endif
+
+    return kernels;
+}
+
+void xor_bytes( unsigned char* out, unsigned char const* a, unsigned char const* b, size_t len )
+{
+    // select the fastest supported kernel once on first use
+    static xor_kernel_fn const kernel = supported_xor_kernels().back().fn;
+
+    kernel( out, a, b, len );
+}
@@ -0,0 +1,43 @@
+#ifndef XOR_KERNEL_H
+#define XOR_KERNEL_H
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @brief signature shared by all xor kernel implementations
+ *
+ * @param out output array; may alias a or b exactly
+ * @param a first input array
+ * @param b second input array
+ * @param len number of bytes to combine
+ */
+using xor_kernel_fn = void (*)( unsigned char* out, unsigned char const* a, unsigned char const* b, size_t len );
+
+/**
+ * @brief named xor kernel implementation
+ */
+struct xor_kernel
+{
+    char const* name;
+    xor_kernel_fn fn;
+};
+
+/**
+ * @brief combine two byte arrays with xor using the fastest kernel supported by the cpu
+ *
+ * @param out output array; may alias a or b exactly
+ * @param a first input array
+ * @param b second input array
+ * @param len number of bytes to combine
+ */
+void xor_bytes( unsigned char* out, unsigned char const* a, unsigned char const* b, size_t len );
+
+/**
+ * @brief get the xor kernels that the cpu is able to run
+ *
+ * @return vector of kernels ordered from slowest to fastest
+ */
+std::vector<xor_kernel> supported_xor_kernels( void );
+
+#endif // XOR_KERNEL_H
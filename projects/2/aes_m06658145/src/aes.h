@@ -3,8 +3,53 @@
 
 #include <openssl/aes.h>
 #include <openssl/evp.h>
+#include <stdint.h>
+#include <string.h>
 #include <vector>
 
+/**
+ * @brief non-owning view of a writable byte buffer
+ */
+struct byte_span {
+    unsigned char* data;
+    size_t size;
+};
+
+/**
+ * @brief get the buffer size that holds an iv prefix and the encryption of a message
+ *
+ * @param iv_size size of the iv prefix
+ * @param len size of the message
+ *
+ * @return number of bytes the span based encrypt() calls may write
+ */
+inline size_t ciphertext_capacity( size_t iv_size, size_t len )
+{
+    return iv_size + len + AES_BLOCK_SIZE;
+}
+
+/**
+ * @brief advance a ctr mode counter block by a number of blocks
+ *
+ * The whole 16 byte block is treated as one big endian counter as openssl does.
+ *
+ * @param counter output; the advanced counter block
+ * @param iv initial counter block
+ * @param blocks number of blocks to advance by
+ */
+inline void ctr_advance( unsigned char* const counter, unsigned char const* const iv, uint64_t blocks )
+{
+    unsigned int carry = 0;
+
+    // add the block count to the low bytes and ripple the carry through the rest
+    for ( int i = AES_BLOCK_SIZE - 1 ; i >= 0 ; --i ) {
+        unsigned int const sum = iv[i] + static_cast<unsigned int>( blocks & 0xff ) + carry;
+        counter[i] = static_cast<unsigned char>( sum );
+        carry = sum >> 8;
+        blocks >>= 8;
+    }
+}
+
 class aes
 {
 
@@ -13,20 +58,23 @@ public:
     aes() = delete;
 
     inline aes( EVP_CIPHER const* const mode, unsigned char const* const key, unsigned char const* const iv )
-        : e_ctx()
-        , d_ctx()
+        : e_ctx( EVP_CIPHER_CTX_new() )
+        , d_ctx( EVP_CIPHER_CTX_new() )
         , _key( key )
         , _iv( iv )
         , _mode( mode )
     {
-        EVP_CIPHER_CTX_init( &e_ctx );
-        EVP_CIPHER_CTX_init( &d_ctx );
+        if ( !e_ctx || !d_ctx ) {
+            EVP_CIPHER_CTX_free( e_ctx );
+            EVP_CIPHER_CTX_free( d_ctx );
+            throw "EVP_CIPHER_CTX_new() failed";
+        }
     }
 
     inline ~aes()
     {
-        if ( EVP_CIPHER_CTX_cleanup( &e_ctx ) != 1 ) { }
-        if ( EVP_CIPHER_CTX_cleanup( &d_ctx ) != 1 ) { }
+        EVP_CIPHER_CTX_free( e_ctx );
+        EVP_CIPHER_CTX_free( d_ctx );
     }
 
     aes( aes const& ) = delete;
@@ -37,65 +85,430 @@ public:
 
     aes& operator=( aes&& ) = delete;
 
-    inline std::vector<unsigned char> decrypt( unsigned char const* const ciphertext, int const ciphertext_len )
+    /**
+     * @brief decrypt into a caller provided buffer
+     *
+     * @param plaintext output; must hold ciphertext_len bytes; may be the ciphertext itself
+     * @param ciphertext ciphertext
+     * @param ciphertext_len size of the ciphertext in bytes
+     *
+     * @return number of plaintext bytes written
+     */
+    inline size_t decrypt( byte_span const plaintext, unsigned char const* const ciphertext, int const ciphertext_len )
     {
+        if ( plaintext.size < static_cast<size_t>( ciphertext_len ) ) {
+            throw "output buffer too small";
+        }
 
-        if ( EVP_DecryptInit_ex( &d_ctx, _mode, NULL, _key, _iv ) != 1 ) {
+        if ( EVP_DecryptInit_ex( d_ctx, _mode, NULL, _key, _iv ) != 1 ) {
             throw "EVP_DecryptInit_ex() failed";
         }
 
-        EVP_CIPHER_CTX_set_padding( &d_ctx, 0 );
-
-        std::vector<unsigned char> plaintext( ciphertext_len );
+        EVP_CIPHER_CTX_set_padding( d_ctx, 0 );
 
         int len;
 
-        EVP_DecryptUpdate( &d_ctx, plaintext.data(), &len, ciphertext, ciphertext_len );
+        EVP_DecryptUpdate( d_ctx, plaintext.data, &len, ciphertext, ciphertext_len );
 
         int plaintext_len = len;
 
-        if ( EVP_DecryptFinal_ex( &d_ctx, plaintext.data() + len, &len ) != 1 ) {
+        if ( EVP_DecryptFinal_ex( d_ctx, plaintext.data + len, &len ) != 1 ) {
             throw "EVP_DecryptFinal_ex() failed";
         }
 
-        plaintext_len += len;
+        return plaintext_len + len;
+    }
+
+    inline std::vector<unsigned char> decrypt( unsigned char const* const ciphertext, int const ciphertext_len )
+    {
+        std::vector<unsigned char> plaintext( ciphertext_len );
 
-        plaintext.resize( plaintext_len );
+        plaintext.resize( decrypt( byte_span{ plaintext.data(), plaintext.size() }, ciphertext, ciphertext_len ) );
 
         return plaintext;
     }
 
-    inline std::vector<unsigned char> encrypt( unsigned char const* const plaintext, int const len )
+    /**
+     * @brief encrypt into a caller provided buffer
+     *
+     * @param ciphertext output; must hold len + AES_BLOCK_SIZE bytes; may start at the plaintext itself
+     * @param plaintext plaintext
+     * @param len size of the plaintext in bytes
+     *
+     * @return number of ciphertext bytes written
+     */
+    inline size_t encrypt( byte_span const ciphertext, unsigned char const* const plaintext, int const len )
     {
+        if ( ciphertext.size < ciphertext_capacity( 0, len ) ) {
+            throw "output buffer too small";
+        }
 
-        if ( EVP_EncryptInit_ex( &e_ctx, _mode, NULL, _key, _iv ) != 1 ) {
+        if ( EVP_EncryptInit_ex( e_ctx, _mode, NULL, _key, _iv ) != 1 ) {
             throw "EVP_EncryptInit_ex() failed";
         }
 
-        int c_len = len + AES_BLOCK_SIZE;
-
-        std::vector<unsigned char> ciphertext( c_len );
+        int c_len = 0;
 
-        EVP_EncryptUpdate( &e_ctx, ciphertext.data(), &c_len, plaintext, len );
+        EVP_EncryptUpdate( e_ctx, ciphertext.data, &c_len, plaintext, len );
 
         int f_len = 0;
 
-        if ( EVP_EncryptFinal_ex( &e_ctx, ciphertext.data() + c_len, &f_len ) != 1 ) {
+        if ( EVP_EncryptFinal_ex( e_ctx, ciphertext.data + c_len, &f_len ) != 1 ) {
             throw "EVP_EncryptFinal_ex() failed";
         }
 
-        ciphertext.resize( c_len + f_len );
+        return c_len + f_len;
+    }
+
+    inline std::vector<unsigned char> encrypt( unsigned char const* const plaintext, int const len )
+    {
+        std::vector<unsigned char> ciphertext( ciphertext_capacity( 0, len ) );
+
+        ciphertext.resize( encrypt( byte_span{ ciphertext.data(), ciphertext.size() }, plaintext, len ) );
 
         return ciphertext;
     }
 
 private:
-    EVP_CIPHER_CTX e_ctx;
-    EVP_CIPHER_CTX d_ctx;
+    EVP_CIPHER_CTX* const e_ctx;
+    EVP_CIPHER_CTX* const d_ctx;
     unsigned char const* const _key;
     unsigned char const* const _iv;
     EVP_CIPHER const* const _mode;
 
 };
 
+/**
+ * @brief aes context that expands its key once and takes a fresh iv for every message
+ *
+ * The cipher and key are bound to the encryption and decryption contexts on construction.
+ * Each message only resets the context state and installs its iv by initializing with a
+ * NULL cipher and key, which keeps the expanded key schedule. The output of encrypt() and
+ * decrypt() is identical to that of the aes class. Long messages can be processed in chunks
+ * with the init, update, and final calls. Authenticated ciphers such as gcm and
+ * chacha20-poly1305 are supported through get_tag() and set_tag().
+ *
+ * The byte_span overloads write into caller memory without allocating. They accept an output
+ * that is the input itself, and encrypt() can place the iv in a prefix slot ahead of the
+ * ciphertext so the stored form is produced in one contiguous buffer.
+ */
+class keyed_aes
+{
+
+public:
+
+    keyed_aes() = delete;
+
+    inline keyed_aes( EVP_CIPHER const* const mode, unsigned char const* const key )
+        : e_ctx( EVP_CIPHER_CTX_new() )
+        , d_ctx( EVP_CIPHER_CTX_new() )
+    {
+        if ( !e_ctx || !d_ctx ) {
+            EVP_CIPHER_CTX_free( e_ctx );
+            EVP_CIPHER_CTX_free( d_ctx );
+            throw "EVP_CIPHER_CTX_new() failed";
+        }
+
+        // expand the key once for each direction
+        if ( EVP_EncryptInit_ex( e_ctx, mode, NULL, key, NULL ) != 1 || EVP_DecryptInit_ex( d_ctx, mode, NULL, key, NULL ) != 1 ) {
+            EVP_CIPHER_CTX_free( e_ctx );
+            EVP_CIPHER_CTX_free( d_ctx );
+            throw "EVP_CipherInit_ex() failed";
+        }
+
+        // padding is a context setting that survives the per message initialization
+        EVP_CIPHER_CTX_set_padding( d_ctx, 0 );
+    }
+
+    inline ~keyed_aes()
+    {
+        EVP_CIPHER_CTX_free( e_ctx );
+        EVP_CIPHER_CTX_free( d_ctx );
+    }
+
+    keyed_aes( keyed_aes const& ) = delete;
+
+    keyed_aes& operator=( keyed_aes const& ) = delete;
+
+    keyed_aes( keyed_aes&& ) = delete;
+
+    keyed_aes& operator=( keyed_aes&& ) = delete;
+
+    /**
+     * @brief start decrypting a message that is passed in chunks to decrypt_update()
+     *
+     * @param iv initialization vector of the message; ignored by ecb
+     */
+    inline void decrypt_init( unsigned char const* const iv )
+    {
+        // reset the state and install the iv without expanding the key again
+        if ( EVP_DecryptInit_ex( d_ctx, NULL, NULL, NULL, iv ) != 1 ) {
+            throw "EVP_DecryptInit_ex() failed";
+        }
+
+        _tag_set = false;
+    }
+
+    /**
+     * @brief decrypt the next chunk of a message
+     *
+     * @param plaintext output; must hold ciphertext_len + AES_BLOCK_SIZE bytes
+     * @param ciphertext next chunk of the ciphertext
+     * @param ciphertext_len size of the chunk in bytes
+     *
+     * @return number of plaintext bytes written
+     */
+    inline int decrypt_update( unsigned char* const plaintext, unsigned char const* const ciphertext, int const ciphertext_len )
+    {
+        int len = 0;
+
+        if ( EVP_DecryptUpdate( d_ctx, plaintext, &len, ciphertext, ciphertext_len ) != 1 ) {
+            throw "EVP_DecryptUpdate() failed";
+        }
+
+        return len;
+    }
+
+    /**
+     * @brief finish decrypting a message
+     *
+     * @param plaintext output; must hold AES_BLOCK_SIZE bytes
+     *
+     * @return number of plaintext bytes written
+     */
+    inline int decrypt_final( unsigned char* const plaintext )
+    {
+        int len = 0;
+
+        if ( EVP_DecryptFinal_ex( d_ctx, plaintext, &len ) != 1 ) {
+            throw _tag_set ? "authentication tag mismatch" : "EVP_DecryptFinal_ex() failed";
+        }
+
+        return len;
+    }
+
+    /**
+     * @brief authenticate additional data with the message being decrypted without decrypting it
+     *
+     * Must be called after decrypt_init() and before decrypt_update(). Authenticated modes only.
+     *
+     * @param aad additional authenticated data
+     * @param aad_len size of the data in bytes
+     */
+    inline void decrypt_aad( unsigned char const* const aad, int const aad_len )
+    {
+        int len = 0;
+
+        if ( EVP_DecryptUpdate( d_ctx, NULL, &len, aad, aad_len ) != 1 ) {
+            throw "EVP_DecryptUpdate() failed";
+        }
+    }
+
+    /**
+     * @brief set the expected authentication tag of the message being decrypted
+     *
+     * Must be called before decrypt_final(), which then fails if the message does not match the tag.
+     *
+     * @param tag expected tag
+     * @param tag_len size of the tag in bytes
+     */
+    inline void set_tag( unsigned char const* const tag, int const tag_len )
+    {
+        if ( EVP_CIPHER_CTX_ctrl( d_ctx, EVP_CTRL_AEAD_SET_TAG, tag_len, const_cast<unsigned char*>( tag ) ) != 1 ) {
+            throw "EVP_CIPHER_CTX_ctrl() failed";
+        }
+
+        _tag_set = true;
+    }
+
+    /**
+     * @brief decrypt a message into a caller provided buffer
+     *
+     * Decryption with padding disabled never holds back a block, so the output needs no room
+     * beyond the ciphertext and may be the ciphertext itself.
+     *
+     * @param plaintext output; must hold ciphertext_len bytes
+     * @param iv initialization vector of the message; ignored by ecb
+     * @param ciphertext ciphertext
+     * @param ciphertext_len size of the ciphertext in bytes
+     * @param tag expected authentication tag; NULL for unauthenticated modes
+     * @param tag_len size of the tag in bytes
+     *
+     * @return number of plaintext bytes written
+     */
+    inline size_t decrypt(
+        byte_span const plaintext,
+        unsigned char const* const iv,
+        unsigned char const* const ciphertext,
+        int const ciphertext_len,
+        unsigned char const* const tag = NULL,
+        int const tag_len = 0 )
+    {
+        if ( plaintext.size < static_cast<size_t>( ciphertext_len ) ) {
+            throw "output buffer too small";
+        }
+
+        decrypt_init( iv );
+
+        int plaintext_len = decrypt_update( plaintext.data, ciphertext, ciphertext_len );
+
+        if ( tag ) {
+            set_tag( tag, tag_len );
+        }
+
+        plaintext_len += decrypt_final( plaintext.data + plaintext_len );
+
+        return plaintext_len;
+    }
+
+    inline std::vector<unsigned char> decrypt(
+        unsigned char const* const iv,
+        unsigned char const* const ciphertext,
+        int const ciphertext_len,
+        unsigned char const* const tag = NULL,
+        int const tag_len = 0 )
+    {
+        std::vector<unsigned char> plaintext( ciphertext_len );
+
+        plaintext.resize( decrypt( byte_span{ plaintext.data(), plaintext.size() }, iv, ciphertext, ciphertext_len, tag, tag_len ) );
+
+        return plaintext;
+    }
+
+    /**
+     * @brief start encrypting a message that is passed in chunks to encrypt_update()
+     *
+     * @param iv initialization vector of the message; ignored by ecb
+     */
+    inline void encrypt_init( unsigned char const* const iv )
+    {
+        // reset the state and install the iv without expanding the key again
+        if ( EVP_EncryptInit_ex( e_ctx, NULL, NULL, NULL, iv ) != 1 ) {
+            throw "EVP_EncryptInit_ex() failed";
+        }
+    }
+
+    /**
+     * @brief encrypt the next chunk of a message
+     *
+     * @param ciphertext output; must hold len + AES_BLOCK_SIZE bytes
+     * @param plaintext next chunk of the plaintext
+     * @param len size of the chunk in bytes
+     *
+     * @return number of ciphertext bytes written
+     */
+    inline int encrypt_update( unsigned char* const ciphertext, unsigned char const* const plaintext, int const len )
+    {
+        int c_len = 0;
+
+        if ( EVP_EncryptUpdate( e_ctx, ciphertext, &c_len, plaintext, len ) != 1 ) {
+            throw "EVP_EncryptUpdate() failed";
+        }
+
+        return c_len;
+    }
+
+    /**
+     * @brief finish encrypting a message, adding the padding block
+     *
+     * @param ciphertext output; must hold AES_BLOCK_SIZE bytes
+     *
+     * @return number of ciphertext bytes written
+     */
+    inline int encrypt_final( unsigned char* const ciphertext )
+    {
+        int f_len = 0;
+
+        if ( EVP_EncryptFinal_ex( e_ctx, ciphertext, &f_len ) != 1 ) {
+            throw "EVP_EncryptFinal_ex() failed";
+        }
+
+        return f_len;
+    }
+
+    /**
+     * @brief authenticate additional data with the message being encrypted without encrypting it
+     *
+     * Must be called after encrypt_init() and before encrypt_update(). Authenticated modes only.
+     *
+     * @param aad additional authenticated data
+     * @param aad_len size of the data in bytes
+     */
+    inline void encrypt_aad( unsigned char const* const aad, int const aad_len )
+    {
+        int len = 0;
+
+        if ( EVP_EncryptUpdate( e_ctx, NULL, &len, aad, aad_len ) != 1 ) {
+            throw "EVP_EncryptUpdate() failed";
+        }
+    }
+
+    /**
+     * @brief get the authentication tag of the message just encrypted
+     *
+     * @param tag output; must hold tag_len bytes
+     * @param tag_len size of the tag in bytes
+     */
+    inline void get_tag( unsigned char* const tag, int const tag_len )
+    {
+        if ( EVP_CIPHER_CTX_ctrl( e_ctx, EVP_CTRL_AEAD_GET_TAG, tag_len, tag ) != 1 ) {
+            throw "EVP_CIPHER_CTX_ctrl() failed";
+        }
+    }
+
+    /**
+     * @brief encrypt a message into a caller provided buffer behind an iv prefix
+     *
+     * The iv is copied to the start of the output and the ciphertext follows it. The plaintext
+     * may already sit right after the prefix slot, in which case it is encrypted in place.
+     *
+     * @param out output; must hold ciphertext_capacity( iv_size, len ) bytes
+     * @param iv initialization vector of the message; ignored by ecb
+     * @param iv_size size of the iv prefix; zero to write the ciphertext only
+     * @param plaintext plaintext
+     * @param len size of the plaintext in bytes
+     *
+     * @return number of bytes written, prefix included
+     */
+    inline size_t encrypt(
+        byte_span const out,
+        unsigned char const* const iv,
+        size_t const iv_size,
+        unsigned char const* const plaintext,
+        int const len )
+    {
+        if ( out.size < ciphertext_capacity( iv_size, len ) ) {
+            throw "output buffer too small";
+        }
+
+        encrypt_init( iv );
+
+        // fill the prefix slot unless the iv already lives there
+        if ( iv_size > 0 && out.data != iv ) {
+            memcpy( out.data, iv, iv_size );
+        }
+
+        int c_len = encrypt_update( out.data + iv_size, plaintext, len );
+
+        c_len += encrypt_final( out.data + iv_size + c_len );
+
+        return iv_size + c_len;
+    }
+
+    inline std::vector<unsigned char> encrypt( unsigned char const* const iv, unsigned char const* const plaintext, int const len )
+    {
+        std::vector<unsigned char> ciphertext( ciphertext_capacity( 0, len ) );
+
+        ciphertext.resize( encrypt( byte_span{ ciphertext.data(), ciphertext.size() }, iv, 0, plaintext, len ) );
+
+        return ciphertext;
+    }
+
+private:
+    EVP_CIPHER_CTX* const e_ctx;
+    EVP_CIPHER_CTX* const d_ctx;
+    bool _tag_set = false;
+
+};
+
 #endif // AES_HPP
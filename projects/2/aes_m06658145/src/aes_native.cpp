@@ -0,0 +1,797 @@
+#include "aes_native.h"
+#include <openssl/aes.h>
+#include <openssl/evp.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#define AES_NATIVE_X86 1
+#endif
+
+// the kernels are only built when the native backend is enabled
+#if defined( AES_NATIVE ) && defined( AES_NATIVE_X86 )
+#define AES_NATIVE_KERNELS 1
+#endif
+
+/**
+ * @brief number of blocks the kernels keep in flight
+ */
+static constexpr size_t PIPELINE_BLOCKS = 8;
+
+bool aesni_supported()
+{
+#ifdef AES_NATIVE_X86
+    return __builtin_cpu_supports( "aes" );
+#else
+    return false;
+#endif
+}
+
+bool aes_backend_supported( aes_backend backend )
+{
+    switch ( backend ) {
+
+        case aes_backend::EVP:
+            return true;
+
+#ifdef AES_NATIVE_KERNELS
+        case aes_backend::AESNI:
+            return aesni_supported();
+
+        case aes_backend::VAES:
+            return aesni_supported() && __builtin_cpu_supports( "vaes" ) && __builtin_cpu_supports( "avx2" );
+#endif
+
+        default:
+            return false;
+    }
+}
+
+aes_backend detect_aes_backend()
+{
+    // prefer the widest kernels the processor runs
+    if ( aes_backend_supported( aes_backend::VAES ) ) {
+        return aes_backend::VAES;
+    }
+
+    if ( aes_backend_supported( aes_backend::AESNI ) ) {
+        return aes_backend::AESNI;
+    }
+
+    return aes_backend::EVP;
+}
+
+char const* aes_backend_name( aes_backend backend )
+{
+    switch ( backend ) {
+
+        case aes_backend::AESNI:
+            return "aesni";
+
+        case aes_backend::VAES:
+            return "vaes";
+
+        default:
+            return "evp";
+    }
+}
+
+#ifdef AES_NATIVE_X86
+
+/**
+ * @brief derive an even numbered aes-256 round key from the two before it
+ */
+__attribute__(( target( "aes" ) ))
+static inline __m128i expand_even( __m128i key, __m128i assist )
+{
+    // spread the previous key across all words and mix in the rotated, substituted word
+    key = _mm_xor_si128( key, _mm_slli_si128( key, 4 ) );
+    key = _mm_xor_si128( key, _mm_slli_si128( key, 4 ) );
+    key = _mm_xor_si128( key, _mm_slli_si128( key, 4 ) );
+    return _mm_xor_si128( key, _mm_shuffle_epi32( assist, 0xff ) );
+}
+
+/**
+ * @brief derive an odd numbered aes-256 round key from the two before it
+ */
+__attribute__(( target( "aes" ) ))
+static inline __m128i expand_odd( __m128i key, __m128i even )
+{
+    // the odd keys substitute without rotation or round constant
+    __m128i const assist = _mm_aeskeygenassist_si128( even, 0x00 );
+    key = _mm_xor_si128( key, _mm_slli_si128( key, 4 ) );
+    key = _mm_xor_si128( key, _mm_slli_si128( key, 4 ) );
+    key = _mm_xor_si128( key, _mm_slli_si128( key, 4 ) );
+    return _mm_xor_si128( key, _mm_shuffle_epi32( assist, 0xaa ) );
+}
+
+__attribute__(( target( "aes" ) ))
+void aesni_expand_key_256(
+    unsigned char const* key,
+    unsigned char encrypt_keys[AES_256_ROUND_KEYS][16],
+    unsigned char decrypt_keys[AES_256_ROUND_KEYS][16] )
+{
+    __m128i round_keys[AES_256_ROUND_KEYS];
+
+    round_keys[0]  = _mm_loadu_si128( reinterpret_cast<__m128i const*>( key ) );
+    round_keys[1]  = _mm_loadu_si128( reinterpret_cast<__m128i const*>( key + 16 ) );
+
+    // the round constant is an immediate operand so the schedule is unrolled
+    round_keys[2]  = expand_even( round_keys[0], _mm_aeskeygenassist_si128( round_keys[1], 0x01 ) );
+    round_keys[3]  = expand_odd( round_keys[1], round_keys[2] );
+    round_keys[4]  = expand_even( round_keys[2], _mm_aeskeygenassist_si128( round_keys[3], 0x02 ) );
+    round_keys[5]  = expand_odd( round_keys[3], round_keys[4] );
+    round_keys[6]  = expand_even( round_keys[4], _mm_aeskeygenassist_si128( round_keys[5], 0x04 ) );
+    round_keys[7]  = expand_odd( round_keys[5], round_keys[6] );
+    round_keys[8]  = expand_even( round_keys[6], _mm_aeskeygenassist_si128( round_keys[7], 0x08 ) );
+    round_keys[9]  = expand_odd( round_keys[7], round_keys[8] );
+    round_keys[10] = expand_even( round_keys[8], _mm_aeskeygenassist_si128( round_keys[9], 0x10 ) );
+    round_keys[11] = expand_odd( round_keys[9], round_keys[10] );
+    round_keys[12] = expand_even( round_keys[10], _mm_aeskeygenassist_si128( round_keys[11], 0x20 ) );
+    round_keys[13] = expand_odd( round_keys[11], round_keys[12] );
+    round_keys[14] = expand_even( round_keys[12], _mm_aeskeygenassist_si128( round_keys[13], 0x40 ) );
+
+    for ( int i = 0 ; i < AES_256_ROUND_KEYS ; ++i ) {
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( encrypt_keys[i] ), round_keys[i] );
+    }
+
+    if ( !decrypt_keys ) {
+        return;
+    }
+
+    // the equivalent inverse cipher runs the keys backwards through inverse mix columns
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( decrypt_keys[0] ), round_keys[AES_256_ROUND_KEYS - 1] );
+
+    for ( int i = 1 ; i < AES_256_ROUND_KEYS - 1 ; ++i ) {
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( decrypt_keys[i] ), _mm_aesimc_si128( round_keys[AES_256_ROUND_KEYS - 1 - i] ) );
+    }
+
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( decrypt_keys[AES_256_ROUND_KEYS - 1] ), round_keys[0] );
+}
+
+#else
+
+void aesni_expand_key_256(
+    unsigned char const*,
+    unsigned char[AES_256_ROUND_KEYS][16],
+    unsigned char[AES_256_ROUND_KEYS][16] )
+{
+    throw "aes-ni is not supported";
+}
+
+#endif // AES_NATIVE_X86
+
+#ifdef AES_NATIVE_KERNELS
+
+/**
+ * @brief load the round keys into registers
+ */
+__attribute__(( target( "sse2" ) ))
+static inline void load_keys( unsigned char const keys[AES_256_ROUND_KEYS][16], __m128i round_keys[AES_256_ROUND_KEYS] )
+{
+    for ( int i = 0 ; i < AES_256_ROUND_KEYS ; ++i ) {
+        round_keys[i] = _mm_load_si128( reinterpret_cast<__m128i const*>( keys[i] ) );
+    }
+}
+
+/**
+ * @brief encrypt one block with aes-ni
+ */
+__attribute__(( target( "aes" ) ))
+static inline __m128i encrypt_block( __m128i block, __m128i const round_keys[AES_256_ROUND_KEYS] )
+{
+    block = _mm_xor_si128( block, round_keys[0] );
+
+    for ( int round = 1 ; round < AES_256_ROUND_KEYS - 1 ; ++round ) {
+        block = _mm_aesenc_si128( block, round_keys[round] );
+    }
+
+    return _mm_aesenclast_si128( block, round_keys[AES_256_ROUND_KEYS - 1] );
+}
+
+/**
+ * @brief decrypt one block with aes-ni
+ */
+__attribute__(( target( "aes" ) ))
+static inline __m128i decrypt_block( __m128i block, __m128i const round_keys[AES_256_ROUND_KEYS] )
+{
+    block = _mm_xor_si128( block, round_keys[0] );
+
+    for ( int round = 1 ; round < AES_256_ROUND_KEYS - 1 ; ++round ) {
+        block = _mm_aesdec_si128( block, round_keys[round] );
+    }
+
+    return _mm_aesdeclast_si128( block, round_keys[AES_256_ROUND_KEYS - 1] );
+}
+
+/**
+ * @brief encrypt PIPELINE_BLOCKS independent blocks with their rounds interleaved
+ */
+__attribute__(( target( "aes" ) ))
+static inline void encrypt_blocks_8( __m128i blocks[PIPELINE_BLOCKS], __m128i const round_keys[AES_256_ROUND_KEYS] )
+{
+    for ( size_t i = 0 ; i < PIPELINE_BLOCKS ; ++i ) {
+        blocks[i] = _mm_xor_si128( blocks[i], round_keys[0] );
+    }
+
+#pragma GCC unroll 16
+    for ( int round = 1 ; round < AES_256_ROUND_KEYS - 1 ; ++round ) {
+#pragma GCC unroll 8
+        for ( size_t i = 0 ; i < PIPELINE_BLOCKS ; ++i ) {
+            blocks[i] = _mm_aesenc_si128( blocks[i], round_keys[round] );
+        }
+    }
+
+    for ( size_t i = 0 ; i < PIPELINE_BLOCKS ; ++i ) {
+        blocks[i] = _mm_aesenclast_si128( blocks[i], round_keys[AES_256_ROUND_KEYS - 1] );
+    }
+}
+
+/**
+ * @brief decrypt PIPELINE_BLOCKS independent blocks with their rounds interleaved
+ */
+__attribute__(( target( "aes" ) ))
+static inline void decrypt_blocks_8( __m128i blocks[PIPELINE_BLOCKS], __m128i const round_keys[AES_256_ROUND_KEYS] )
+{
+    for ( size_t i = 0 ; i < PIPELINE_BLOCKS ; ++i ) {
+        blocks[i] = _mm_xor_si128( blocks[i], round_keys[0] );
+    }
+
+#pragma GCC unroll 16
+    for ( int round = 1 ; round < AES_256_ROUND_KEYS - 1 ; ++round ) {
+#pragma GCC unroll 8
+        for ( size_t i = 0 ; i < PIPELINE_BLOCKS ; ++i ) {
+            blocks[i] = _mm_aesdec_si128( blocks[i], round_keys[round] );
+        }
+    }
+
+    for ( size_t i = 0 ; i < PIPELINE_BLOCKS ; ++i ) {
+        blocks[i] = _mm_aesdeclast_si128( blocks[i], round_keys[AES_256_ROUND_KEYS - 1] );
+    }
+}
+
+/**
+ * @brief big endian 128-bit ctr counter
+ */
+struct ctr_counter {
+    uint64_t high;
+    uint64_t low;
+};
+
+/**
+ * @brief load a counter block
+ */
+static inline ctr_counter load_counter( unsigned char const* iv )
+{
+    uint64_t high;
+    uint64_t low;
+    memcpy( &high, iv, sizeof( high ) );
+    memcpy( &low, iv + 8, sizeof( low ) );
+    return { __builtin_bswap64( high ), __builtin_bswap64( low ) };
+}
+
+/**
+ * @brief get the current counter block and advance the counter
+ */
+__attribute__(( target( "sse2" ) ))
+static inline __m128i next_counter( ctr_counter& counter )
+{
+    __m128i const block = _mm_set_epi64x(
+        static_cast<long long>( __builtin_bswap64( counter.low ) ),
+        static_cast<long long>( __builtin_bswap64( counter.high ) ) );
+
+    // carry into the high half like openssl's 128-bit increment
+    if ( ++counter.low == 0 ) {
+        ++counter.high;
+    }
+
+    return block;
+}
+
+/**
+ * @brief xor the keystream of the remaining partial block into the output
+ */
+__attribute__(( target( "aes" ) ))
+static void ctr_tail( __m128i const round_keys[AES_256_ROUND_KEYS], ctr_counter& counter, unsigned char* out, unsigned char const* in, size_t len )
+{
+    unsigned char keystream[AES_BLOCK_SIZE];
+
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( keystream ), encrypt_block( next_counter( counter ), round_keys ) );
+
+    for ( size_t i = 0 ; i < len ; ++i ) {
+        out[i] = in[i] ^ keystream[i];
+    }
+}
+
+__attribute__(( target( "aes" ) ))
+static void aesni_ecb_encrypt( unsigned char const keys[AES_256_ROUND_KEYS][16], unsigned char* out, unsigned char const* in, size_t blocks )
+{
+    __m128i round_keys[AES_256_ROUND_KEYS];
+    load_keys( keys, round_keys );
+
+    size_t i = 0;
+
+    // encrypt 8 blocks at a time
+    for ( ; i + PIPELINE_BLOCKS <= blocks ; i += PIPELINE_BLOCKS ) {
+        __m128i b[PIPELINE_BLOCKS];
+
+        for ( size_t j = 0 ; j < PIPELINE_BLOCKS ; ++j ) {
+            b[j] = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + ( i + j ) * AES_BLOCK_SIZE ) );
+        }
+
+        encrypt_blocks_8( b, round_keys );
+
+        for ( size_t j = 0 ; j < PIPELINE_BLOCKS ; ++j ) {
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( out + ( i + j ) * AES_BLOCK_SIZE ), b[j] );
+        }
+    }
+
+    // encrypt the remaining blocks
+    for ( ; i < blocks ; ++i ) {
+        __m128i const b = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + i * AES_BLOCK_SIZE ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i * AES_BLOCK_SIZE ), encrypt_block( b, round_keys ) );
+    }
+}
+
+__attribute__(( target( "aes" ) ))
+static void aesni_ecb_decrypt( unsigned char const keys[AES_256_ROUND_KEYS][16], unsigned char* out, unsigned char const* in, size_t blocks )
+{
+    __m128i round_keys[AES_256_ROUND_KEYS];
+    load_keys( keys, round_keys );
+
+    size_t i = 0;
+
+    // decrypt 8 blocks at a time
+    for ( ; i + PIPELINE_BLOCKS <= blocks ; i += PIPELINE_BLOCKS ) {
+        __m128i b[PIPELINE_BLOCKS];
+
+        for ( size_t j = 0 ; j < PIPELINE_BLOCKS ; ++j ) {
+            b[j] = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + ( i + j ) * AES_BLOCK_SIZE ) );
+        }
+
+        decrypt_blocks_8( b, round_keys );
+
+        for ( size_t j = 0 ; j < PIPELINE_BLOCKS ; ++j ) {
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( out + ( i + j ) * AES_BLOCK_SIZE ), b[j] );
+        }
+    }
+
+    // decrypt the remaining blocks
+    for ( ; i < blocks ; ++i ) {
+        __m128i const b = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + i * AES_BLOCK_SIZE ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i * AES_BLOCK_SIZE ), decrypt_block( b, round_keys ) );
+    }
+}
+
+__attribute__(( target( "aes" ) ))
+static void aesni_cbc_encrypt(
+    unsigned char const keys[AES_256_ROUND_KEYS][16],
+    unsigned char const* iv,
+    unsigned char* out,
+    unsigned char const* in,
+    size_t blocks )
+{
+    __m128i round_keys[AES_256_ROUND_KEYS];
+    load_keys( keys, round_keys );
+
+    // every block chains from the one before it so cbc encryption stays serial
+    __m128i state = _mm_loadu_si128( reinterpret_cast<__m128i const*>( iv ) );
+
+    for ( size_t i = 0 ; i < blocks ; ++i ) {
+        __m128i const b = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + i * AES_BLOCK_SIZE ) );
+        state = encrypt_block( _mm_xor_si128( state, b ), round_keys );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i * AES_BLOCK_SIZE ), state );
+    }
+}
+
+__attribute__(( target( "aes" ) ))
+static void aesni_cbc_decrypt(
+    unsigned char const keys[AES_256_ROUND_KEYS][16],
+    unsigned char const* iv,
+    unsigned char* out,
+    unsigned char const* in,
+    size_t blocks )
+{
+    __m128i round_keys[AES_256_ROUND_KEYS];
+    load_keys( keys, round_keys );
+
+    __m128i previous = _mm_loadu_si128( reinterpret_cast<__m128i const*>( iv ) );
+
+    size_t i = 0;
+
+    // decrypt 8 blocks at a time; the ciphertext is loaded up front so the output may alias it
+    for ( ; i + PIPELINE_BLOCKS <= blocks ; i += PIPELINE_BLOCKS ) {
+        __m128i c[PIPELINE_BLOCKS];
+        __m128i b[PIPELINE_BLOCKS];
+
+        for ( size_t j = 0 ; j < PIPELINE_BLOCKS ; ++j ) {
+            c[j] = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + ( i + j ) * AES_BLOCK_SIZE ) );
+            b[j] = c[j];
+        }
+
+        decrypt_blocks_8( b, round_keys );
+
+        // chain each block with the ciphertext block before it
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i * AES_BLOCK_SIZE ), _mm_xor_si128( b[0], previous ) );
+
+        for ( size_t j = 1 ; j < PIPELINE_BLOCKS ; ++j ) {
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( out + ( i + j ) * AES_BLOCK_SIZE ), _mm_xor_si128( b[j], c[j - 1] ) );
+        }
+
+        previous = c[PIPELINE_BLOCKS - 1];
+    }
+
+    // decrypt the remaining blocks
+    for ( ; i < blocks ; ++i ) {
+        __m128i const c = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + i * AES_BLOCK_SIZE ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i * AES_BLOCK_SIZE ), _mm_xor_si128( decrypt_block( c, round_keys ), previous ) );
+        previous = c;
+    }
+}
+
+__attribute__(( target( "aes" ) ))
+static void aesni_ctr(
+    unsigned char const keys[AES_256_ROUND_KEYS][16],
+    unsigned char const* iv,
+    unsigned char* out,
+    unsigned char const* in,
+    size_t len )
+{
+    __m128i round_keys[AES_256_ROUND_KEYS];
+    load_keys( keys, round_keys );
+
+    ctr_counter counter = load_counter( iv );
+
+    size_t const blocks = len / AES_BLOCK_SIZE;
+    size_t i = 0;
+
+    // encrypt 8 counter blocks at a time and combine them with the input
+    for ( ; i + PIPELINE_BLOCKS <= blocks ; i += PIPELINE_BLOCKS ) {
+        __m128i b[PIPELINE_BLOCKS];
+
+        for ( size_t j = 0 ; j < PIPELINE_BLOCKS ; ++j ) {
+            b[j] = next_counter( counter );
+        }
+
+        encrypt_blocks_8( b, round_keys );
+
+        for ( size_t j = 0 ; j < PIPELINE_BLOCKS ; ++j ) {
+            __m128i const d = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + ( i + j ) * AES_BLOCK_SIZE ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( out + ( i + j ) * AES_BLOCK_SIZE ), _mm_xor_si128( b[j], d ) );
+        }
+    }
+
+    // process the remaining whole blocks
+    for ( ; i < blocks ; ++i ) {
+        __m128i const d = _mm_loadu_si128( reinterpret_cast<__m128i const*>( in + i * AES_BLOCK_SIZE ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i * AES_BLOCK_SIZE ), _mm_xor_si128( encrypt_block( next_counter( counter ), round_keys ), d ) );
+    }
+
+    // process the partial block
+    if ( len % AES_BLOCK_SIZE != 0 ) {
+        ctr_tail( round_keys, counter, out + blocks * AES_BLOCK_SIZE, in + blocks * AES_BLOCK_SIZE, len % AES_BLOCK_SIZE );
+    }
+}
+
+/**
+ * @brief number of 256-bit registers holding PIPELINE_BLOCKS blocks
+ */
+static constexpr size_t VAES_REGISTERS = PIPELINE_BLOCKS / 2;
+
+/**
+ * @brief broadcast the round keys to both halves of 256-bit registers
+ */
+__attribute__(( target( "avx2" ) ))
+static inline void load_keys_256( unsigned char const keys[AES_256_ROUND_KEYS][16], __m256i round_keys[AES_256_ROUND_KEYS] )
+{
+    for ( int i = 0 ; i < AES_256_ROUND_KEYS ; ++i ) {
+        round_keys[i] = _mm256_broadcastsi128_si256( _mm_load_si128( reinterpret_cast<__m128i const*>( keys[i] ) ) );
+    }
+}
+
+/**
+ * @brief encrypt PIPELINE_BLOCKS independent blocks two per register with vaes
+ */
+__attribute__(( target( "vaes,avx2" ) ))
+static inline void vaes_encrypt_blocks_8( __m256i blocks[VAES_REGISTERS], __m256i const round_keys[AES_256_ROUND_KEYS] )
+{
+    for ( size_t i = 0 ; i < VAES_REGISTERS ; ++i ) {
+        blocks[i] = _mm256_xor_si256( blocks[i], round_keys[0] );
+    }
+
+#pragma GCC unroll 16
+    for ( int round = 1 ; round < AES_256_ROUND_KEYS - 1 ; ++round ) {
+#pragma GCC unroll 4
+        for ( size_t i = 0 ; i < VAES_REGISTERS ; ++i ) {
+            blocks[i] = _mm256_aesenc_epi128( blocks[i], round_keys[round] );
+        }
+    }
+
+    for ( size_t i = 0 ; i < VAES_REGISTERS ; ++i ) {
+        blocks[i] = _mm256_aesenclast_epi128( blocks[i], round_keys[AES_256_ROUND_KEYS - 1] );
+    }
+}
+
+/**
+ * @brief decrypt PIPELINE_BLOCKS independent blocks two per register with vaes
+ */
+__attribute__(( target( "vaes,avx2" ) ))
+static inline void vaes_decrypt_blocks_8( __m256i blocks[VAES_REGISTERS], __m256i const round_keys[AES_256_ROUND_KEYS] )
+{
+    for ( size_t i = 0 ; i < VAES_REGISTERS ; ++i ) {
+        blocks[i] = _mm256_xor_si256( blocks[i], round_keys[0] );
+    }
+
+#pragma GCC unroll 16
+    for ( int round = 1 ; round < AES_256_ROUND_KEYS - 1 ; ++round ) {
+#pragma GCC unroll 4
+        for ( size_t i = 0 ; i < VAES_REGISTERS ; ++i ) {
+            blocks[i] = _mm256_aesdec_epi128( blocks[i], round_keys[round] );
+        }
+    }
+
+    for ( size_t i = 0 ; i < VAES_REGISTERS ; ++i ) {
+        blocks[i] = _mm256_aesdeclast_epi128( blocks[i], round_keys[AES_256_ROUND_KEYS - 1] );
+    }
+}
+
+__attribute__(( target( "vaes,avx2" ) ))
+static void vaes_ecb_encrypt( unsigned char const keys[AES_256_ROUND_KEYS][16], unsigned char* out, unsigned char const* in, size_t blocks )
+{
+    __m256i round_keys[AES_256_ROUND_KEYS];
+    load_keys_256( keys, round_keys );
+
+    size_t i = 0;
+
+    // encrypt 8 blocks at a time
+    for ( ; i + PIPELINE_BLOCKS <= blocks ; i += PIPELINE_BLOCKS ) {
+        __m256i b[VAES_REGISTERS];
+
+        for ( size_t j = 0 ; j < VAES_REGISTERS ; ++j ) {
+            b[j] = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( in + ( i + 2 * j ) * AES_BLOCK_SIZE ) );
+        }
+
+        vaes_encrypt_blocks_8( b, round_keys );
+
+        for ( size_t j = 0 ; j < VAES_REGISTERS ; ++j ) {
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + ( i + 2 * j ) * AES_BLOCK_SIZE ), b[j] );
+        }
+    }
+
+    // the remaining blocks go through aes-ni
+    aesni_ecb_encrypt( keys, out + i * AES_BLOCK_SIZE, in + i * AES_BLOCK_SIZE, blocks - i );
+}
+
+__attribute__(( target( "vaes,avx2" ) ))
+static void vaes_ecb_decrypt( unsigned char const keys[AES_256_ROUND_KEYS][16], unsigned char* out, unsigned char const* in, size_t blocks )
+{
+    __m256i round_keys[AES_256_ROUND_KEYS];
+    load_keys_256( keys, round_keys );
+
+    size_t i = 0;
+
+    // decrypt 8 blocks at a time
+    for ( ; i + PIPELINE_BLOCKS <= blocks ; i += PIPELINE_BLOCKS ) {
+        __m256i b[VAES_REGISTERS];
+
+        for ( size_t j = 0 ; j < VAES_REGISTERS ; ++j ) {
+            b[j] = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( in + ( i + 2 * j ) * AES_BLOCK_SIZE ) );
+        }
+
+        vaes_decrypt_blocks_8( b, round_keys );
+
+        for ( size_t j = 0 ; j < VAES_REGISTERS ; ++j ) {
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + ( i + 2 * j ) * AES_BLOCK_SIZE ), b[j] );
+        }
+    }
+
+    // the remaining blocks go through aes-ni
+    aesni_ecb_decrypt( keys, out + i * AES_BLOCK_SIZE, in + i * AES_BLOCK_SIZE, blocks - i );
+}
+
+__attribute__(( target( "vaes,avx2" ) ))
+static void vaes_cbc_decrypt(
+    unsigned char const keys[AES_256_ROUND_KEYS][16],
+    unsigned char const* iv,
+    unsigned char* out,
+    unsigned char const* in,
+    size_t blocks )
+{
+    __m256i round_keys[AES_256_ROUND_KEYS];
+    load_keys_256( keys, round_keys );
+
+    __m128i previous = _mm_loadu_si128( reinterpret_cast<__m128i const*>( iv ) );
+
+    size_t i = 0;
+
+    // decrypt 8 blocks at a time; the ciphertext is loaded up front so the output may alias it
+    for ( ; i + PIPELINE_BLOCKS <= blocks ; i += PIPELINE_BLOCKS ) {
+        __m256i c[VAES_REGISTERS];
+        __m256i chain[VAES_REGISTERS];
+        __m256i b[VAES_REGISTERS];
+
+        unsigned char const* const chunk = in + i * AES_BLOCK_SIZE;
+
+        for ( size_t j = 0 ; j < VAES_REGISTERS ; ++j ) {
+            c[j] = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( chunk + 2 * j * AES_BLOCK_SIZE ) );
+            b[j] = c[j];
+        }
+
+        // the chaining values are the ciphertext shifted back by one block
+        chain[0] = _mm256_set_m128i( _mm_loadu_si128( reinterpret_cast<__m128i const*>( chunk ) ), previous );
+
+        for ( size_t j = 1 ; j < VAES_REGISTERS ; ++j ) {
+            chain[j] = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( chunk + ( 2 * j - 1 ) * AES_BLOCK_SIZE ) );
+        }
+
+        previous = _mm_loadu_si128( reinterpret_cast<__m128i const*>( chunk + ( PIPELINE_BLOCKS - 1 ) * AES_BLOCK_SIZE ) );
+
+        vaes_decrypt_blocks_8( b, round_keys );
+
+        for ( size_t j = 0 ; j < VAES_REGISTERS ; ++j ) {
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + ( i + 2 * j ) * AES_BLOCK_SIZE ), _mm256_xor_si256( b[j], chain[j] ) );
+        }
+    }
+
+    // the remaining blocks go through aes-ni, chained from the last ciphertext block
+    unsigned char last[AES_BLOCK_SIZE];
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( last ), previous );
+
+    aesni_cbc_decrypt( keys, last, out + i * AES_BLOCK_SIZE, in + i * AES_BLOCK_SIZE, blocks - i );
+}
+
+__attribute__(( target( "vaes,avx2" ) ))
+static void vaes_ctr(
+    unsigned char const keys[AES_256_ROUND_KEYS][16],
+    unsigned char const* iv,
+    unsigned char* out,
+    unsigned char const* in,
+    size_t len )
+{
+    __m256i round_keys[AES_256_ROUND_KEYS];
+    load_keys_256( keys, round_keys );
+
+    ctr_counter counter = load_counter( iv );
+
+    size_t const blocks = len / AES_BLOCK_SIZE;
+    size_t i = 0;
+
+    // encrypt 8 counter blocks at a time and combine them with the input
+    for ( ; i + PIPELINE_BLOCKS <= blocks ; i += PIPELINE_BLOCKS ) {
+        __m256i b[VAES_REGISTERS];
+
+        for ( size_t j = 0 ; j < VAES_REGISTERS ; ++j ) {
+            __m128i const low = next_counter( counter );
+            __m128i const high = next_counter( counter );
+            b[j] = _mm256_set_m128i( high, low );
+        }
+
+        vaes_encrypt_blocks_8( b, round_keys );
+
+        for ( size_t j = 0 ; j < VAES_REGISTERS ; ++j ) {
+            __m256i const d = _mm256_loadu_si256( reinterpret_cast<__m256i const*>( in + ( i + 2 * j ) * AES_BLOCK_SIZE ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + ( i + 2 * j ) * AES_BLOCK_SIZE ), _mm256_xor_si256( b[j], d ) );
+        }
+    }
+
+    // the remaining bytes go through aes-ni, starting from the advanced counter
+    unsigned char next[AES_BLOCK_SIZE];
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( next ), next_counter( counter ) );
+
+    aesni_ctr( keys, next, out + i * AES_BLOCK_SIZE, in + i * AES_BLOCK_SIZE, len - i * AES_BLOCK_SIZE );
+}
+
+#endif // AES_NATIVE_KERNELS
+
+native_aes::native_aes( aes_backend backend, int mode, unsigned char const* key )
+    : _backend( backend )
+    , _mode( mode )
+{
+    // verify the backend can run here
+    if ( backend == aes_backend::EVP || !aes_backend_supported( backend ) ) {
+        throw "native aes backend not supported";
+    }
+
+    // verify the mode has a native kernel
+    if ( mode != EVP_CIPH_ECB_MODE && mode != EVP_CIPH_CBC_MODE && mode != EVP_CIPH_CTR_MODE ) {
+        throw "native aes mode not supported";
+    }
+
+    aesni_expand_key_256( key, _encrypt_keys, _decrypt_keys );
+}
+
+size_t native_aes::encrypt( unsigned char* ciphertext, unsigned char const* iv, unsigned char const* plaintext, size_t len ) const
+{
+#ifdef AES_NATIVE_KERNELS
+
+    // ctr is a stream and needs no padding
+    if ( _mode == EVP_CIPH_CTR_MODE ) {
+        ( _backend == aes_backend::VAES ? vaes_ctr : aesni_ctr )( _encrypt_keys, iv, ciphertext, plaintext, len );
+        return len;
+    }
+
+    // build the final block from the remaining bytes and pkcs#7 padding
+    size_t const whole = len / AES_BLOCK_SIZE;
+    size_t const remaining = len % AES_BLOCK_SIZE;
+
+    unsigned char last[AES_BLOCK_SIZE];
+
+    if ( remaining > 0 ) {
+        memcpy( last, plaintext + whole * AES_BLOCK_SIZE, remaining );
+    }
+
+    memset( last + remaining, static_cast<int>( AES_BLOCK_SIZE - remaining ), AES_BLOCK_SIZE - remaining );
+
+    unsigned char* const out_last = ciphertext + whole * AES_BLOCK_SIZE;
+
+    if ( _mode == EVP_CIPH_ECB_MODE ) {
+        auto const kernel = _backend == aes_backend::VAES ? vaes_ecb_encrypt : aesni_ecb_encrypt;
+        kernel( _encrypt_keys, ciphertext, plaintext, whole );
+        kernel( _encrypt_keys, out_last, last, 1 );
+    } else {
+        // cbc encryption is serial so vaes has nothing to add
+        aesni_cbc_encrypt( _encrypt_keys, iv, ciphertext, plaintext, whole );
+        aesni_cbc_encrypt( _encrypt_keys, whole > 0 ? out_last - AES_BLOCK_SIZE : iv, out_last, last, 1 );
+    }
+
+    return ( whole + 1 ) * AES_BLOCK_SIZE;
+
+#else
+    static_cast<void>( ciphertext );
+    static_cast<void>( iv );
+    static_cast<void>( plaintext );
+    static_cast<void>( len );
+    throw "native aes backend not supported";
+#endif
+}
+
+size_t native_aes::decrypt( unsigned char* plaintext, unsigned char const* iv, unsigned char const* ciphertext, size_t len ) const
+{
+#ifdef AES_NATIVE_KERNELS
+
+    // ctr decryption is the same as encryption
+    if ( _mode == EVP_CIPH_CTR_MODE ) {
+        ( _backend == aes_backend::VAES ? vaes_ctr : aesni_ctr )( _encrypt_keys, iv, plaintext, ciphertext, len );
+        return len;
+    }
+
+    // block modes only take whole blocks; the padding is left in place as with keyed_aes
+    if ( len % AES_BLOCK_SIZE != 0 ) {
+        throw "invalid ciphertext size";
+    }
+
+    if ( _mode == EVP_CIPH_ECB_MODE ) {
+        ( _backend == aes_backend::VAES ? vaes_ecb_decrypt : aesni_ecb_decrypt )( _decrypt_keys, plaintext, ciphertext, len / AES_BLOCK_SIZE );
+    } else {
+        ( _backend == aes_backend::VAES ? vaes_cbc_decrypt : aesni_cbc_decrypt )( _decrypt_keys, iv, plaintext, ciphertext, len / AES_BLOCK_SIZE );
+    }
+
+    return len;
+
+#else
+    static_cast<void>( plaintext );
+    static_cast<void>( iv );
+    static_cast<void>( ciphertext );
+    static_cast<void>( len );
+    throw "native aes backend not supported";
+#endif
+}
+
+std::vector<unsigned char> native_aes::encrypt( unsigned char const* iv, unsigned char const* plaintext, size_t len ) const
+{
+    std::vector<unsigned char> ciphertext( len + AES_BLOCK_SIZE );
+
+    ciphertext.resize( encrypt( ciphertext.data(), iv, plaintext, len ) );
+
+    return ciphertext;
+}
+
+std::vector<unsigned char> native_aes::decrypt( unsigned char const* iv, unsigned char const* ciphertext, size_t len ) const
+{
+    std::vector<unsigned char> plaintext( len );
+
+    plaintext.resize( decrypt( plaintext.data(), iv, ciphertext, len ) );
+
+    return plaintext;
+}
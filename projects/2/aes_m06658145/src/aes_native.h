@@ -0,0 +1,130 @@
+#ifndef AES_NATIVE_H
+#define AES_NATIVE_H
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @brief number of aes-256 round keys
+ */
+constexpr int AES_256_ROUND_KEYS = 15;
+
+/**
+ * @brief implementations of the block cipher
+ */
+enum class aes_backend {
+    EVP,
+    AESNI,
+    VAES
+};
+
+/**
+ * @brief get the fastest backend supported by this build and processor
+ *
+ * @return VAES if the processor has vaes and avx2, AESNI if it has aes-ni, EVP otherwise
+ */
+aes_backend detect_aes_backend();
+
+/**
+ * @brief check whether a backend can run in this build on this processor
+ *
+ * The native backends are only built when AES_NATIVE is defined, see the AES_NATIVE cmake option.
+ *
+ * @param backend backend to check
+ *
+ * @return true if the backend is available; false otherwise;
+ */
+bool aes_backend_supported( aes_backend backend );
+
+/**
+ * @brief get the printable name of a backend
+ *
+ * @param backend backend
+ *
+ * @return "evp", "aesni", or "vaes"
+ */
+char const* aes_backend_name( aes_backend backend );
+
+/**
+ * @brief check whether the processor can run the aes-ni key schedule
+ *
+ * @return true if the processor has aes-ni; false otherwise;
+ */
+bool aesni_supported();
+
+/**
+ * @brief expand a 256-bit key into the encryption and decryption round keys with aes-ni
+ *
+ * The decryption keys are in the order aesdec consumes them, the inverse mix columns of the
+ * encryption keys in reverse. Requires aesni_supported().
+ *
+ * @param key 256-bit key
+ * @param encrypt_keys output; encryption round keys
+ * @param decrypt_keys output; decryption round keys
+ */
+void aesni_expand_key_256(
+    unsigned char const* key,
+    unsigned char encrypt_keys[AES_256_ROUND_KEYS][16],
+    unsigned char decrypt_keys[AES_256_ROUND_KEYS][16] );
+
+/**
+ * @brief aes-256 ecb, cbc, and ctr on aes-ni or vaes without going through openssl
+ *
+ * The key is expanded once on construction. Messages are processed straight from caller buffers
+ * with kernels that keep 8 blocks in flight wherever blocks are independent: ecb in both
+ * directions, cbc decryption, and ctr. The output format matches keyed_aes: ecb and cbc
+ * encryption add pkcs#7 padding, decryption leaves it in place, and ctr is unpadded.
+ */
+class native_aes
+{
+
+public:
+
+    native_aes() = delete;
+
+    /**
+     * @brief expand a key for a mode on a native backend
+     *
+     * @param backend AESNI or VAES; must be supported
+     * @param mode openssl mode flag; EVP_CIPH_ECB_MODE, EVP_CIPH_CBC_MODE, or EVP_CIPH_CTR_MODE
+     * @param key 256-bit key
+     */
+    native_aes( aes_backend backend, int mode, unsigned char const* key );
+
+    /**
+     * @brief encrypt a message
+     *
+     * @param ciphertext output; must hold len + 16 bytes
+     * @param iv initialization vector or initial counter block; ignored by ecb
+     * @param plaintext message
+     * @param len size of the message in bytes
+     *
+     * @return number of ciphertext bytes written
+     */
+    size_t encrypt( unsigned char* ciphertext, unsigned char const* iv, unsigned char const* plaintext, size_t len ) const;
+
+    /**
+     * @brief decrypt a message
+     *
+     * @param plaintext output; must hold len bytes
+     * @param iv initialization vector or initial counter block; ignored by ecb
+     * @param ciphertext message; whole blocks unless the mode is ctr
+     * @param len size of the message in bytes
+     *
+     * @return number of plaintext bytes written
+     */
+    size_t decrypt( unsigned char* plaintext, unsigned char const* iv, unsigned char const* ciphertext, size_t len ) const;
+
+    std::vector<unsigned char> encrypt( unsigned char const* iv, unsigned char const* plaintext, size_t len ) const;
+
+    std::vector<unsigned char> decrypt( unsigned char const* iv, unsigned char const* ciphertext, size_t len ) const;
+
+private:
+    aes_backend const _backend;
+    int const _mode;
+    alignas( 16 ) unsigned char _encrypt_keys[AES_256_ROUND_KEYS][16];
+    alignas( 16 ) unsigned char _decrypt_keys[AES_256_ROUND_KEYS][16];
+
+};
+
+#endif // AES_NATIVE_H
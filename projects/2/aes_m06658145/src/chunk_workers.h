@@ -0,0 +1,53 @@
+#ifndef CHUNK_WORKERS_H
+#define CHUNK_WORKERS_H
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief run workers that take chunks in turn until every chunk is processed
+ *
+ * A single worker runs on the calling thread.
+ *
+ * @tparam T type of functor object
+ * @param chunks number of chunks
+ * @param threads number of worker threads
+ * @param work functor taking the shared next chunk counter; returns false on failure
+ *
+ * @return true if every worker succeeded; false otherwise;
+ */
+template<class T>
+inline bool run_chunk_workers( uint64_t chunks, unsigned int threads, T const& work )
+{
+    // hand out chunks in order so that workers stay close together in the files
+    std::atomic<uint64_t> next_chunk{ 0 };
+
+    // only start workers that have a chunk to process
+    size_t const worker_count = static_cast<size_t>( std::min<uint64_t>( std::max( threads, 1u ), std::max<uint64_t>( chunks, 1 ) ) );
+
+    if ( worker_count == 1 ) {
+        return work( next_chunk );
+    }
+
+    // record the result of each worker
+    std::vector<char> results( worker_count, 1 );
+    std::vector<std::thread> workers;
+
+    for ( size_t i = 0 ; i < worker_count ; ++i ) {
+        workers.emplace_back( [&, i]() {
+            results[i] = work( next_chunk ) ? 1 : 0;
+        } );
+    }
+
+    // wait for all workers to complete
+    for ( auto& worker : workers ) {
+        worker.join();
+    }
+
+    return std::find( results.begin(), results.end(), 0 ) == results.end();
+}
+
+#endif // CHUNK_WORKERS_H
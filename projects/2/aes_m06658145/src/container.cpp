@@ -0,0 +1,677 @@
+#include "container.h"
+#include "aes.h"
+#include "chunk_workers.h"
+#include "file_io.h"
+#include "keygen.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <iostream>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief magic bytes at the start of every container
+ */
+static unsigned char const CONTAINER_MAGIC[8] = { 'A', 'E', 'S', 'C', 'H', 'U', 'N', 'K' };
+
+/**
+ * @brief version of the container layout
+ */
+static unsigned char const CONTAINER_VERSION = 1;
+
+/**
+ * @brief size of an authentication tag in bytes
+ */
+static size_t const CONTAINER_TAG_SIZE = 16;
+
+/**
+ * @brief number of index entries written at a time when packing
+ */
+static size_t const INDEX_BATCH_SIZE = 4096;
+
+/**
+ * @brief ciphers that can be stored in a container and their identifiers in the header
+ */
+static struct {
+    unsigned char id;
+    EVP_CIPHER const* ( *cipher )();
+} const CONTAINER_MODES[] = {
+    { 1, EVP_aes_256_ecb },
+    { 2, EVP_aes_256_cbc },
+    { 3, EVP_aes_256_ctr },
+    { 4, EVP_aes_256_gcm },
+    { 5, EVP_chacha20_poly1305 }
+};
+
+/**
+ * @brief parsed container header
+ */
+struct container_header {
+    EVP_CIPHER const* mode;
+    size_t iv_size;
+    size_t tag_size;
+    size_t chunk_size;
+    uint64_t plaintext_size;
+    uint64_t chunk_count;
+    unsigned char bytes[CONTAINER_HEADER_SIZE];
+};
+
+/**
+ * @brief store an unsigned integer in big endian order
+ *
+ * @param data output; must hold size bytes
+ * @param value value to store
+ * @param size number of bytes to store
+ */
+static void store_be( unsigned char* data, uint64_t value, size_t size )
+{
+    for ( size_t i = size ; i-- > 0 ; value >>= 8 ) {
+        data[i] = static_cast<unsigned char>( value );
+    }
+}
+
+/**
+ * @brief load an unsigned integer stored in big endian order
+ *
+ * @param data stored integer
+ * @param size number of bytes stored
+ *
+ * @return value of the integer
+ */
+static uint64_t load_be( unsigned char const* data, size_t size )
+{
+    uint64_t value = 0;
+
+    for ( size_t i = 0 ; i < size ; ++i ) {
+        value = ( value << 8 ) | data[i];
+    }
+
+    return value;
+}
+
+/**
+ * @brief get the header identifier of a cipher
+ *
+ * @param mode openssl cipher
+ *
+ * @return identifier; zero if the cipher cannot be stored in a container
+ */
+static unsigned char get_mode_id( EVP_CIPHER const* mode )
+{
+    for ( auto const& entry : CONTAINER_MODES ) {
+        if ( mode && EVP_CIPHER_nid( entry.cipher() ) == EVP_CIPHER_nid( mode ) ) {
+            return entry.id;
+        }
+    }
+
+    return 0;
+}
+
+bool is_container_mode( EVP_CIPHER const* mode )
+{
+    return get_mode_id( mode ) != 0;
+}
+
+/**
+ * @brief get the number of plaintext bytes held by a chunk
+ *
+ * @param header container header
+ * @param chunk chunk number
+ *
+ * @return chunk size for every chunk but the last; the remaining bytes for the last
+ */
+static size_t get_chunk_length( container_header const& header, uint64_t chunk )
+{
+    return static_cast<size_t>( std::min<uint64_t>( header.chunk_size, header.plaintext_size - chunk * header.chunk_size ) );
+}
+
+/**
+ * @brief get the size of the stored form of a chunk
+ *
+ * @param header container header
+ * @param length number of plaintext bytes in the chunk
+ *
+ * @return size of the iv, the ciphertext including any padding, and the tag
+ */
+static size_t get_record_size( container_header const& header, size_t length )
+{
+    int const mode = EVP_CIPHER_mode( header.mode );
+    bool const padded = mode == EVP_CIPH_ECB_MODE || mode == EVP_CIPH_CBC_MODE;
+
+    return header.iv_size + ( padded ? length - length % AES_BLOCK_SIZE + AES_BLOCK_SIZE : length ) + header.tag_size;
+}
+
+/**
+ * @brief get the file offset of the first chunk record
+ *
+ * @param header container header
+ *
+ * @return size of the header and the index
+ */
+static uint64_t get_records_offset( container_header const& header )
+{
+    return CONTAINER_HEADER_SIZE + header.chunk_count * sizeof( uint64_t );
+}
+
+/**
+ * @brief build the header of a new container
+ *
+ * @param mode openssl cipher; one accepted by is_container_mode()
+ * @param chunk_size plaintext bytes per chunk
+ * @param plaintext_size total number of plaintext bytes
+ *
+ * @return header with its serialized form
+ */
+static container_header make_header( EVP_CIPHER const* mode, size_t chunk_size, uint64_t plaintext_size )
+{
+    container_header header;
+
+    header.mode = mode;
+    header.iv_size = static_cast<size_t>( EVP_CIPHER_iv_length( mode ) );
+    header.tag_size = ( EVP_CIPHER_flags( mode ) & EVP_CIPH_FLAG_AEAD_CIPHER ) ? CONTAINER_TAG_SIZE : 0;
+    header.chunk_size = chunk_size;
+    header.plaintext_size = plaintext_size;
+    header.chunk_count = ( plaintext_size + chunk_size - 1 ) / chunk_size;
+
+    // serialize the header; the authenticated modes bind these bytes to every chunk
+    memcpy( header.bytes, CONTAINER_MAGIC, sizeof( CONTAINER_MAGIC ) );
+    header.bytes[8] = CONTAINER_VERSION;
+    header.bytes[9] = get_mode_id( mode );
+    header.bytes[10] = static_cast<unsigned char>( header.iv_size );
+    header.bytes[11] = static_cast<unsigned char>( header.tag_size );
+    store_be( header.bytes + 12, chunk_size, 4 );
+    store_be( header.bytes + 16, plaintext_size, 8 );
+    store_be( header.bytes + 24, header.chunk_count, 8 );
+
+    return header;
+}
+
+/**
+ * @brief read and validate the header of a container
+ *
+ * @param fd descriptor of the container file
+ * @param path path of the container file
+ * @param file_size size of the container file
+ *
+ * @return true and the header if successful; false otherwise;
+ */
+static std::pair<bool, container_header> read_header( int fd, char const* path, uint64_t file_size )
+{
+    container_header header{};
+
+    auto const header_read = pread_fully( fd, header.bytes, CONTAINER_HEADER_SIZE, 0 );
+
+    if ( !header_read.first || header_read.second != CONTAINER_HEADER_SIZE ||
+         memcmp( header.bytes, CONTAINER_MAGIC, sizeof( CONTAINER_MAGIC ) ) != 0 ) {
+        std::cerr << "ERROR: '" << path << "' is not a container" << std::endl;
+        return std::make_pair( false, header );
+    }
+
+    if ( header.bytes[8] != CONTAINER_VERSION ) {
+        std::cerr << "ERROR: unsupported container version (" << ( int )header.bytes[8] << ")" << std::endl;
+        return std::make_pair( false, header );
+    }
+
+    // look up the cipher of the stored mode
+    EVP_CIPHER const* mode = NULL;
+
+    for ( auto const& entry : CONTAINER_MODES ) {
+        if ( entry.id == header.bytes[9] ) {
+            mode = entry.cipher();
+        }
+    }
+
+    if ( !mode ) {
+        std::cerr << "ERROR: unknown container mode (" << ( int )header.bytes[9] << ")" << std::endl;
+        return std::make_pair( false, header );
+    }
+
+    // rebuild the header from its fields and require the stored bytes to match
+    uint64_t const chunk_size = load_be( header.bytes + 12, 4 );
+    uint64_t const plaintext_size = load_be( header.bytes + 16, 8 );
+
+    if ( chunk_size == 0 || chunk_size % AES_BLOCK_SIZE != 0 || chunk_size > CONTAINER_MAX_CHUNK_SIZE ) {
+        std::cerr << "ERROR: invalid container chunk size (" << chunk_size << ")" << std::endl;
+        return std::make_pair( false, header );
+    }
+
+    auto const expected = make_header( mode, static_cast<size_t>( chunk_size ), plaintext_size );
+
+    if ( memcmp( expected.bytes, header.bytes, CONTAINER_HEADER_SIZE ) != 0 ) {
+        std::cerr << "ERROR: invalid container header in '" << path << "'" << std::endl;
+        return std::make_pair( false, header );
+    }
+
+    // verify the index lies within the file
+    if ( expected.chunk_count > ( file_size - CONTAINER_HEADER_SIZE ) / sizeof( uint64_t ) ) {
+        std::cerr << "ERROR: invalid container size (index exceeds " << file_size << " bytes)" << std::endl;
+        return std::make_pair( false, header );
+    }
+
+    return std::make_pair( true, expected );
+}
+
+/**
+ * @brief open a container and read its header
+ *
+ * @param path path of the container file
+ *
+ * @return descriptor, file size, and header; descriptor is negative on failure
+ */
+static std::pair<int, std::pair<uint64_t, container_header>> open_container( char const* path )
+{
+    container_header header{};
+
+    int const fd = open( path, O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << path << "'" << std::endl;
+        return std::make_pair( -1, std::make_pair( uint64_t( 0 ), header ) );
+    }
+
+    // get the size of the container
+    struct stat st;
+
+    if ( fstat( fd, &st ) != 0 ) {
+        std::cerr << "ERROR: failed to read from file '" << path << "'" << std::endl;
+        close( fd );
+        return std::make_pair( -1, std::make_pair( uint64_t( 0 ), header ) );
+    }
+
+    uint64_t const file_size = static_cast<uint64_t>( st.st_size );
+
+    auto const header_read = read_header( fd, path, file_size );
+
+    if ( !header_read.first ) {
+        close( fd );
+        return std::make_pair( -1, std::make_pair( file_size, header ) );
+    }
+
+    return std::make_pair( fd, std::make_pair( file_size, header_read.second ) );
+}
+
+/**
+ * @brief build the additional authenticated data of a chunk
+ *
+ * @param header container header
+ * @param chunk chunk number
+ * @param aad output; the header bytes followed by the big endian chunk number
+ */
+static void make_chunk_aad( container_header const& header, uint64_t chunk, unsigned char ( &aad )[CONTAINER_HEADER_SIZE + 8] )
+{
+    memcpy( aad, header.bytes, CONTAINER_HEADER_SIZE );
+    store_be( aad + CONTAINER_HEADER_SIZE, chunk, 8 );
+}
+
+/**
+ * @brief encrypt a chunk into its stored form
+ *
+ * @param aes_ctx aes context holding the expanded key
+ * @param header container header
+ * @param chunk chunk number
+ * @param plaintext plaintext of the chunk
+ * @param length number of plaintext bytes
+ * @param record output; must hold get_record_size( header, length ) bytes
+ *
+ * @return number of bytes written
+ */
+static size_t encrypt_chunk(
+    keyed_aes& aes_ctx,
+    container_header const& header,
+    uint64_t chunk,
+    unsigned char const* plaintext,
+    size_t length,
+    unsigned char* record )
+{
+    // every chunk starts with a fresh random iv
+    keygen( record, header.iv_size );
+
+    aes_ctx.encrypt_init( record );
+
+    if ( header.tag_size > 0 ) {
+        unsigned char aad[CONTAINER_HEADER_SIZE + 8];
+        make_chunk_aad( header, chunk, aad );
+        aes_ctx.encrypt_aad( aad, sizeof( aad ) );
+    }
+
+    size_t size = header.iv_size;
+    size += aes_ctx.encrypt_update( record + size, plaintext, static_cast<int>( length ) );
+    size += aes_ctx.encrypt_final( record + size );
+
+    if ( header.tag_size > 0 ) {
+        aes_ctx.get_tag( record + size, static_cast<int>( header.tag_size ) );
+        size += header.tag_size;
+    }
+
+    return size;
+}
+
+/**
+ * @brief read the stored form of a chunk through the index
+ *
+ * @param fd descriptor of the container file
+ * @param file_size size of the container file
+ * @param header container header
+ * @param chunk chunk number
+ * @param record output; must hold get_record_size( header, get_chunk_length( header, chunk ) ) bytes
+ */
+static void read_chunk( int fd, uint64_t file_size, container_header const& header, uint64_t chunk, unsigned char* record )
+{
+    // look up the offset of the chunk record in the index
+    unsigned char entry[sizeof( uint64_t )];
+    auto const entry_read = pread_fully( fd, entry, sizeof( entry ), CONTAINER_HEADER_SIZE + chunk * sizeof( entry ) );
+
+    if ( !entry_read.first || entry_read.second != sizeof( entry ) ) {
+        throw "pread() failed";
+    }
+
+    uint64_t const offset = load_be( entry, sizeof( entry ) );
+    size_t const size = get_record_size( header, get_chunk_length( header, chunk ) );
+
+    // verify the record lies within the file after the index
+    if ( offset < get_records_offset( header ) || offset > file_size || size > file_size - offset ) {
+        throw "chunk index entry out of range";
+    }
+
+    auto const record_read = pread_fully( fd, record, size, offset );
+
+    if ( !record_read.first || record_read.second != size ) {
+        throw "pread() failed";
+    }
+}
+
+/**
+ * @brief decrypt the stored form of a chunk
+ *
+ * @param aes_ctx aes context holding the expanded key
+ * @param header container header
+ * @param chunk chunk number
+ * @param record stored form of the chunk
+ * @param plaintext output; must hold the ciphertext size of the chunk, padding included
+ */
+static void decrypt_chunk(
+    keyed_aes& aes_ctx,
+    container_header const& header,
+    uint64_t chunk,
+    unsigned char const* record,
+    unsigned char* plaintext )
+{
+    size_t const length = get_chunk_length( header, chunk );
+    size_t const data_size = get_record_size( header, length ) - header.iv_size - header.tag_size;
+
+    aes_ctx.decrypt_init( record );
+
+    if ( header.tag_size > 0 ) {
+        unsigned char aad[CONTAINER_HEADER_SIZE + 8];
+        make_chunk_aad( header, chunk, aad );
+        aes_ctx.decrypt_aad( aad, sizeof( aad ) );
+    }
+
+    size_t size = aes_ctx.decrypt_update( plaintext, record + header.iv_size, static_cast<int>( data_size ) );
+
+    if ( header.tag_size > 0 ) {
+        aes_ctx.set_tag( record + header.iv_size + data_size, static_cast<int>( header.tag_size ) );
+    }
+
+    size += aes_ctx.decrypt_final( plaintext + size );
+
+    // the padding of ecb and cbc chunks must be the pkcs#7 padding of the known length
+    unsigned char const padding = static_cast<unsigned char>( size - length );
+
+    if ( size != data_size || std::count( plaintext + length, plaintext + size, padding ) != padding ) {
+        throw "invalid chunk padding";
+    }
+}
+
+bool container_pack(
+    EVP_CIPHER const* mode,
+    unsigned char const* key,
+    char const* plaintext_path,
+    char const* container_path,
+    size_t chunk_size,
+    unsigned int threads )
+{
+    // verify the mode and chunk size
+    if ( !is_container_mode( mode ) ) {
+        std::cerr << "ERROR: mode cannot be stored in a container" << std::endl;
+        return false;
+    }
+
+    if ( chunk_size == 0 || chunk_size % AES_BLOCK_SIZE != 0 || chunk_size > CONTAINER_MAX_CHUNK_SIZE ) {
+        std::cerr << "ERROR: invalid chunk size (" << chunk_size << " is not a multiple of " << AES_BLOCK_SIZE
+                  << " up to " << CONTAINER_MAX_CHUNK_SIZE << ")" << std::endl;
+        return false;
+    }
+
+    // open the plaintext file for positioned reads and get its size
+    int const in_fd = open( plaintext_path, O_RDONLY | O_CLOEXEC );
+
+    if ( in_fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << plaintext_path << "'" << std::endl;
+        return false;
+    }
+
+    struct stat st;
+
+    if ( fstat( in_fd, &st ) != 0 ) {
+        std::cerr << "ERROR: failed to read from file '" << plaintext_path << "'" << std::endl;
+        close( in_fd );
+        return false;
+    }
+
+    int const out_fd = open( container_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+
+    if ( out_fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << container_path << "'" << std::endl;
+        close( in_fd );
+        return false;
+    }
+
+    auto const header = make_header( mode, chunk_size, static_cast<uint64_t>( st.st_size ) );
+
+    // every record but the last has the same size, so the whole index is known up front
+    uint64_t const records_offset = get_records_offset( header );
+    size_t const record_size = get_record_size( header, chunk_size );
+
+    bool status = pwrite_fully( out_fd, header.bytes, CONTAINER_HEADER_SIZE, 0 );
+
+    std::vector<unsigned char> index( std::min<uint64_t>( header.chunk_count, INDEX_BATCH_SIZE ) * sizeof( uint64_t ) );
+
+    for ( uint64_t first = 0 ; status && first < header.chunk_count ; first += INDEX_BATCH_SIZE ) {
+
+        uint64_t const count = std::min<uint64_t>( INDEX_BATCH_SIZE, header.chunk_count - first );
+
+        for ( uint64_t i = 0 ; i < count ; ++i ) {
+            store_be( index.data() + i * sizeof( uint64_t ), records_offset + ( first + i ) * record_size, sizeof( uint64_t ) );
+        }
+
+        status = pwrite_fully( out_fd, index.data(), count * sizeof( uint64_t ), CONTAINER_HEADER_SIZE + first * sizeof( uint64_t ) );
+    }
+
+    if ( !status ) {
+        std::cerr << "ERROR: failed to write to file '" << container_path << "'" << std::endl;
+    }
+
+    // encrypt the chunks and write each record at its offset
+    status = status && run_chunk_workers( header.chunk_count, threads, [&]( std::atomic<uint64_t>& next_chunk ) {
+
+        try {
+            keyed_aes aes_ctx( mode, key );
+
+            std::vector<unsigned char> plaintext( chunk_size );
+            std::vector<unsigned char> record( record_size );
+
+            for ( uint64_t chunk = next_chunk++ ; chunk < header.chunk_count ; chunk = next_chunk++ ) {
+
+                size_t const length = get_chunk_length( header, chunk );
+                auto const chunk_read = pread_fully( in_fd, plaintext.data(), length, chunk * chunk_size );
+
+                if ( !chunk_read.first || chunk_read.second != length ) {
+                    throw "pread() failed";
+                }
+
+                size_t const size = encrypt_chunk( aes_ctx, header, chunk, plaintext.data(), length, record.data() );
+
+                if ( !pwrite_fully( out_fd, record.data(), size, records_offset + chunk * record_size ) ) {
+                    throw "pwrite() failed";
+                }
+            }
+
+        } catch ( char const* const error ) {
+            // stop the other workers
+            next_chunk = header.chunk_count;
+            std::cerr << "ERROR: failed to pack '" << plaintext_path << "' into '" << container_path << "' (" << error << ")" << std::endl;
+            return false;
+        }
+
+        return true;
+    } );
+
+    // close the files and report any deferred write errors
+    if ( close( out_fd ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << container_path << "'" << std::endl;
+        status = false;
+    }
+
+    close( in_fd );
+
+    return status;
+}
+
+bool container_unpack( unsigned char const* key, char const* container_path, char const* plaintext_path, unsigned int threads )
+{
+    auto const container = open_container( container_path );
+
+    if ( container.first < 0 ) {
+        return false;
+    }
+
+    int const in_fd = container.first;
+    uint64_t const file_size = container.second.first;
+    auto const& header = container.second.second;
+
+    int const out_fd = open( plaintext_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+
+    if ( out_fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << plaintext_path << "'" << std::endl;
+        close( in_fd );
+        return false;
+    }
+
+    // decrypt the chunks and write each one after it is verified
+    bool status = run_chunk_workers( header.chunk_count, threads, [&]( std::atomic<uint64_t>& next_chunk ) {
+
+        try {
+            keyed_aes aes_ctx( header.mode, key );
+
+            std::vector<unsigned char> record( get_record_size( header, header.chunk_size ) );
+            std::vector<unsigned char> plaintext( record.size() );
+
+            for ( uint64_t chunk = next_chunk++ ; chunk < header.chunk_count ; chunk = next_chunk++ ) {
+
+                read_chunk( in_fd, file_size, header, chunk, record.data() );
+                decrypt_chunk( aes_ctx, header, chunk, record.data(), plaintext.data() );
+
+                if ( !pwrite_fully( out_fd, plaintext.data(), get_chunk_length( header, chunk ), chunk * header.chunk_size ) ) {
+                    throw "pwrite() failed";
+                }
+            }
+
+        } catch ( char const* const error ) {
+            // stop the other workers
+            next_chunk = header.chunk_count;
+            std::cerr << "ERROR: failed to unpack '" << container_path << "' into '" << plaintext_path << "' (" << error << ")" << std::endl;
+            return false;
+        }
+
+        return true;
+    } );
+
+    // close the files and report any deferred write errors
+    if ( close( out_fd ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << plaintext_path << "'" << std::endl;
+        status = false;
+    }
+
+    close( in_fd );
+
+    return status;
+}
+
+bool container_read_range(
+    unsigned char const* key,
+    char const* container_path,
+    uint64_t offset,
+    uint64_t length,
+    char const* plaintext_path )
+{
+    auto const container = open_container( container_path );
+
+    if ( container.first < 0 ) {
+        return false;
+    }
+
+    int const fd = container.first;
+    uint64_t const file_size = container.second.first;
+    auto const& header = container.second.second;
+
+    // verify the range lies within the plaintext
+    if ( offset > header.plaintext_size || length > header.plaintext_size - offset ) {
+        std::cerr << "ERROR: invalid range (" << offset << " + " << length << " > " << header.plaintext_size << ")" << std::endl;
+        close( fd );
+        return false;
+    }
+
+    FILE* const os = fopen( plaintext_path, "wb" );
+
+    if ( !os ) {
+        std::cerr << "ERROR: failed to open file '" << plaintext_path << "'" << std::endl;
+        close( fd );
+        return false;
+    }
+
+    bool status = true;
+
+    try {
+        keyed_aes aes_ctx( header.mode, key );
+
+        std::vector<unsigned char> record( get_record_size( header, header.chunk_size ) );
+        std::vector<unsigned char> plaintext( record.size() );
+
+        uint64_t const end = offset + length;
+
+        // decrypt only the chunks covering the range and write the bytes that fall within it
+        for ( uint64_t position = offset ; position < end ; ) {
+
+            uint64_t const chunk = position / header.chunk_size;
+            uint64_t const chunk_start = chunk * header.chunk_size;
+            size_t const skip = static_cast<size_t>( position - chunk_start );
+            size_t const count = static_cast<size_t>( std::min<uint64_t>( get_chunk_length( header, chunk ) - skip, end - position ) );
+
+            read_chunk( fd, file_size, header, chunk, record.data() );
+            decrypt_chunk( aes_ctx, header, chunk, record.data(), plaintext.data() );
+
+            if ( 1 != fwrite( plaintext.data() + skip, count, 1, os ) ) {
+                throw "fwrite() failed";
+            }
+
+            position += count;
+        }
+
+    } catch ( char const* const error ) {
+        std::cerr << "ERROR: failed to read range of '" << container_path << "' into '" << plaintext_path << "' (" << error << ")" << std::endl;
+        status = false;
+    }
+
+    // close the files and report any deferred write errors
+    if ( fclose( os ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << plaintext_path << "'" << std::endl;
+        status = false;
+    }
+
+    close( fd );
+
+    return status;
+}
@@ -0,0 +1,101 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+#include <openssl/evp.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief default number of plaintext bytes per container chunk
+ */
+constexpr size_t CONTAINER_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * @brief largest accepted chunk size; bounds the memory a reader allocates per worker
+ */
+constexpr size_t CONTAINER_MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+/**
+ * @brief size of the fixed container header in bytes
+ */
+constexpr size_t CONTAINER_HEADER_SIZE = 32;
+
+/*
+ * Container layout; integers are big endian.
+ *
+ *   header  "AESCHUNK", version, mode, iv size, tag size, chunk size (32 bits),
+ *           plaintext size (64 bits), chunk count (64 bits)
+ *   index   file offset of every chunk record (64 bits each)
+ *   chunks  iv, ciphertext, and tag of every chunk
+ *
+ * Every chunk holds chunk size plaintext bytes except the last, is encrypted with its own
+ * random iv, and is padded on its own in ecb and cbc. The authenticated modes bind the header
+ * and the chunk number to each tag, so chunks cannot be reordered, dropped, or moved between
+ * containers without failing authentication.
+ */
+
+/**
+ * @brief check whether a cipher can be stored in a container
+ *
+ * @param mode openssl cipher
+ *
+ * @return true for aes-256 ecb, cbc, ctr, and gcm and for chacha20-poly1305; false otherwise;
+ */
+bool is_container_mode( EVP_CIPHER const* mode );
+
+/**
+ * @brief encrypt a file into a chunked container
+ *
+ * Chunks are read, encrypted, and written at their final offsets by worker threads, so memory
+ * use is a few chunks per thread regardless of the file size.
+ *
+ * @param mode openssl cipher; one accepted by is_container_mode()
+ * @param key 256-bit key
+ * @param plaintext_path path of the plaintext file
+ * @param container_path path of the container file
+ * @param chunk_size plaintext bytes per chunk; a multiple of the block size up to CONTAINER_MAX_CHUNK_SIZE
+ * @param threads number of worker threads
+ *
+ * @return true if successful; false otherwise;
+ */
+bool container_pack(
+    EVP_CIPHER const* mode,
+    unsigned char const* key,
+    char const* plaintext_path,
+    char const* container_path,
+    size_t chunk_size,
+    unsigned int threads );
+
+/**
+ * @brief decrypt a whole container
+ *
+ * Chunks are decrypted by worker threads and each is written only after its tag is verified.
+ *
+ * @param key 256-bit key
+ * @param container_path path of the container file
+ * @param plaintext_path path of the plaintext file
+ * @param threads number of worker threads
+ *
+ * @return true if successful; false otherwise;
+ */
+bool container_unpack( unsigned char const* key, char const* container_path, char const* plaintext_path, unsigned int threads );
+
+/**
+ * @brief decrypt a byte range of a container, reading only the chunks that cover it
+ *
+ * @param key 256-bit key
+ * @param container_path path of the container file
+ * @param offset offset of the first plaintext byte
+ * @param length number of plaintext bytes
+ * @param plaintext_path path of the plaintext file
+ *
+ * @return true if successful; false otherwise;
+ */
+bool container_read_range(
+    unsigned char const* key,
+    char const* container_path,
+    uint64_t offset,
+    uint64_t length,
+    char const* plaintext_path );
+
+#endif // CONTAINER_H
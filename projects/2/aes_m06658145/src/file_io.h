@@ -0,0 +1,79 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * @brief read from a descriptor at an offset until the buffer is full or the end of the file
+ *
+ * @param fd descriptor to read from
+ * @param buffer buffer to read into
+ * @param size number of bytes to read
+ * @param offset offset of the first byte to read
+ *
+ * @return true and the number of bytes read if successful; false otherwise;
+ */
+inline std::pair<bool, size_t> pread_fully( int fd, unsigned char* buffer, size_t size, uint64_t offset )
+{
+    size_t done = 0;
+
+    while ( done < size ) {
+
+        ssize_t const result = pread( fd, buffer + done, size - done, static_cast<off_t>( offset + done ) );
+
+        if ( result < 0 && errno == EINTR ) {
+            continue;
+        }
+
+        if ( result < 0 ) {
+            return std::make_pair( false, done );
+        }
+
+        if ( result == 0 ) {
+            break;
+        }
+
+        done += static_cast<size_t>( result );
+    }
+
+    return std::make_pair( true, done );
+}
+
+/**
+ * @brief write a whole buffer to a descriptor at an offset
+ *
+ * @param fd descriptor to write to
+ * @param buffer data to write
+ * @param size number of bytes to write
+ * @param offset offset of the first byte to write
+ *
+ * @return true if successful; false otherwise;
+ */
+inline bool pwrite_fully( int fd, unsigned char const* buffer, size_t size, uint64_t offset )
+{
+    size_t done = 0;
+
+    while ( done < size ) {
+
+        ssize_t const result = pwrite( fd, buffer + done, size - done, static_cast<off_t>( offset + done ) );
+
+        if ( result < 0 && errno == EINTR ) {
+            continue;
+        }
+
+        if ( result <= 0 ) {
+            return false;
+        }
+
+        done += static_cast<size_t>( result );
+    }
+
+    return true;
+}
+
+#endif // FILE_IO_H
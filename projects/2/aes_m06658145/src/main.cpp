@@ -1,11 +1,22 @@
 #include "aes.h"
+#include "aes_native.h"
+#include "container.h"
+#include "file_io.h"
 #include "keygen.h"
+#include "multibuffer_cbc.h"
+#include "parallel_aes.h"
+#include "xts.h"
 #include <algorithm>
 #include <boost/lexical_cast.hpp>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
 // Define parameters
@@ -19,9 +30,16 @@ static std::string const HELP_SHORT = "-h";
 namespace OP
 {
 
-static std::string const ENCRYPT = "enc";
-static std::string const DECRYPT = "dec";
-static std::string const KEYGEN  = "keygen";
+static std::string const BATCH         = "batch";
+static std::string const ENCRYPT       = "enc";
+static std::string const DECRYPT       = "dec";
+static std::string const DECRYPT_RANGE = "dec-range";
+static std::string const KEYGEN        = "keygen";
+static std::string const PACK          = "pack";
+static std::string const READ_RANGE    = "read-range";
+static std::string const UNPACK        = "unpack";
+static std::string const XTS_READ      = "xts-read";
+static std::string const XTS_WRITE     = "xts-write";
 
 } /* namespace OP */
 
@@ -29,24 +47,70 @@ static std::string const KEYGEN  = "keygen";
 namespace MODE
 {
 
-static std::string const CBC = "cbc";
-static std::string const ECB = "ecb";
+static std::string const CBC               = "cbc";
+static std::string const CHACHA20_POLY1305 = "chacha20-poly1305";
+static std::string const CTR               = "ctr";
+static std::string const ECB               = "ecb";
+static std::string const GCM               = "gcm";
+static std::string const XTS               = "xts";
 
 } /* namespace MODE */
 
+// Define supported options
+namespace OPT
+{
+
+static std::string const BACKEND    = "--backend";
+static std::string const CHUNK_SIZE = "--chunk-size";
+static std::string const STREAM     = "--stream";
+static std::string const THREADS    = "-j";
+
+} /* namespace OPT */
+
 } /* namespace PARAM */
 
+/**
+ * @brief number of bytes read per chunk in streaming mode
+ */
+static size_t const STREAM_CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * @brief number of plaintext bytes the batch operation reads before encrypting them together
+ */
+static size_t const BATCH_GROUP_SIZE = 64 * 1024 * 1024;
+
+/**
+ * @brief options accepted by the enc, dec, pack, and unpack operations
+ */
+struct cipher_options {
+    bool stream = false;
+    unsigned int threads = 0;
+    aes_backend backend = detect_aes_backend();
+    size_t chunk_size = CONTAINER_CHUNK_SIZE;
+};
+
 // Define constants for supported modes
 enum class MODE {
     CBC,
-    ECB
+    CHACHA20_POLY1305,
+    CTR,
+    ECB,
+    GCM,
+    XTS
 };
 
 // Define constants for supported operations
 enum class OP {
     KEYGEN,
+    BATCH,
     ENCRYPT,
-    DECRYPT
+    DECRYPT,
+    DECRYPT_RANGE,
+    PACK,
+    UNPACK,
+    READ_RANGE,
+    XTS_READ,
+    XTS_WRITE
 };
 
 /**
@@ -62,6 +126,14 @@ static std::pair<bool, OP> get_op( char const* const op )
         return std::make_pair( true, OP::DECRYPT );
     }
 
+    if ( PARAM::OP::BATCH.compare( op ) == 0 ) {
+        return std::make_pair( true, OP::BATCH );
+    }
+
+    if ( PARAM::OP::DECRYPT_RANGE.compare( op ) == 0 ) {
+        return std::make_pair( true, OP::DECRYPT_RANGE );
+    }
+
     if ( PARAM::OP::ENCRYPT.compare( op ) == 0 ) {
         return std::make_pair( true, OP::ENCRYPT );
     }
@@ -70,6 +142,26 @@ static std::pair<bool, OP> get_op( char const* const op )
         return std::make_pair( true, OP::KEYGEN );
     }
 
+    if ( PARAM::OP::PACK.compare( op ) == 0 ) {
+        return std::make_pair( true, OP::PACK );
+    }
+
+    if ( PARAM::OP::READ_RANGE.compare( op ) == 0 ) {
+        return std::make_pair( true, OP::READ_RANGE );
+    }
+
+    if ( PARAM::OP::UNPACK.compare( op ) == 0 ) {
+        return std::make_pair( true, OP::UNPACK );
+    }
+
+    if ( PARAM::OP::XTS_READ.compare( op ) == 0 ) {
+        return std::make_pair( true, OP::XTS_READ );
+    }
+
+    if ( PARAM::OP::XTS_WRITE.compare( op ) == 0 ) {
+        return std::make_pair( true, OP::XTS_WRITE );
+    }
+
     std::cerr << "ERROR: unknown operation '" << op << "' specified" << std::endl;
 
     return std::make_pair( false, OP::KEYGEN );
@@ -92,6 +184,22 @@ static std::pair<bool, MODE> get_mode( char const* const mode )
         return std::make_pair( true, MODE::CBC );
     }
 
+    if ( PARAM::MODE::CTR.compare( mode ) == 0 ) {
+        return std::make_pair( true, MODE::CTR );
+    }
+
+    if ( PARAM::MODE::GCM.compare( mode ) == 0 ) {
+        return std::make_pair( true, MODE::GCM );
+    }
+
+    if ( PARAM::MODE::XTS.compare( mode ) == 0 ) {
+        return std::make_pair( true, MODE::XTS );
+    }
+
+    if ( PARAM::MODE::CHACHA20_POLY1305.compare( mode ) == 0 ) {
+        return std::make_pair( true, MODE::CHACHA20_POLY1305 );
+    }
+
     std::cerr << "ERROR: invalid mode string '" << mode << "' specified" << std::endl;
 
     return std::make_pair( false, MODE::CBC );
@@ -111,9 +219,21 @@ static EVP_CIPHER const* get_evp_mode( MODE mode )
         case MODE::CBC:
             return EVP_aes_256_cbc();
 
+        case MODE::CHACHA20_POLY1305:
+            return EVP_chacha20_poly1305();
+
+        case MODE::CTR:
+            return EVP_aes_256_ctr();
+
         case MODE::ECB:
             return EVP_aes_256_ecb();
 
+        case MODE::GCM:
+            return EVP_aes_256_gcm();
+
+        case MODE::XTS:
+            return EVP_aes_256_xts();
+
         default:
             std::cerr << "ERROR: unknown mode type value (" << ( int )mode << ")" << std::endl;
             return NULL;
@@ -129,7 +249,76 @@ static EVP_CIPHER const* get_evp_mode( MODE mode )
  */
 static size_t get_iv_size( MODE mode )
 {
-    return ( mode == MODE::ECB ? 0 : 16 );
+    switch ( mode ) {
+
+        case MODE::ECB:
+            return 0;
+
+        // authenticated modes use the 96-bit nonce their counters are built around
+        case MODE::GCM:
+        case MODE::CHACHA20_POLY1305:
+            return 12;
+
+        default:
+            return 16;
+    }
+}
+
+/**
+ * @brief get the size of the authentication tag appended to the ciphertext from the mode value
+ *
+ * @param mode encryption mode
+ *
+ * @return size of the tag in bytes; zero for unauthenticated modes
+ */
+static size_t get_tag_size( MODE mode )
+{
+    return ( mode == MODE::GCM || mode == MODE::CHACHA20_POLY1305 ? 16 : 0 );
+}
+
+/**
+ * @brief check whether the native backend implements a mode
+ *
+ * @param mode encryption mode
+ *
+ * @return true for ecb, cbc, and ctr; false otherwise;
+ */
+static bool has_native_kernel( MODE mode )
+{
+    return mode == MODE::ECB || mode == MODE::CBC || mode == MODE::CTR;
+}
+
+/**
+ * @brief convert from string to backend constant
+ *
+ * @param backend backend in string form; "auto" selects the fastest supported backend
+ *
+ * @return true and the backend in enum form if it is supported; false otherwise;
+ */
+static std::pair<bool, aes_backend> get_backend( char const* const backend )
+{
+    if ( std::string( "auto" ).compare( backend ) == 0 ) {
+        return std::make_pair( true, detect_aes_backend() );
+    }
+
+    for ( auto const candidate : { aes_backend::EVP, aes_backend::AESNI, aes_backend::VAES } ) {
+
+        if ( std::string( aes_backend_name( candidate ) ).compare( backend ) != 0 ) {
+            continue;
+        }
+
+        // verify the backend was built and the processor runs it
+        if ( !aes_backend_supported( candidate ) ) {
+            std::cerr << "ERROR: backend '" << backend << "' is not supported by this build or processor" << std::endl;
+            return std::make_pair( false, candidate );
+        }
+
+        return std::make_pair( true, candidate );
+    }
+
+    std::cerr << "ERROR: invalid backend string '" << backend << "' specified" << std::endl;
+
+    return std::make_pair( false, aes_backend::EVP );
 }
 
 /**
@@ -146,23 +335,70 @@ static void print_help( char const* const exe )
 
     std::cerr << "Synopsis:\n";
     std::cerr << "\t" << exe << " (-h|--help)\n";
-    std::cerr << "\t" << exe << " enc ecb <key_file_path> <plaintext_file_path> <ciphertext_file_path>\n";
-    std::cerr << "\t" << exe << " dec ecb <key_file_path> <ciphertext_file_path> <plaintext_file_path>\n";
-    std::cerr << "\t" << exe << " enc cbc <key_file_path> <plaintext_file_path> <ciphertext_file_path>\n";
-    std::cerr << "\t" << exe << " dec cbc <key_file_path> <ciphertext_file_path> <plaintext_file_path>\n";
-    std::cerr << "\t" << exe << " keygen <key_size> <key_file_path>\n";
+    std::cerr << "\t" << exe << " enc [--stream|-j <n>] [--backend <name>] ecb <key_file_path> <plaintext_file_path> <ciphertext_file_path>\n";
+    std::cerr << "\t" << exe << " dec [--stream|-j <n>] [--backend <name>] ecb <key_file_path> <ciphertext_file_path> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " enc [--stream|-j <n>] [--backend <name>] cbc <key_file_path> <plaintext_file_path> <ciphertext_file_path>\n";
+    std::cerr << "\t" << exe << " dec [--stream|-j <n>] [--backend <name>] cbc <key_file_path> <ciphertext_file_path> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " enc [--stream|-j <n>] [--backend <name>] ctr <key_file_path> <plaintext_file_path> <ciphertext_file_path>\n";
+    std::cerr << "\t" << exe << " dec [--stream|-j <n>] [--backend <name>] ctr <key_file_path> <ciphertext_file_path> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " enc [--stream] (gcm|chacha20-poly1305) <key_file_path> <plaintext_file_path> <ciphertext_file_path>\n";
+    std::cerr << "\t" << exe << " dec [--stream] (gcm|chacha20-poly1305) <key_file_path> <ciphertext_file_path> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " enc [-j <n>] xts <xts_key_file_path> <plaintext_image_path> <ciphertext_image_path>\n";
+    std::cerr << "\t" << exe << " dec [-j <n>] xts <xts_key_file_path> <ciphertext_image_path> <plaintext_image_path>\n";
+    std::cerr << "\t" << exe << " xts-write <xts_key_file_path> <ciphertext_image_path> <sector> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " xts-read <xts_key_file_path> <ciphertext_image_path> <sector> <count> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " batch cbc <key_file_path> <manifest_file_path>\n";
+    std::cerr << "\t" << exe << " dec-range <key_file_path> <ciphertext_file_path> <offset> <length> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " pack [-j <n>] [--chunk-size <bytes>] <mode> <key_file_path> <plaintext_file_path> <container_file_path>\n";
+    std::cerr << "\t" << exe << " unpack [-j <n>] <key_file_path> <container_file_path> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " read-range <key_file_path> <container_file_path> <offset> <length> <plaintext_file_path>\n";
+    std::cerr << "\t" << exe << " keygen (256|512) <key_file_path>\n";
+    std::cerr << "\n";
+
+    std::cerr << "Options:\n";
+    std::cerr << "\t--stream  process the files in fixed-size chunks using constant memory; the output must not\n";
+    std::cerr << "\t          be the input file\n";
+    std::cerr << "\t-j <n>    process chunks of the file on n worker threads; cbc encryption stays sequential\n";
+    std::cerr << "\t          except in pack, where every chunk has its own iv\n";
+    std::cerr << "\t--backend (auto|evp|aesni|vaes)\n";
+    std::cerr << "\t          block cipher implementation for in-memory ecb, cbc, and ctr; defaults to auto\n";
+    std::cerr << "\t--chunk-size <bytes>\n";
+    std::cerr << "\t          plaintext bytes per container chunk; a multiple of 16, defaults to " << CONTAINER_CHUNK_SIZE << "\n";
+    std::cerr << "\n";
+
+    std::cerr << "Notes:\n";
+    std::cerr << "\tdec-range decrypts <length> plaintext bytes starting at <offset> of a ctr ciphertext\n";
+    std::cerr << "\twithout reading the rest of the file\n";
+    std::cerr << "\tbatch encrypts every \"<plaintext_file_path> <ciphertext_file_path>\" line of the manifest,\n";
+    std::cerr << "\tinterleaving independent files to keep the aes units busy\n";
+    std::cerr << "\tgcm and chacha20-poly1305 append a 16 byte tag that dec verifies before writing the last chunk;\n";
+    std::cerr << "\twith --stream the plaintext written so far is unauthenticated until dec exits with 0, and it is\n";
+    std::cerr << "\tremoved if dec fails\n";
+    std::cerr << "\txts encrypts 4096 byte sectors tweaked by their number with a 512-bit key; the output has the\n";
+    std::cerr << "\tlength of the input and is written in place when both paths name the same file; xts-write\n";
+    std::cerr << "\tre-encrypts sectors starting at <sector> from a plaintext file and xts-read decrypts <count> sectors\n";
+    std::cerr << "\tpack stores the file as independently encrypted chunks behind a chunk index; unpack and\n";
+    std::cerr << "\tread-range take the mode from the container and read-range decrypts only the chunks it covers\n";
     std::cerr << std::flush;
 }
 
 /**
- * @brief write an array of binary data to file
+ * @brief write a header followed by a range of binary data to file
  *
  * @param path path to file to be written to
- * @param data array of binary data to be written
+ * @param header binary data written first
+ * @param header_size size of the header in bytes
+ * @param data binary data written after the header
+ * @param data_size size of the data in bytes
  *
  * @return true if successful; false otherwise;
  */
-static bool write_file( const char* path, std::vector<unsigned char> const& data )
+static bool write_file(
+    const char* path,
+    unsigned char const* header,
+    size_t header_size,
+    unsigned char const* data,
+    size_t data_size )
 {
     // open file
     FILE* const os = fopen( path, "wb" );
@@ -174,26 +410,62 @@ static bool write_file( const char* path, std::vector<unsigned char> const& data
     }
 
     // write to file
-    if ( 1 != fwrite( data.data(), data.size(), 1, os ) ) {
+    if ( ( header_size > 0 && 1 != fwrite( header, header_size, 1, os ) ) ||
+         ( data_size > 0 && 1 != fwrite( data, data_size, 1, os ) ) ) {
         std::cerr << "ERROR: failed to write to file '" << path << "'" << std::endl;
         fclose( os );
         return false;
     }
 
     // close the file
-    fclose( os );
+    if ( fclose( os ) != 0 ) {
+        std::cerr << "ERROR: failed to write to file '" << path << "'" << std::endl;
+        return false;
+    }
 
     return true;
 }
 
+/**
+ * @brief write an array of binary data to file
+ *
+ * @param path path to file to be written to
+ * @param data array of binary data to be written
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool write_file( const char* path, std::vector<unsigned char> const& data )
+{
+    return write_file( path, NULL, 0, data.data(), data.size() );
+}
+
+/**
+ * @brief write a header followed by an array of binary data to file
+ *
+ * @param path path to file to be written to
+ * @param header array of binary data written first
+ * @param data array of binary data written after the header
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool write_file( const char* path, std::vector<unsigned char> const& header, std::vector<unsigned char> const& data )
+{
+    return write_file( path, header.data(), header.size(), data.data(), data.size() );
+}
+
 /**
  * @brief read entire binary file
  *
+ * The file data can be surrounded by reserved bytes so that it is encrypted in place with the
+ * iv in front of it and room for padding and a tag behind it.
+ *
  * @param path path of file to be read
+ * @param prefix number of bytes reserved before the file data
+ * @param slack number of bytes reserved after the file data
  *
- * @return true and vector of bytes if successful; false otherwise;
+ * @return true and vector of prefix, file data, and slack bytes if successful; false otherwise;
  */
-static std::pair<bool, std::vector<unsigned char>> read_file( char const* path )
+static std::pair<bool, std::vector<unsigned char>> read_file( char const* path, size_t prefix = 0, size_t slack = 0 )
 {
     // open file
     FILE* const is = fopen( path, "rb" );
@@ -209,11 +481,11 @@ static std::pair<bool, std::vector<unsigned char>> read_file( char const* path )
     size_t const file_size = ftell( is );
     fseek( is, 0, SEEK_SET );
 
-    // create a vector to hold the file data
-    std::vector<unsigned char> data( file_size );
+    // create a vector to hold the file data and the reserved bytes
+    std::vector<unsigned char> data( prefix + file_size + slack );
 
     // read from file
-    if ( 1 != fread( data.data(), file_size, 1, is ) ) {
+    if ( 1 != fread( data.data() + prefix, file_size, 1, is ) ) {
         fclose( is );
         std::cerr << "ERROR: failed to read from file '" << path << "'" << std::endl;
         return std::make_pair( false, std::vector<unsigned char> {} );
@@ -225,174 +497,1257 @@ static std::pair<bool, std::vector<unsigned char>> read_file( char const* path )
     return std::make_pair( true, std::move( data ) );
 }
 
-int main( int argc, char const* argv[] )
+/**
+ * @brief parse the options that precede the mode of the enc and dec operations
+ *
+ * @param argc argument count
+ * @param argv argument vector
+ * @param index index of the first option; advanced past the options
+ *
+ * @return true and the options if successful; false otherwise;
+ */
+static std::pair<bool, cipher_options> parse_cipher_options( int argc, char const* argv[], int& index )
 {
-    // verify minimum argument count
-    if ( argc < 2 ) {
-        std::cerr << "ERROR: insufficient argument count" << std::endl;
-        print_help( argv[0] );
-        return EXIT_FAILURE;
-    }
+    cipher_options options;
 
-    // create an alias for the operation
-    char const* const op = argv[1];
+    for ( ; index < argc ; ++index ) {
 
-    // check if the user asked for help
-    if ( PARAM::HELP_LONG.compare( op ) == 0 || PARAM::HELP_SHORT.compare( op ) == 0 ) {
-        print_help( argv[0] );
-        return EXIT_SUCCESS;
-    }
+        if ( PARAM::OPT::STREAM.compare( argv[index] ) == 0 ) {
+            options.stream = true;
 
-    // convert from the user specified operation string to the operation int value
-    auto const operation = get_op( op );
+        } else if ( PARAM::OPT::BACKEND.compare( argv[index] ) == 0 && index + 1 < argc ) {
 
-    // verify result of conversion
-    if ( !operation.first ) {
-        print_help( argv[0] );
-        return EXIT_FAILURE;
-    }
+            // convert the backend from string to enum form
+            auto const backend = get_backend( argv[++index] );
 
-    switch ( operation.second ) {
+            if ( !backend.first ) {
+                return std::make_pair( false, options );
+            }
 
-        case OP::DECRYPT: {
+            options.backend = backend.second;
 
-            // verify argument count
-            if ( argc != 6 ) {
-                std::cerr << "ERROR: insufficient argument count" << std::endl;
-                print_help( argv[0] );
-                return EXIT_FAILURE;
+        } else if ( PARAM::OPT::CHUNK_SIZE.compare( argv[index] ) == 0 && index + 1 < argc ) {
+
+            // convert the chunk size from string to an unsigned integer
+            try {
+                options.chunk_size = boost::lexical_cast<size_t>( argv[++index] );
+            } catch ( boost::bad_lexical_cast const& ) {
+                options.chunk_size = 0;
             }
 
-            // get string pointers for arguments
-            char const* const mode_string     = argv[2];
-            char const* const key_file        = argv[3];
-            char const* const ciphertext_file = argv[4];
-            char const* const plaintext_file  = argv[5];
+            // verify user requested chunk size
+            if ( options.chunk_size == 0 || options.chunk_size % AES_BLOCK_SIZE != 0 || options.chunk_size > CONTAINER_MAX_CHUNK_SIZE ) {
+                std::cerr << "ERROR: invalid chunk size '" << argv[index] << "' specified" << std::endl;
+                return std::make_pair( false, options );
+            }
 
-            // convert from the mode string to the mode int value
-            auto const mode = get_mode( mode_string );
+        } else if ( PARAM::OPT::THREADS.compare( argv[index] ) == 0 && index + 1 < argc ) {
 
-            // verify result of conversion
-            if ( !mode.first ) {
-                return EXIT_FAILURE;
+            // convert the thread count from string to an unsigned integer
+            try {
+                options.threads = boost::lexical_cast<unsigned int>( argv[++index] );
+            } catch ( boost::bad_lexical_cast const& ) {
+                options.threads = 0;
             }
 
-            // read key data from file
-            auto const key_file_data = read_file( key_file );
-
-            // verify read was successful
-            if ( !key_file_data.first ) {
-                return EXIT_FAILURE;
+            // verify user requested thread count
+            if ( options.threads < 1 ) {
+                std::cerr << "ERROR: invalid thread count '" << argv[index] << "' specified" << std::endl;
+                return std::make_pair( false, options );
             }
 
-            // create an alias for the key data
-            auto const& key = key_file_data.second;
+        } else {
+            break;
+        }
+    }
 
-            // verify size of the key
-            if ( key.size() != 32 ) {
-                std::cerr << "ERROR: invalid key size (" << key.size() << " != 32)" << std::endl;
-                return EXIT_FAILURE;
-            }
+    // streaming runs on the calling thread
+    if ( options.stream && options.threads > 0 ) {
+        std::cerr << "ERROR: --stream cannot be combined with -j" << std::endl;
+        return std::make_pair( false, options );
+    }
 
-            // read ciphertext data from file
-            auto const ciphertext_file_data = read_file( ciphertext_file );
+    return std::make_pair( true, options );
+}
 
-            // verify read was successful
-            if ( !ciphertext_file_data.first ) {
-                return EXIT_FAILURE;
-            }
+/**
+ * @brief check whether a path names a file that is already open
+ *
+ * @param file open stream
+ * @param path path of a file that may not exist yet
+ *
+ * @return true if the path refers to the device and inode of the stream; false otherwise;
+ */
+static bool names_open_file( FILE* const file, char const* path )
+{
+    struct stat file_st;
+    struct stat path_st;
 
-            // create an alias for the ciphertext data
-            auto const& ciphertext = ciphertext_file_data.second;
+    return fstat( fileno( file ), &file_st ) == 0 && stat( path, &path_st ) == 0 &&
+        file_st.st_dev == path_st.st_dev && file_st.st_ino == path_st.st_ino;
+}
 
-            // get the size of the IV
-            auto const iv_size = get_iv_size( mode.second );
+/**
+ * @brief encrypt a file chunk by chunk, writing the iv first
+ *
+ * @param aes_ctx aes context holding the expanded key
+ * @param iv initialization vector; empty for ecb
+ * @param tag_size size of the authentication tag appended to the ciphertext; zero if unauthenticated
+ * @param plaintext_path path of the plaintext file
+ * @param ciphertext_path path of the ciphertext file
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool stream_encrypt_file( keyed_aes& aes_ctx, std::vector<unsigned char> const& iv, size_t tag_size, char const* plaintext_path, char const* ciphertext_path )
+{
+    // open files
+    FILE* const is = fopen( plaintext_path, "rb" );
 
-            // ciphertext size validation
-            if ( ciphertext.size() < iv_size ) {
-                std::cerr << "ERROR: invalid ciphertext size (" << ciphertext.size() << " < " << iv_size << ")" << std::endl;
-                return EXIT_FAILURE;
-            }
+    if ( !is ) {
+        std::cerr << "ERROR: failed to open file '" << plaintext_path << "'" << std::endl;
+        return false;
+    }
 
-            // create an aes context using the beginning of the ciphertext as the IV
-            aes aes_ctx( get_evp_mode( mode.second ), key.data(), ciphertext.data() );
+    // the output is truncated before the input is read, so it must be a different file
+    if ( names_open_file( is, ciphertext_path ) ) {
+        std::cerr << "ERROR: --stream cannot write to its input file '" << plaintext_path << "'" << std::endl;
+        fclose( is );
+        return false;
+    }
 
-            // decrypt the ciphertext skipping the IV at its beginning
-            std::vector<unsigned char> const plaintext( aes_ctx.decrypt( ciphertext.data() + iv_size, ciphertext.size() - iv_size ) );
+    FILE* const os = fopen( ciphertext_path, "wb" );
 
-            // write plaintext data to output file
-            if ( !write_file( plaintext_file, plaintext ) ) {
-                return EXIT_FAILURE;
-            }
+    if ( !os ) {
+        std::cerr << "ERROR: failed to open file '" << ciphertext_path << "'" << std::endl;
+        fclose( is );
+        return false;
+    }
 
-            break;
-        }
+    // allocate one input chunk and one output chunk with room for a padding block
+    std::vector<unsigned char> plaintext( STREAM_CHUNK_SIZE );
+    std::vector<unsigned char> ciphertext( STREAM_CHUNK_SIZE + AES_BLOCK_SIZE );
 
-        case OP::ENCRYPT: {
+    bool status = true;
 
-            // verify argument count
-            if ( argc != 6 ) {
-                std::cerr << "ERROR: insufficient argument count" << std::endl;
-                print_help( argv[0] );
-                return EXIT_FAILURE;
-            }
+    try {
 
-            // get string pointers for arguments
-            char const* const mode_string     = argv[2];
-            char const* const key_file        = argv[3];
-            char const* const plaintext_file  = argv[4];
-            char const* const ciphertext_file = argv[5];
+        // write the iv ahead of the ciphertext
+        if ( !iv.empty() && 1 != fwrite( iv.data(), iv.size(), 1, os ) ) {
+            throw "fwrite() failed";
+        }
 
-            // convert from mode string to mode int value
-            auto const mode = get_mode( mode_string );
+        aes_ctx.encrypt_init( iv.data() );
 
-            // verify result of conversion
-            if ( !mode.first ) {
-                return EXIT_FAILURE;
-            }
+        // encrypt and write each chunk as soon as it is read
+        for ( ;; ) {
+            size_t const len = fread( plaintext.data(), 1, plaintext.size(), is );
 
-            // read key data from file
-            auto const key_file_data = read_file( key_file );
+            if ( ferror( is ) ) {
+                throw "fread() failed";
+            }
 
-            // verify read was successful
-            if ( !key_file_data.first ) {
-                return EXIT_FAILURE;
+            if ( len == 0 ) {
+                break;
             }
 
-            // create an alias for the key data
-            auto const& key = key_file_data.second;
+            int const c_len = aes_ctx.encrypt_update( ciphertext.data(), plaintext.data(), static_cast<int>( len ) );
 
-            // verify size of the key
-            if ( key.size() != 32 ) {
-                std::cerr << "ERROR: invalid key size (" << key.size() << " != 32)" << std::endl;
-                return EXIT_FAILURE;
+            if ( c_len > 0 && 1 != fwrite( ciphertext.data(), c_len, 1, os ) ) {
+                throw "fwrite() failed";
             }
+        }
 
-            // read plaintext data from file
-            auto const plaintext_file_data = read_file( plaintext_file );
+        // write the final padded block
+        int const f_len = aes_ctx.encrypt_final( ciphertext.data() );
 
-            // verify read was successful
-            if ( !plaintext_file_data.first ) {
-                return EXIT_FAILURE;
+        if ( f_len > 0 && 1 != fwrite( ciphertext.data(), f_len, 1, os ) ) {
+            throw "fwrite() failed";
+        }
+
+        // append the authentication tag
+        if ( tag_size > 0 ) {
+            aes_ctx.get_tag( ciphertext.data(), static_cast<int>( tag_size ) );
+
+            if ( 1 != fwrite( ciphertext.data(), tag_size, 1, os ) ) {
+                throw "fwrite() failed";
             }
+        }
+
+    } catch ( char const* const error ) {
+        std::cerr << "ERROR: failed to encrypt '" << plaintext_path << "' into '" << ciphertext_path << "' (" << error << ")" << std::endl;
+        status = false;
+    }
 
-            // create an alias for the plaintext data
-            auto const& plaintext = plaintext_file_data.second;
+    // close the files and report any deferred write errors
+    if ( fclose( os ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << ciphertext_path << "'" << std::endl;
+        status = false;
+    }
 
-            // generate a random 128-bit initialization vector (IV) if necessary
-            auto iv { keygen( get_iv_size( mode.second ) ) };
+    fclose( is );
 
-            // create an aes crypto context
-            aes aes_ctx( get_evp_mode( mode.second ), key.data(), iv.data() );
+    return status;
+}
 
-            // perform aes encryption
-            auto const ciphertext( aes_ctx.encrypt( plaintext.data(), plaintext.size() ) );
+/**
+ * @brief decrypt a file chunk by chunk, reading the iv from its beginning
+ *
+ * For authenticated modes the tag at the end of the file is checked before the
+ * last chunk of plaintext is written. Earlier chunks are written unauthenticated, so
+ * on any failure the plaintext file is emptied and removed.
+ *
+ * @param aes_ctx aes context holding the expanded key
+ * @param iv_size size of the iv at the beginning of the ciphertext; zero for ecb
+ * @param tag_size size of the authentication tag at the end of the ciphertext; zero if unauthenticated
+ * @param ciphertext_path path of the ciphertext file
+ * @param plaintext_path path of the plaintext file
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool stream_decrypt_file( keyed_aes& aes_ctx, size_t iv_size, size_t tag_size, char const* ciphertext_path, char const* plaintext_path )
+{
+    // open files
+    FILE* const is = fopen( ciphertext_path, "rb" );
 
-            // append ciphertext to the iv
-            iv.insert( iv.end(), ciphertext.begin(), ciphertext.end() );
+    if ( !is ) {
+        std::cerr << "ERROR: failed to open file '" << ciphertext_path << "'" << std::endl;
+        return false;
+    }
+
+    // get the size of the ciphertext
+    struct stat st;
+
+    if ( fstat( fileno( is ), &st ) != 0 ) {
+        std::cerr << "ERROR: failed to read from file '" << ciphertext_path << "'" << std::endl;
+        fclose( is );
+        return false;
+    }
+
+    // ciphertext size validation
+    if ( static_cast<uint64_t>( st.st_size ) < iv_size + tag_size ) {
+        std::cerr << "ERROR: invalid ciphertext size (" << st.st_size << " < " << iv_size + tag_size << ")" << std::endl;
+        fclose( is );
+        return false;
+    }
+
+    // read the iv
+    std::vector<unsigned char> iv( iv_size );
+
+    if ( iv_size > 0 && 1 != fread( iv.data(), iv_size, 1, is ) ) {
+        std::cerr << "ERROR: failed to read from file '" << ciphertext_path << "'" << std::endl;
+        fclose( is );
+        return false;
+    }
+
+    // the output is truncated before the input is read, so it must be a different file
+    if ( names_open_file( is, plaintext_path ) ) {
+        std::cerr << "ERROR: --stream cannot write to its input file '" << ciphertext_path << "'" << std::endl;
+        fclose( is );
+        return false;
+    }
+
+    FILE* const os = fopen( plaintext_path, "wb" );
+
+    if ( !os ) {
+        std::cerr << "ERROR: failed to open file '" << plaintext_path << "'" << std::endl;
+        fclose( is );
+        return false;
+    }
+
+    // allocate one input chunk and one output chunk with room for a held back block and the final block
+    std::vector<unsigned char> ciphertext( STREAM_CHUNK_SIZE );
+    std::vector<unsigned char> plaintext( STREAM_CHUNK_SIZE + 2 * AES_BLOCK_SIZE );
+    std::vector<unsigned char> tag( tag_size );
+
+    bool status = true;
+
+    try {
+
+        aes_ctx.decrypt_init( iv.data() );
+
+        // decrypt and write each chunk as soon as it is read; the last chunk waits for the final call
+        for ( uint64_t remaining = st.st_size - iv_size - tag_size ; ; ) {
+
+            size_t const chunk = static_cast<size_t>( std::min<uint64_t>( ciphertext.size(), remaining ) );
+
+            if ( chunk > 0 && 1 != fread( ciphertext.data(), chunk, 1, is ) ) {
+                throw "fread() failed";
+            }
+
+            int p_len = aes_ctx.decrypt_update( plaintext.data(), ciphertext.data(), static_cast<int>( chunk ) );
+
+            remaining -= chunk;
+
+            if ( remaining == 0 ) {
+
+                // read and install the tag so that the final call authenticates the whole message
+                if ( tag_size > 0 ) {
+                    if ( 1 != fread( tag.data(), tag_size, 1, is ) ) {
+                        throw "fread() failed";
+                    }
+
+                    aes_ctx.set_tag( tag.data(), static_cast<int>( tag_size ) );
+                }
+
+                p_len += aes_ctx.decrypt_final( plaintext.data() + p_len );
+            }
+
+            if ( p_len > 0 && 1 != fwrite( plaintext.data(), p_len, 1, os ) ) {
+                throw "fwrite() failed";
+            }
+
+            if ( remaining == 0 ) {
+                break;
+            }
+        }
+
+    } catch ( char const* const error ) {
+        std::cerr << "ERROR: failed to decrypt '" << ciphertext_path << "' into '" << plaintext_path << "' (" << error << ")" << std::endl;
+        status = false;
+    }
+
+    // only a regular file can be removed; other outputs such as a pipe have already been consumed
+    struct stat out_st;
+    bool const regular = fstat( fileno( os ), &out_st ) == 0 && S_ISREG( out_st.st_mode );
+
+    // close the files and report any deferred write errors
+    if ( fclose( os ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << plaintext_path << "'" << std::endl;
+        status = false;
+    }
+
+    fclose( is );
+
+    // never leave plaintext that failed authentication or was cut short behind
+    if ( !status && regular ) {
+        if ( truncate( plaintext_path, 0 ) != 0 || unlink( plaintext_path ) != 0 ) {
+            std::cerr << "ERROR: failed to remove file '" << plaintext_path << "'" << std::endl;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief decrypt a byte range of a ctr ciphertext file without reading the bytes before it
+ *
+ * The counter block of the block holding the first byte is derived from the iv at the start
+ * of the file, so only the ciphertext covering the range is read and decrypted.
+ *
+ * @param aes_ctx ctr mode aes context holding the expanded key
+ * @param ciphertext_path path of the ciphertext file; the iv followed by the ciphertext
+ * @param offset offset of the first plaintext byte
+ * @param length number of plaintext bytes
+ * @param plaintext_path path of the plaintext file
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool decrypt_range_file( keyed_aes& aes_ctx, char const* ciphertext_path, uint64_t offset, uint64_t length, char const* plaintext_path )
+{
+    // open the ciphertext file for positioned reads
+    int const fd = open( ciphertext_path, O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << ciphertext_path << "'" << std::endl;
+        return false;
+    }
+
+    // get the size of the ciphertext
+    struct stat st;
+
+    if ( fstat( fd, &st ) != 0 ) {
+        std::cerr << "ERROR: failed to read from file '" << ciphertext_path << "'" << std::endl;
+        close( fd );
+        return false;
+    }
+
+    uint64_t const file_size = static_cast<uint64_t>( st.st_size );
+
+    // read the iv at the beginning of the file
+    unsigned char iv[AES_BLOCK_SIZE];
+    auto const iv_read = pread_fully( fd, iv, sizeof( iv ), 0 );
+
+    if ( !iv_read.first || iv_read.second != sizeof( iv ) ) {
+        std::cerr << "ERROR: invalid ciphertext size (shorter than the " << sizeof( iv ) << " byte IV)" << std::endl;
+        close( fd );
+        return false;
+    }
+
+    // verify the range lies within the ciphertext
+    uint64_t const data_size = file_size - sizeof( iv );
+
+    if ( offset > data_size || length > data_size - offset ) {
+        std::cerr << "ERROR: invalid range (" << offset << " + " << length << " > " << data_size << ")" << std::endl;
+        close( fd );
+        return false;
+    }
+
+    FILE* const os = fopen( plaintext_path, "wb" );
+
+    if ( !os ) {
+        std::cerr << "ERROR: failed to open file '" << plaintext_path << "'" << std::endl;
+        close( fd );
+        return false;
+    }
+
+    // start from the block holding the first byte and skip the bytes ahead of it
+    uint64_t position = offset - offset % AES_BLOCK_SIZE;
+    size_t skip = static_cast<size_t>( offset % AES_BLOCK_SIZE );
+    uint64_t const end = offset + length;
+
+    std::vector<unsigned char> ciphertext( STREAM_CHUNK_SIZE );
+    std::vector<unsigned char> plaintext( STREAM_CHUNK_SIZE + AES_BLOCK_SIZE );
+
+    bool status = true;
+
+    try {
+
+        // compute the counter block of the first block
+        unsigned char counter[AES_BLOCK_SIZE];
+        ctr_advance( counter, iv, position / AES_BLOCK_SIZE );
+
+        aes_ctx.decrypt_init( counter );
+
+        while ( position < end ) {
+
+            // read the next chunk of the range
+            size_t const chunk = static_cast<size_t>( std::min<uint64_t>( ciphertext.size(), end - position ) );
+            auto const chunk_read = pread_fully( fd, ciphertext.data(), chunk, sizeof( iv ) + position );
+
+            if ( !chunk_read.first || chunk_read.second != chunk ) {
+                throw "pread() failed";
+            }
+
+            // decrypt the chunk; chunks before the last are whole blocks so the counter carries over
+            int const p_len = aes_ctx.decrypt_update( plaintext.data(), ciphertext.data(), static_cast<int>( chunk ) );
+
+            // write the decrypted bytes that fall within the range
+            if ( static_cast<size_t>( p_len ) > skip && 1 != fwrite( plaintext.data() + skip, p_len - skip, 1, os ) ) {
+                throw "fwrite() failed";
+            }
+
+            position += chunk;
+            skip = 0;
+        }
+
+    } catch ( char const* const error ) {
+        std::cerr << "ERROR: failed to decrypt '" << ciphertext_path << "' into '" << plaintext_path << "' (" << error << ")" << std::endl;
+        status = false;
+    }
+
+    // close the files and report any deferred write errors
+    if ( fclose( os ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << plaintext_path << "'" << std::endl;
+        status = false;
+    }
+
+    close( fd );
+
+    return status;
+}
+
+/**
+ * @brief encrypt the files of a group together and write each ciphertext after its iv
+ *
+ * @param key encryption key
+ * @param entries plaintext and ciphertext paths of the files in the group
+ * @param plaintexts contents of the plaintext files
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool batch_encrypt_group(
+    std::vector<unsigned char> const& key,
+    std::vector<std::pair<std::string, std::string>> const& entries,
+    std::vector<std::vector<unsigned char>> const& plaintexts )
+{
+    // generate a random iv for every file
+    auto const ivs { keygen( entries.size() * AES_BLOCK_SIZE ) };
+
+    std::vector<cbc_message> messages;
+
+    for ( size_t i = 0 ; i < entries.size() ; ++i ) {
+        messages.push_back( { ivs.data() + i * AES_BLOCK_SIZE, plaintexts[i].data(), plaintexts[i].size() } );
+    }
+
+    // encrypt the files together
+    auto const ciphertexts = cbc_encrypt_batch( key.data(), messages );
+
+    // write each iv and ciphertext in the same format as enc
+    for ( size_t i = 0 ; i < entries.size() ; ++i ) {
+
+        std::vector<unsigned char> const iv( ivs.begin() + i * AES_BLOCK_SIZE, ivs.begin() + ( i + 1 ) * AES_BLOCK_SIZE );
+
+        if ( !write_file( entries[i].second.c_str(), iv, ciphertexts[i] ) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief encrypt every file listed in a manifest with aes-256-cbc
+ *
+ * Each non-empty manifest line not starting with '#' is "<plaintext_file_path> <ciphertext_file_path>".
+ * Files are read in groups of about BATCH_GROUP_SIZE bytes and each group is encrypted with the
+ * multi-buffer engine, which interleaves the otherwise serial cbc chains of different files.
+ *
+ * @param key encryption key
+ * @param manifest_path path of the manifest file
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool batch_encrypt_files( std::vector<unsigned char> const& key, char const* manifest_path )
+{
+    // open the manifest
+    std::ifstream manifest( manifest_path );
+
+    if ( !manifest ) {
+        std::cerr << "ERROR: failed to open file '" << manifest_path << "'" << std::endl;
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::string>> entries;
+    std::vector<std::vector<unsigned char>> plaintexts;
+    size_t group_size = 0;
+
+    std::string line;
+
+    for ( unsigned int line_number = 1 ; std::getline( manifest, line ) ; ++line_number ) {
+
+        // split the line into the plaintext and ciphertext paths
+        std::istringstream fields( line );
+        std::string plaintext_path;
+        std::string ciphertext_path;
+        std::string extra;
+
+        // skip blank lines and comments
+        if ( !( fields >> plaintext_path ) || plaintext_path[0] == '#' ) {
+            continue;
+        }
+
+        if ( !( fields >> ciphertext_path ) || ( fields >> extra ) ) {
+            std::cerr << "ERROR: invalid manifest entry on line " << line_number << " of '" << manifest_path << "'" << std::endl;
+            return false;
+        }
+
+        // read plaintext data from file
+        auto plaintext_file_data = read_file( plaintext_path.c_str() );
+
+        if ( !plaintext_file_data.first ) {
+            return false;
+        }
+
+        group_size += plaintext_file_data.second.size();
+        entries.emplace_back( plaintext_path, ciphertext_path );
+        plaintexts.push_back( std::move( plaintext_file_data.second ) );
+
+        // encrypt the group once it is large enough to bound memory use
+        if ( group_size >= BATCH_GROUP_SIZE ) {
+
+            if ( !batch_encrypt_group( key, entries, plaintexts ) ) {
+                return false;
+            }
+
+            entries.clear();
+            plaintexts.clear();
+            group_size = 0;
+        }
+    }
+
+    // encrypt the remaining files
+    return entries.empty() || batch_encrypt_group( key, entries, plaintexts );
+}
+
+/**
+ * @brief read an xts key from file
+ *
+ * @param key_file path of the key file
+ *
+ * @return true and the key if successful; false otherwise;
+ */
+static std::pair<bool, std::vector<unsigned char>> read_xts_key( char const* key_file )
+{
+    // read key data from file
+    auto key_file_data = read_file( key_file );
+
+    // verify size of the key
+    if ( key_file_data.first && key_file_data.second.size() != XTS_KEY_SIZE ) {
+        std::cerr << "ERROR: invalid xts key size (" << key_file_data.second.size() << " != " << XTS_KEY_SIZE << ")" << std::endl;
+        key_file_data.first = false;
+    }
+
+    return key_file_data;
+}
+
+/**
+ * @brief encrypt or decrypt a whole image with xts for the enc and dec operations
+ *
+ * @param encrypt true for encryption; false for decryption
+ * @param options options of the operation
+ * @param key_file path of the xts key file
+ * @param input_path path of the input image
+ * @param output_path path of the output image; may be the input
+ *
+ * @return true if successful; false otherwise;
+ */
+static bool xts_crypt_image( bool encrypt, cipher_options const& options, char const* key_file, char const* input_path, char const* output_path )
+{
+    // sectors are always processed a chunk at a time with evp
+    if ( options.stream ) {
+        std::cerr << "ERROR: xts always uses bounded memory and does not take --stream" << std::endl;
+        return false;
+    }
+
+    auto const key = read_xts_key( key_file );
+
+    return key.first && xts_crypt_file( encrypt, key.second.data(), input_path, output_path, options.threads );
+}
+
+int main( int argc, char const* argv[] )
+{
+    // verify minimum argument count
+    if ( argc < 2 ) {
+        std::cerr << "ERROR: insufficient argument count" << std::endl;
+        print_help( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    // create an alias for the operation
+    char const* const op = argv[1];
+
+    // check if the user asked for help
+    if ( PARAM::HELP_LONG.compare( op ) == 0 || PARAM::HELP_SHORT.compare( op ) == 0 ) {
+        print_help( argv[0] );
+        return EXIT_SUCCESS;
+    }
+
+    // convert from the user specified operation string to the operation int value
+    auto const operation = get_op( op );
+
+    // verify result of conversion
+    if ( !operation.first ) {
+        print_help( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    switch ( operation.second ) {
+
+        case OP::DECRYPT: {
+
+            // parse the options ahead of the mode
+            int index = 2;
+            auto const options = parse_cipher_options( argc, argv, index );
+
+            if ( !options.first ) {
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // verify argument count
+            if ( argc - index != 4 ) {
+                std::cerr << "ERROR: insufficient argument count" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // get string pointers for arguments
+            char const* const mode_string     = argv[index];
+            char const* const key_file        = argv[index + 1];
+            char const* const ciphertext_file = argv[index + 2];
+            char const* const plaintext_file  = argv[index + 3];
+
+            // convert from the mode string to the mode int value
+            auto const mode = get_mode( mode_string );
+
+            // verify result of conversion
+            if ( !mode.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // xts decrypts sectors of the image where they are and takes its own key size
+            if ( mode.second == MODE::XTS ) {
+                return xts_crypt_image( false, options.second, key_file, ciphertext_file, plaintext_file ) ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+
+            // read key data from file
+            auto const key_file_data = read_file( key_file );
+
+            // verify read was successful
+            if ( !key_file_data.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // create an alias for the key data
+            auto const& key = key_file_data.second;
+
+            // verify size of the key
+            if ( key.size() != 32 ) {
+                std::cerr << "ERROR: invalid key size (" << key.size() << " != 32)" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // decrypt with bounded memory if requested
+            if ( options.second.stream ) {
+                keyed_aes aes_ctx( get_evp_mode( mode.second ), key.data() );
+                return stream_decrypt_file( aes_ctx, get_iv_size( mode.second ), get_tag_size( mode.second ), ciphertext_file, plaintext_file ) ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+
+            // read ciphertext data from file
+            auto ciphertext_file_data = read_file( ciphertext_file );
+
+            // verify read was successful
+            if ( !ciphertext_file_data.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // create an alias for the ciphertext data
+            auto& ciphertext = ciphertext_file_data.second;
+
+            // get the size of the IV and the authentication tag
+            auto const iv_size = get_iv_size( mode.second );
+            auto const tag_size = get_tag_size( mode.second );
+
+            // ciphertext size validation
+            if ( ciphertext.size() < iv_size + tag_size ) {
+                std::cerr << "ERROR: invalid ciphertext size (" << ciphertext.size() << " < " << iv_size + tag_size << ")" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // get the size of the encrypted data between the IV and the tag
+            size_t const data_size = ciphertext.size() - iv_size - tag_size;
+
+            // decrypt in place; the plaintext replaces the encrypted data behind the IV
+            unsigned char* const plaintext = ciphertext.data() + iv_size;
+            size_t plaintext_size = data_size;
+
+            if ( options.second.threads > 0 && is_parallel_mode( get_evp_mode( mode.second ), false ) ) {
+
+                // every block of ecb, cbc, and ctr decryption is independent; decrypt chunks on worker threads
+                if ( !parallel_crypt( get_evp_mode( mode.second ), false, key.data(), ciphertext.data(),
+                                      plaintext, data_size, plaintext, options.second.threads ) ) {
+                    return EXIT_FAILURE;
+                }
+
+            } else if ( options.second.backend != aes_backend::EVP && has_native_kernel( mode.second ) ) {
+
+                // decrypt with the native kernels
+                native_aes aes_ctx( options.second.backend, EVP_CIPHER_mode( get_evp_mode( mode.second ) ), key.data() );
+
+                try {
+                    plaintext_size = aes_ctx.decrypt( plaintext, ciphertext.data(), plaintext, data_size );
+                } catch ( char const* const error ) {
+                    std::cerr << "ERROR: failed to decrypt '" << ciphertext_file << "' (" << error << ")" << std::endl;
+                    return EXIT_FAILURE;
+                }
+
+            } else {
+
+                // create an aes context with the expanded key
+                keyed_aes aes_ctx( get_evp_mode( mode.second ), key.data() );
+
+                // decrypt the ciphertext using the IV at its beginning and the tag at its end
+                try {
+                    plaintext_size = aes_ctx.decrypt( byte_span{ plaintext, data_size }, ciphertext.data(), plaintext, data_size,
+                                                      tag_size > 0 ? plaintext + data_size : NULL, tag_size );
+                } catch ( char const* const error ) {
+                    std::cerr << "ERROR: failed to decrypt '" << ciphertext_file << "' (" << error << ")" << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+
+            // write plaintext data to output file
+            if ( !write_file( plaintext_file, NULL, 0, plaintext, plaintext_size ) ) {
+                return EXIT_FAILURE;
+            }
+
+            break;
+        }
+
+        case OP::BATCH: {
+
+            // verify argument count
+            if ( argc != 5 ) {
+                std::cerr << "ERROR: insufficient argument count" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // get string pointers for arguments
+            char const* const mode_string   = argv[2];
+            char const* const key_file      = argv[3];
+            char const* const manifest_file = argv[4];
+
+            // convert from mode string to mode int value
+            auto const mode = get_mode( mode_string );
+
+            // verify result of conversion
+            if ( !mode.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // only cbc chains benefit from interleaving independent files
+            if ( mode.second != MODE::CBC ) {
+                std::cerr << "ERROR: batch only supports cbc" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // read key data from file
+            auto const key_file_data = read_file( key_file );
+
+            // verify read was successful
+            if ( !key_file_data.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // create an alias for the key data
+            auto const& key = key_file_data.second;
+
+            // verify size of the key
+            if ( key.size() != 32 ) {
+                std::cerr << "ERROR: invalid key size (" << key.size() << " != 32)" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // encrypt every file of the manifest
+            if ( !batch_encrypt_files( key, manifest_file ) ) {
+                return EXIT_FAILURE;
+            }
+
+            break;
+        }
+
+        case OP::DECRYPT_RANGE: {
+
+            // verify argument count
+            if ( argc != 7 ) {
+                std::cerr << "ERROR: insufficient argument count" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // get string pointers for arguments
+            char const* const key_file        = argv[2];
+            char const* const ciphertext_file = argv[3];
+            char const* const offset_string   = argv[4];
+            char const* const length_string   = argv[5];
+            char const* const plaintext_file  = argv[6];
+
+            // convert the range from strings to unsigned integers
+            uint64_t offset = 0;
+            uint64_t length = 0;
+
+            try {
+                offset = boost::lexical_cast<uint64_t>( offset_string );
+                length = boost::lexical_cast<uint64_t>( length_string );
+            } catch ( boost::bad_lexical_cast const& ) {
+                std::cerr << "ERROR: invalid range '" << offset_string << "' '" << length_string << "' specified" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // read key data from file
+            auto const key_file_data = read_file( key_file );
+
+            // verify read was successful
+            if ( !key_file_data.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // create an alias for the key data
+            auto const& key = key_file_data.second;
+
+            // verify size of the key
+            if ( key.size() != 32 ) {
+                std::cerr << "ERROR: invalid key size (" << key.size() << " != 32)" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // create a ctr aes context with the expanded key
+            keyed_aes aes_ctx( EVP_aes_256_ctr(), key.data() );
+
+            // decrypt only the requested range
+            if ( !decrypt_range_file( aes_ctx, ciphertext_file, offset, length, plaintext_file ) ) {
+                return EXIT_FAILURE;
+            }
+
+            break;
+        }
+
+        case OP::ENCRYPT: {
+
+            // parse the options ahead of the mode
+            int index = 2;
+            auto const options = parse_cipher_options( argc, argv, index );
+
+            if ( !options.first ) {
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // verify argument count
+            if ( argc - index != 4 ) {
+                std::cerr << "ERROR: insufficient argument count" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // get string pointers for arguments
+            char const* const mode_string     = argv[index];
+            char const* const key_file        = argv[index + 1];
+            char const* const plaintext_file  = argv[index + 2];
+            char const* const ciphertext_file = argv[index + 3];
+
+            // convert from mode string to mode int value
+            auto const mode = get_mode( mode_string );
+
+            // verify result of conversion
+            if ( !mode.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // xts encrypts sectors of the image where they are and takes its own key size
+            if ( mode.second == MODE::XTS ) {
+                return xts_crypt_image( true, options.second, key_file, plaintext_file, ciphertext_file ) ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+
+            // read key data from file
+            auto const key_file_data = read_file( key_file );
+
+            // verify read was successful
+            if ( !key_file_data.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // create an alias for the key data
+            auto const& key = key_file_data.second;
+
+            // verify size of the key
+            if ( key.size() != 32 ) {
+                std::cerr << "ERROR: invalid key size (" << key.size() << " != 32)" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // encrypt with bounded memory if requested
+            if ( options.second.stream ) {
+                keyed_aes aes_ctx( get_evp_mode( mode.second ), key.data() );
+                return stream_encrypt_file( aes_ctx, keygen( get_iv_size( mode.second ) ), get_tag_size( mode.second ), plaintext_file, ciphertext_file ) ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+
+            // get the size of the IV and the authentication tag
+            auto const iv_size = get_iv_size( mode.second );
+            auto const tag_size = get_tag_size( mode.second );
+
+            // read plaintext data from file behind a slot for the IV and ahead of room for padding and the tag
+            auto plaintext_file_data = read_file( plaintext_file, iv_size, AES_BLOCK_SIZE + tag_size );
+
+            // verify read was successful
+            if ( !plaintext_file_data.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // create an alias for the output buffer; the ciphertext replaces the plaintext in it
+            auto& buffer = plaintext_file_data.second;
+            unsigned char* const plaintext = buffer.data() + iv_size;
+            size_t const plaintext_size = buffer.size() - iv_size - AES_BLOCK_SIZE - tag_size;
+
+            // generate a random 128-bit initialization vector (IV) if necessary and store it in its slot
+            auto const iv { keygen( iv_size ) };
+            std::copy( iv.begin(), iv.end(), buffer.begin() );
+
+            // create an aes crypto context with the expanded key
+            keyed_aes aes_ctx( get_evp_mode( mode.second ), key.data() );
+
+            // get the number of bytes of IV and ciphertext in the buffer
+            size_t ciphertext_size = 0;
+
+            if ( options.second.threads > 0 && is_parallel_mode( get_evp_mode( mode.second ), true ) ) {
+
+                // encrypt the whole blocks on worker threads; ctr is a stream and takes every byte
+                bool const padded = mode.second == MODE::ECB;
+                size_t const whole = padded ? plaintext_size - plaintext_size % AES_BLOCK_SIZE : plaintext_size;
+
+                if ( !parallel_crypt( get_evp_mode( mode.second ), true, key.data(), iv.data(),
+                                      plaintext, whole, plaintext, options.second.threads ) ) {
+                    return EXIT_FAILURE;
+                }
+
+                ciphertext_size = iv_size + whole;
+
+                // ecb blocks are independent; encrypt the remaining bytes into the padded final block
+                if ( padded ) {
+                    ciphertext_size += aes_ctx.encrypt( byte_span{ plaintext + whole, plaintext_size - whole + AES_BLOCK_SIZE },
+                                                        iv.data(), 0, plaintext + whole, plaintext_size - whole );
+                }
+
+            } else if ( options.second.backend != aes_backend::EVP && has_native_kernel( mode.second ) ) {
+
+                // perform aes encryption with the native kernels
+                native_aes const native_ctx( options.second.backend, EVP_CIPHER_mode( get_evp_mode( mode.second ) ), key.data() );
+                ciphertext_size = iv_size + native_ctx.encrypt( plaintext, iv.data(), plaintext, plaintext_size );
+
+            } else {
+
+                // perform aes encryption; cbc and the authenticated modes chain every block and stay sequential
+                ciphertext_size = aes_ctx.encrypt( byte_span{ buffer.data(), buffer.size() - tag_size },
+                                                   buffer.data(), iv_size, plaintext, plaintext_size );
+            }
+
+            // append the authentication tag
+            if ( tag_size > 0 ) {
+                aes_ctx.get_tag( buffer.data() + ciphertext_size, static_cast<int>( tag_size ) );
+                ciphertext_size += tag_size;
+            }
+
+            // write iv, ciphertext, and tag to output file with a single write
+            if ( !write_file( ciphertext_file, NULL, 0, buffer.data(), ciphertext_size ) ) {
+                return EXIT_FAILURE;
+            }
+
+            break;
+        }
+
+        case OP::PACK: {
+
+            // parse the options ahead of the mode
+            int index = 2;
+            auto const options = parse_cipher_options( argc, argv, index );
+
+            if ( !options.first ) {
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // containers are always written chunk by chunk
+            if ( options.second.stream ) {
+                std::cerr << "ERROR: pack always uses bounded memory and does not take --stream" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // verify argument count
+            if ( argc - index != 4 ) {
+                std::cerr << "ERROR: insufficient argument count" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // get string pointers for arguments
+            char const* const mode_string    = argv[index];
+            char const* const key_file       = argv[index + 1];
+            char const* const plaintext_file = argv[index + 2];
+            char const* const container_file = argv[index + 3];
+
+            // convert from mode string to mode int value
+            auto const mode = get_mode( mode_string );
+
+            // verify result of conversion
+            if ( !mode.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // read key data from file
+            auto const key_file_data = read_file( key_file );
+
+            // verify read was successful
+            if ( !key_file_data.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // create an alias for the key data
+            auto const& key = key_file_data.second;
+
+            // verify size of the key
+            if ( key.size() != 32 ) {
+                std::cerr << "ERROR: invalid key size (" << key.size() << " != 32)" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // encrypt the chunks, on worker threads if requested
+            if ( !container_pack( get_evp_mode( mode.second ), key.data(), plaintext_file, container_file,
+                                  options.second.chunk_size, options.second.threads ) ) {
+                return EXIT_FAILURE;
+            }
+
+            break;
+        }
+
+        case OP::UNPACK: {
+
+            // parse the options ahead of the key
+            int index = 2;
+            auto const options = parse_cipher_options( argc, argv, index );
+
+            if ( !options.first ) {
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // verify argument count
+            if ( argc - index != 3 ) {
+                std::cerr << "ERROR: insufficient argument count" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // get string pointers for arguments
+            char const* const key_file       = argv[index];
+            char const* const container_file = argv[index + 1];
+            char const* const plaintext_file = argv[index + 2];
+
+            // read key data from file
+            auto const key_file_data = read_file( key_file );
+
+            // verify read was successful
+            if ( !key_file_data.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // create an alias for the key data
+            auto const& key = key_file_data.second;
+
+            // verify size of the key
+            if ( key.size() != 32 ) {
+                std::cerr << "ERROR: invalid key size (" << key.size() << " != 32)" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // decrypt every chunk, on worker threads if requested
+            if ( !container_unpack( key.data(), container_file, plaintext_file, options.second.threads ) ) {
+                return EXIT_FAILURE;
+            }
+
+            break;
+        }
+
+        case OP::READ_RANGE: {
+
+            // verify argument count
+            if ( argc != 7 ) {
+                std::cerr << "ERROR: insufficient argument count" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // get string pointers for arguments
+            char const* const key_file       = argv[2];
+            char const* const container_file = argv[3];
+            char const* const offset_string  = argv[4];
+            char const* const length_string  = argv[5];
+            char const* const plaintext_file = argv[6];
+
+            // convert the range from strings to unsigned integers
+            uint64_t offset = 0;
+            uint64_t length = 0;
+
+            try {
+                offset = boost::lexical_cast<uint64_t>( offset_string );
+                length = boost::lexical_cast<uint64_t>( length_string );
+            } catch ( boost::bad_lexical_cast const& ) {
+                std::cerr << "ERROR: invalid range '" << offset_string << "' '" << length_string << "' specified" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // read key data from file
+            auto const key_file_data = read_file( key_file );
+
+            // verify read was successful
+            if ( !key_file_data.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // create an alias for the key data
+            auto const& key = key_file_data.second;
+
+            // verify size of the key
+            if ( key.size() != 32 ) {
+                std::cerr << "ERROR: invalid key size (" << key.size() << " != 32)" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // decrypt only the chunks covering the range
+            if ( !container_read_range( key.data(), container_file, offset, length, plaintext_file ) ) {
+                return EXIT_FAILURE;
+            }
+
+            break;
+        }
+
+        case OP::XTS_WRITE: {
+
+            // verify argument count
+            if ( argc != 6 ) {
+                std::cerr << "ERROR: insufficient argument count" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // get string pointers for arguments
+            char const* const key_file       = argv[2];
+            char const* const image_file     = argv[3];
+            char const* const sector_string  = argv[4];
+            char const* const plaintext_file = argv[5];
+
+            // convert the sector number from string to an unsigned integer
+            uint64_t sector = 0;
+
+            try {
+                sector = boost::lexical_cast<uint64_t>( sector_string );
+            } catch ( boost::bad_lexical_cast const& ) {
+                std::cerr << "ERROR: invalid sector '" << sector_string << "' specified" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // read the xts key from file
+            auto const key = read_xts_key( key_file );
+
+            if ( !key.first ) {
+                return EXIT_FAILURE;
+            }
+
+            // re-encrypt only the sectors covered by the plaintext
+            if ( !xts_write_sectors( key.second.data(), image_file, sector, plaintext_file ) ) {
+                return EXIT_FAILURE;
+            }
+
+            break;
+        }
+
+        case OP::XTS_READ: {
+
+            // verify argument count
+            if ( argc != 7 ) {
+                std::cerr << "ERROR: insufficient argument count" << std::endl;
+                print_help( argv[0] );
+                return EXIT_FAILURE;
+            }
+
+            // get string pointers for arguments
+            char const* const key_file       = argv[2];
+            char const* const image_file     = argv[3];
+            char const* const sector_string  = argv[4];
+            char const* const count_string   = argv[5];
+            char const* const plaintext_file = argv[6];
+
+            // convert the sector range from strings to unsigned integers
+            uint64_t sector = 0;
+            uint64_t count = 0;
+
+            try {
+                sector = boost::lexical_cast<uint64_t>( sector_string );
+                count = boost::lexical_cast<uint64_t>( count_string );
+            } catch ( boost::bad_lexical_cast const& ) {
+                std::cerr << "ERROR: invalid sector range '" << sector_string << "' '" << count_string << "' specified" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // read the xts key from file
+            auto const key = read_xts_key( key_file );
+
+            if ( !key.first ) {
+                return EXIT_FAILURE;
+            }
 
-            // write iv and ciphertext to output file
-            if ( !write_file( ciphertext_file, iv ) ) {
+            // decrypt only the requested sectors
+            if ( !xts_read_sectors( key.second.data(), image_file, sector, count, plaintext_file ) ) {
                 return EXIT_FAILURE;
             }
 
@@ -415,8 +1770,8 @@ int main( int argc, char const* argv[] )
             // convert argument from string to an unsigned integer
             unsigned int const key_size_int = boost::lexical_cast<unsigned int>( key_size );
 
-            // verify user requested key length
-            if ( key_size_int != 256 ) {
+            // verify user requested key length; xts takes two 256-bit keys
+            if ( key_size_int != 256 && key_size_int != 512 ) {
                 std::cerr << "ERROR: invalid key size specified" << std::endl;
                 return EXIT_FAILURE;
             }
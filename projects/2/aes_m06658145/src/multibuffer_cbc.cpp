@@ -0,0 +1,177 @@
+#include "multibuffer_cbc.h"
+#include "aes.h"
+#include "aes_native.h"
+#include <string.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#define MULTIBUFFER_CBC_X86 1
+#endif
+
+/**
+ * @brief get the size of a message once padded to whole blocks
+ */
+static size_t padded_size( size_t length )
+{
+    return ( length / AES_BLOCK_SIZE + 1 ) * AES_BLOCK_SIZE;
+}
+
+/**
+ * @brief encrypt every message on its own through openssl
+ */
+static void cbc_encrypt_serial(
+    unsigned char const* key,
+    std::vector<cbc_message> const& messages,
+    std::vector<std::vector<unsigned char>>& ciphertexts )
+{
+    keyed_aes aes_ctx( EVP_aes_256_cbc(), key );
+
+    for ( size_t i = 0 ; i < messages.size() ; ++i ) {
+        ciphertexts[i] = aes_ctx.encrypt( messages[i].iv, messages[i].plaintext, static_cast<int>( messages[i].length ) );
+    }
+}
+
+#ifdef MULTIBUFFER_CBC_X86
+
+/**
+ * @brief load the plaintext block at an offset of a message, padding the final block
+ */
+__attribute__(( target( "sse2" ) ))
+static inline __m128i load_block( cbc_message const& message, size_t offset )
+{
+    // every block but the last is read in place
+    if ( offset + AES_BLOCK_SIZE <= message.length ) {
+        return _mm_loadu_si128( reinterpret_cast<__m128i const*>( message.plaintext + offset ) );
+    }
+
+    // the last block holds the remaining bytes followed by pkcs#7 padding
+    unsigned char block[AES_BLOCK_SIZE];
+    size_t const remaining = message.length - offset;
+
+    memcpy( block, message.plaintext + offset, remaining );
+    memset( block + remaining, static_cast<int>( AES_BLOCK_SIZE - remaining ), AES_BLOCK_SIZE - remaining );
+
+    return _mm_loadu_si128( reinterpret_cast<__m128i const*>( block ) );
+}
+
+/**
+ * @brief encrypt the messages MULTIBUFFER_LANES at a time with interleaved aes rounds
+ */
+__attribute__(( target( "aes" ) ))
+static void cbc_encrypt_lanes(
+    unsigned char const* key,
+    std::vector<cbc_message> const& messages,
+    std::vector<std::vector<unsigned char>>& ciphertexts )
+{
+    // expand the key with aes-ni; only the encryption keys are needed
+    alignas( 16 ) unsigned char keys[AES_256_ROUND_KEYS][16];
+    aesni_expand_key_256( key, keys, NULL );
+
+    __m128i round_keys[AES_256_ROUND_KEYS];
+
+    for ( int i = 0 ; i < AES_256_ROUND_KEYS ; ++i ) {
+        round_keys[i] = _mm_load_si128( reinterpret_cast<__m128i const*>( keys[i] ) );
+    }
+
+    // the message and block offset each lane is working on
+    size_t lane_message[MULTIBUFFER_LANES];
+    size_t lane_offset[MULTIBUFFER_LANES];
+    bool lane_active[MULTIBUFFER_LANES];
+
+    // the chaining value of each lane; the previous ciphertext block
+    __m128i state[MULTIBUFFER_LANES];
+
+    size_t next_message = 0;
+    unsigned int active = 0;
+
+    // hand a message to a lane and start its chain at the message iv
+    auto const assign = [&]( unsigned int lane ) {
+        lane_active[lane] = next_message < messages.size();
+
+        if ( lane_active[lane] ) {
+            lane_message[lane] = next_message++;
+            lane_offset[lane] = 0;
+            ciphertexts[lane_message[lane]].resize( padded_size( messages[lane_message[lane]].length ) );
+            state[lane] = _mm_loadu_si128( reinterpret_cast<__m128i const*>( messages[lane_message[lane]].iv ) );
+            ++active;
+        }
+    };
+
+    for ( unsigned int lane = 0 ; lane < MULTIBUFFER_LANES ; ++lane ) {
+        assign( lane );
+    }
+
+    while ( active > 0 ) {
+
+        // chain the next block of every lane and apply the first round key; idle lanes spin on stale state
+        for ( unsigned int lane = 0 ; lane < MULTIBUFFER_LANES ; ++lane ) {
+            if ( lane_active[lane] ) {
+                state[lane] = _mm_xor_si128( state[lane], load_block( messages[lane_message[lane]], lane_offset[lane] ) );
+            }
+
+            state[lane] = _mm_xor_si128( state[lane], round_keys[0] );
+        }
+
+        // run each round across all lanes so independent aesenc instructions overlap in the pipeline
+#pragma GCC unroll 16
+        for ( int round = 1 ; round < AES_256_ROUND_KEYS - 1 ; ++round ) {
+#pragma GCC unroll 8
+            for ( unsigned int lane = 0 ; lane < MULTIBUFFER_LANES ; ++lane ) {
+                state[lane] = _mm_aesenc_si128( state[lane], round_keys[round] );
+            }
+        }
+
+        for ( unsigned int lane = 0 ; lane < MULTIBUFFER_LANES ; ++lane ) {
+            state[lane] = _mm_aesenclast_si128( state[lane], round_keys[AES_256_ROUND_KEYS - 1] );
+        }
+
+        // store the ciphertext blocks and refill lanes whose message is complete
+        for ( unsigned int lane = 0 ; lane < MULTIBUFFER_LANES ; ++lane ) {
+
+            if ( !lane_active[lane] ) {
+                continue;
+            }
+
+            auto& ciphertext = ciphertexts[lane_message[lane]];
+
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( ciphertext.data() + lane_offset[lane] ), state[lane] );
+            lane_offset[lane] += AES_BLOCK_SIZE;
+
+            if ( lane_offset[lane] == ciphertext.size() ) {
+                --active;
+                assign( lane );
+            }
+        }
+    }
+}
+
+#endif // MULTIBUFFER_CBC_X86
+
+bool multibuffer_cbc_supported()
+{
+#ifdef MULTIBUFFER_CBC_X86
+    return aesni_supported();
+#else
+    return false;
+#endif
+}
+
+std::vector<std::vector<unsigned char>> cbc_encrypt_batch(
+    unsigned char const* key,
+    std::vector<cbc_message> const& messages,
+    bool multibuffer )
+{
+    std::vector<std::vector<unsigned char>> ciphertexts( messages.size() );
+
+    // interleave the messages when the aes instructions are available
+    if ( multibuffer && multibuffer_cbc_supported() ) {
+#ifdef MULTIBUFFER_CBC_X86
+        cbc_encrypt_lanes( key, messages, ciphertexts );
+        return ciphertexts;
+#endif
+    }
+
+    cbc_encrypt_serial( key, messages, ciphertexts );
+
+    return ciphertexts;
+}
@@ -0,0 +1,50 @@
+#ifndef MULTIBUFFER_CBC_H
+#define MULTIBUFFER_CBC_H
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @brief number of independent cbc streams the multi-buffer engine interleaves
+ */
+constexpr unsigned int MULTIBUFFER_LANES = 8;
+
+/**
+ * @brief a message of a cbc batch
+ */
+struct cbc_message {
+    unsigned char const* iv;
+    unsigned char const* plaintext;
+    size_t length;
+};
+
+/**
+ * @brief check whether the processor provides the aes instructions used by the multi-buffer engine
+ *
+ * @return true if multi-buffer encryption is available; false otherwise;
+ */
+bool multibuffer_cbc_supported();
+
+/**
+ * @brief encrypt a batch of independent messages with aes-256-cbc and pkcs#7 padding
+ *
+ * Encrypting one cbc message is serial since every block depends on the one before it, so the
+ * multi-buffer engine keeps MULTIBUFFER_LANES messages in flight and advances each of them by one
+ * block per step. The rounds of the lanes are interleaved so the pipelined aes units stay busy.
+ * Finished lanes pick up the next message of the batch. Without the aes instructions, or when
+ * multibuffer is false, every message is encrypted on its own with a keyed_aes context.
+ *
+ * The output of each message is identical to keyed_aes::encrypt() with the same key and iv.
+ *
+ * @param key 256-bit encryption key
+ * @param messages messages to encrypt
+ * @param multibuffer false to force the serial path
+ *
+ * @return ciphertext of each message in order
+ */
+std::vector<std::vector<unsigned char>> cbc_encrypt_batch(
+    unsigned char const* key,
+    std::vector<cbc_message> const& messages,
+    bool multibuffer = true );
+
+#endif // MULTIBUFFER_CBC_H
@@ -0,0 +1,151 @@
+#include "parallel_aes.h"
+#include "aes.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+bool is_parallel_mode( EVP_CIPHER const* mode, bool encrypt )
+{
+    switch ( EVP_CIPHER_mode( mode ) ) {
+
+        case EVP_CIPH_ECB_MODE:
+        case EVP_CIPH_CTR_MODE:
+            return true;
+
+        case EVP_CIPH_CBC_MODE:
+            return !encrypt;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief get the iv that starts the chunk at a given offset
+ *
+ * @param mode openssl cipher mode flag
+ * @param iv initialization vector of the whole message
+ * @param chain last ciphertext block before each chunk; cbc only
+ * @param offset offset of the chunk; a multiple of the block size
+ * @param chunk_iv storage for a computed iv
+ *
+ * @return iv of the chunk
+ */
+static unsigned char const* get_chunk_iv(
+    int mode,
+    unsigned char const* iv,
+    unsigned char const* chain,
+    size_t offset,
+    unsigned char* chunk_iv )
+{
+    // the first chunk and every ecb chunk use the message iv as is
+    if ( offset == 0 || mode == EVP_CIPH_ECB_MODE ) {
+        return iv;
+    }
+
+    // cbc chains from the previous ciphertext block
+    if ( mode == EVP_CIPH_CBC_MODE ) {
+        return chain + offset / PARALLEL_CHUNK_SIZE * AES_BLOCK_SIZE;
+    }
+
+    // ctr advances the big endian counter by the number of preceding blocks
+    ctr_advance( chunk_iv, iv, offset / AES_BLOCK_SIZE );
+
+    return chunk_iv;
+}
+
+bool parallel_crypt(
+    EVP_CIPHER const* mode,
+    bool encrypt,
+    unsigned char const* key,
+    unsigned char const* iv,
+    unsigned char const* input,
+    size_t length,
+    unsigned char* output,
+    unsigned int threads )
+{
+    // verify the chunks are independent
+    if ( !is_parallel_mode( mode, encrypt ) ) {
+        std::cerr << "ERROR: mode cannot be processed in parallel" << std::endl;
+        return false;
+    }
+
+    const int mode_flag = EVP_CIPHER_mode( mode );
+
+    // block modes without padding only process whole blocks
+    if ( mode_flag != EVP_CIPH_CTR_MODE && length % AES_BLOCK_SIZE != 0 ) {
+        std::cerr << "ERROR: invalid data size (" << length << " is not a multiple of " << AES_BLOCK_SIZE << ")" << std::endl;
+        return false;
+    }
+
+    // get the number of chunks and only start workers that have a chunk to process
+    const size_t chunks = ( length + PARALLEL_CHUNK_SIZE - 1 ) / PARALLEL_CHUNK_SIZE;
+    const size_t worker_count = std::min<size_t>( std::max( threads, 1u ), chunks );
+
+    // copy the ciphertext block that chains into each cbc chunk before any worker can overwrite it in place
+    std::vector<unsigned char> chain( mode_flag == EVP_CIPH_CBC_MODE ? chunks * AES_BLOCK_SIZE : 0 );
+
+    for ( size_t chunk = 1 ; chunk < chunks && !chain.empty() ; ++chunk ) {
+        memcpy( chain.data() + chunk * AES_BLOCK_SIZE, input + chunk * PARALLEL_CHUNK_SIZE - AES_BLOCK_SIZE, AES_BLOCK_SIZE );
+    }
+
+    // hand out chunks in order so that workers stay close together in memory
+    std::atomic<size_t> next_chunk{ 0 };
+
+    // record the result of each worker
+    std::vector<char> results( worker_count, 1 );
+    std::vector<std::thread> workers;
+
+    for ( size_t i = 0 ; i < worker_count ; ++i ) {
+        workers.emplace_back( [&, i]() {
+
+            EVP_CIPHER_CTX* const ctx = EVP_CIPHER_CTX_new();
+
+            // expand the key once for this worker and disable padding so chunks map one to one
+            if ( !ctx || EVP_CipherInit_ex( ctx, mode, NULL, key, NULL, encrypt ? 1 : 0 ) != 1 ) {
+                EVP_CIPHER_CTX_free( ctx );
+                results[i] = 0;
+                return;
+            }
+
+            EVP_CIPHER_CTX_set_padding( ctx, 0 );
+
+            unsigned char chunk_iv[AES_BLOCK_SIZE];
+
+            for ( size_t chunk = next_chunk++ ; chunk < chunks ; chunk = next_chunk++ ) {
+
+                // get the bounds of the chunk
+                const size_t offset = chunk * PARALLEL_CHUNK_SIZE;
+                const int len = static_cast<int>( std::min( PARALLEL_CHUNK_SIZE, length - offset ) );
+
+                int out_len = 0;
+
+                // restart the context at the chunk's iv and process the chunk in place in the output
+                if ( EVP_CipherInit_ex( ctx, NULL, NULL, NULL, get_chunk_iv( mode_flag, iv, chain.data(), offset, chunk_iv ), -1 ) != 1 ||
+                     EVP_CipherUpdate( ctx, output + offset, &out_len, input + offset, len ) != 1 ||
+                     out_len != len ) {
+                    results[i] = 0;
+                    break;
+                }
+            }
+
+            EVP_CIPHER_CTX_free( ctx );
+        } );
+    }
+
+    // wait for all workers to complete
+    for ( auto& worker : workers ) {
+        worker.join();
+    }
+
+    // report a failure in any worker
+    if ( std::find( results.begin(), results.end(), 0 ) != results.end() ) {
+        std::cerr << "ERROR: failed to " << ( encrypt ? "encrypt" : "decrypt" ) << " in parallel" << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef PARALLEL_AES_H
+#define PARALLEL_AES_H
+
+#include <openssl/evp.h>
+#include <stddef.h>
+
+/**
+ * @brief number of bytes handed to a worker thread at a time; a multiple of the block size
+ */
+constexpr size_t PARALLEL_CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * @brief check whether a mode and direction can be split into independently processed chunks
+ *
+ * ECB and CTR can in both directions. CBC can only be decrypted in parallel since every
+ * encrypted block depends on the one before it.
+ *
+ * @param mode openssl cipher
+ * @param encrypt true for encryption; false for decryption
+ *
+ * @return true if the mode and direction are supported by parallel_crypt()
+ */
+bool is_parallel_mode( EVP_CIPHER const* mode, bool encrypt );
+
+/**
+ * @brief encrypt or decrypt a buffer by splitting it into chunks processed on worker threads
+ *
+ * The input is split into chunks of PARALLEL_CHUNK_SIZE bytes which the workers take in turn,
+ * each using its own cipher context with the key expanded once. Every chunk starts from the iv
+ * the serial computation would have reached at its offset: the last ciphertext block of the
+ * previous chunk for CBC and the counter advanced by the number of preceding blocks for CTR.
+ * Results are written to the matching offset of the output, so no padding is added or removed.
+ *
+ * @param mode openssl cipher; one accepted by is_parallel_mode()
+ * @param encrypt true for encryption; false for decryption
+ * @param key encryption key
+ * @param iv initialization vector or initial counter block; ignored by ecb
+ * @param input input data
+ * @param length size of the input in bytes; a multiple of the block size unless the mode is ctr
+ * @param output output buffer of length bytes; either the input itself or not overlapping it
+ * @param threads number of worker threads
+ *
+ * @return true if successful; false otherwise;
+ */
+bool parallel_crypt(
+    EVP_CIPHER const* mode,
+    bool encrypt,
+    unsigned char const* key,
+    unsigned char const* iv,
+    unsigned char const* input,
+    size_t length,
+    unsigned char* output,
+    unsigned int threads );
+
+#endif // PARALLEL_AES_H
@@ -1,85 +1,224 @@
 #include "aes.h"
+#include "aes_native.h"
+#include "container.h"
 #include "keygen.h"
+#include "multibuffer_cbc.h"
+#include "parallel_aes.h"
+#include "perf_counters.h"
+#include "xts.h"
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <numeric>
+#include <openssl/hmac.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string>
+#include <thread>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define TEST_TSC 1
+#endif
+
+/**
+ * @brief summary of a set of running time samples in nanoseconds
+ */
+struct run_stats
+{
+    double min;
+    double max;
+    double mean;
+    double variance;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+};
+
+/**
+ * @brief get a percentile of sorted samples, interpolating between the two closest ranks
+ *
+ * @param sorted samples in ascending order; must not be empty
+ * @param fraction percentile as a fraction between 0 and 1
+ *
+ * @return value of the percentile
+ */
+static double percentile( std::vector<double> const& sorted, double const fraction )
+{
+    double const rank = fraction * ( sorted.size() - 1 );
+    size_t const lower = static_cast<size_t>( rank );
+    size_t const upper = std::min( lower + 1, sorted.size() - 1 );
+
+    return sorted[lower] + ( sorted[upper] - sorted[lower] ) * ( rank - lower );
+}
+
+/**
+ * @brief calculate running time statistics
+ *
+ * @param samples running times in nanoseconds; sorted in place; must not be empty
+ *
+ * @return statistics of the samples; the variance is the unbiased sample variance
+ */
+static run_stats get_stats( std::vector<double>& samples )
+{
+    std::sort( samples.begin(), samples.end() );
+
+    run_stats stats{};
+
+    stats.min  = samples.front();
+    stats.max  = samples.back();
+    stats.mean = std::accumulate( samples.begin(), samples.end(), 0.0 ) / samples.size();
+
+    // sum the squared deviations from the mean
+    for ( double const sample : samples ) {
+        stats.variance += ( sample - stats.mean ) * ( sample - stats.mean );
+    }
+
+    stats.variance = samples.size() > 1 ? stats.variance / ( samples.size() - 1 ) : 0.0;
+
+    stats.p50  = percentile( samples, 0.5 );
+    stats.p90  = percentile( samples, 0.9 );
+    stats.p99  = percentile( samples, 0.99 );
+    stats.p999 = percentile( samples, 0.999 );
+
+    return stats;
+}
 
 /**
  * @brief calculate and output running time statistics
  *
  * @param results a vector of time durations
  */
-static void output_stats( std::vector<std::chrono::high_resolution_clock::duration>& results )
+static void output_stats( std::vector<std::chrono::high_resolution_clock::duration> const& results )
 {
-    // get the total run time of all test iterations
-    const std::chrono::high_resolution_clock::duration total_runtime = std::accumulate(
-        results.begin(),
-        results.end(),
-        std::chrono::high_resolution_clock::duration{ 0 },
-        [&]( auto const & run, auto const & cur ) {
-            return run + cur;
-        }
-    );
+    // convert the durations to nanoseconds
+    std::vector<double> samples( results.size() );
 
-    // sort the result data
-    std::sort( results.begin(), results.end() );
+    std::transform( results.begin(), results.end(), samples.begin(), []( auto const & result ) {
+        return std::chrono::duration<double, std::nano>( result ).count();
+    } );
 
     // calculate stats
-    const auto min    = std::chrono::duration_cast<std::chrono::nanoseconds>( results[0] ).count();
-    const auto max    = std::chrono::duration_cast<std::chrono::nanoseconds>( results[results.size() - 1] ).count();
-    const auto total  = std::chrono::duration_cast<std::chrono::nanoseconds>( total_runtime ).count();
-    const auto mean   = std::chrono::duration_cast<std::chrono::nanoseconds>( total_runtime / results.size() ).count();;
-
-    // calculate the median
-    const auto median = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        ( results.size() % 1 ) ?
-        results[results.size() / 2 + 1] :
-        ( results[results.size() / 2] + results[results.size() / 2 + 1] ) / 2 ).count();
-
-    // calculate the variance
-    const auto variance = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::accumulate(
-            results.begin(),
-            results.end(),
-            std::chrono::high_resolution_clock::duration{ 0 },
-            [&]( const auto & run, const auto & cur ) {
-                return run + ( cur - ( total_runtime / results.size() ) ) * 2;
-            }
-        )
-    ).count();
+    const run_stats stats = get_stats( samples );
+    const double total = stats.mean * samples.size();
 
     // output parameters to the cli
     std::cout << "run time test parameters\n";
     std::cout << " iterations         = " << results.size() << "\n";
     std::cout << "\n";
 
-    // output results to the cli
+    // output results to the cli in whole nanoseconds
+    const auto flags = std::cout.flags();
+    const auto precision = std::cout.precision( 0 );
+
+    std::cout << std::fixed;
     std::cout << "run time test results\n";
-    std::cout << " min run time      = " << std::setw( 10 ) << min      << " ns\n";
-    std::cout << " max run time      = " << std::setw( 10 ) << max      << " ns\n";
-    std::cout << " mean run time     = " << std::setw( 10 ) << mean     << " ns\n";
-    std::cout << " run time variance = " << std::setw( 10 ) << variance << " ns\n";
-    std::cout << " median run time   = " << std::setw( 10 ) << median   << " ns\n";
-    std::cout << " total run time    = " << std::setw( 10 ) << total    << " ns\n";
+    std::cout << " min run time      = " << std::setw( 10 ) << stats.min                  << " ns\n";
+    std::cout << " max run time      = " << std::setw( 10 ) << stats.max                  << " ns\n";
+    std::cout << " mean run time     = " << std::setw( 10 ) << stats.mean                 << " ns\n";
+    std::cout << " run time variance = " << std::setw( 10 ) << stats.variance             << " ns^2\n";
+    std::cout << " run time std dev  = " << std::setw( 10 ) << std::sqrt( stats.variance ) << " ns\n";
+    std::cout << " median run time   = " << std::setw( 10 ) << stats.p50                  << " ns\n";
+    std::cout << " p90 run time      = " << std::setw( 10 ) << stats.p90                  << " ns\n";
+    std::cout << " p99 run time      = " << std::setw( 10 ) << stats.p99                  << " ns\n";
+    std::cout << " p99.9 run time    = " << std::setw( 10 ) << stats.p999                 << " ns\n";
+    std::cout << " total run time    = " << std::setw( 10 ) << total                      << " ns\n";
     std::cout << std::endl;
+
+    std::cout.flags( flags );
+    std::cout.precision( precision );
+}
+
+/**
+ * @brief output hardware counter totals per iteration and per byte
+ *
+ * @param counters counters stopped after the measured iterations
+ * @param iterations number of measured iterations
+ * @param bytes bytes processed per iteration; zero to omit the per byte ratios
+ */
+static void output_counters( perf_counters const& counters, unsigned int const iterations, size_t const bytes )
+{
+    if ( !counters.any_available() ) {
+        std::cout << "hardware counters unavailable (" << counters.error() << ")\n" << std::endl;
+        return;
+    }
+
+    const auto flags = std::cout.flags();
+    const auto precision = std::cout.precision( 2 );
+
+    std::cout << std::fixed;
+    std::cout << "hardware counter results" << ( bytes ? " (per iteration | per byte)\n" : " (per iteration)\n" );
+
+    // output a count per iteration and per byte
+    auto const output = [&]( char const* const name, perf_counter const counter ) {
+        const double count = counters.value( counter );
+
+        std::cout << " " << name << " = ";
+
+        if ( count < 0 ) {
+            std::cout << std::setw( 12 ) << "unavailable" << "\n";
+            return;
+        }
+
+        std::cout << std::setw( 12 ) << count / iterations;
+
+        if ( bytes ) {
+            std::cout << " | " << std::setw( 10 ) << std::setprecision( 4 ) << count / iterations / bytes << std::setprecision( 2 );
+        }
+
+        std::cout << "\n";
+    };
+
+    output( "cycles           ", perf_counter::CYCLES );
+    output( "instructions     ", perf_counter::INSTRUCTIONS );
+    output( "cache misses     ", perf_counter::CACHE_MISSES );
+    output( "branch misses    ", perf_counter::BRANCH_MISSES );
+    output( "LLC load misses  ", perf_counter::LLC_LOAD_MISSES );
+
+    // instructions per cycle
+    const double cycles = counters.value( perf_counter::CYCLES );
+    const double instructions = counters.value( perf_counter::INSTRUCTIONS );
+
+    if ( cycles > 0 && instructions >= 0 ) {
+        std::cout << " IPC               = " << std::setw( 12 ) << instructions / cycles << "\n";
+    }
+
+    std::cout << std::endl;
+
+    std::cout.flags( flags );
+    std::cout.precision( precision );
 }
 
 /**
  * @brief Runs a functor object the given number of iterations, tracks elapsed runtime, and outputs statistics
  *
+ * A tenth of the iterations are run first without timing to warm the caches, branch predictors,
+ * and clock frequency. Hardware counters are collected over all measured iterations.
+ *
  * @tparam T type of functor object
  * @param iterations number of iterations
  * @param f functor object to be timed
+ * @param bytes bytes processed per iteration; zero to omit the per byte counter ratios
  */
 template<class T>
-static void test_running_time( unsigned int const iterations, T const& f )
+static void test_running_time( unsigned int const iterations, T const& f, size_t const bytes = 0 )
 {
+    // warm up without recording
+    for ( unsigned int i = 0 ; i < std::max( iterations / 10, 1u ) ; ++i ) {
+        f();
+    }
+
     // allocate an array with an element for each test run
     std::vector<std::chrono::high_resolution_clock::duration> results( iterations );
 
+    // count hardware events across the measured runs
+    perf_counters counters;
+    counters.start();
+
     // run the test repeatedly
     for ( unsigned int i = 0 ; i < iterations ; ++i ) {
 
@@ -100,8 +239,11 @@ static void test_running_time( unsigned int const iterations, T const& f )
 
     }
 
+    counters.stop();
+
     // calculate and output statistics for our test iterations
     output_stats( results );
+    output_counters( counters, iterations, bytes );
 }
 
 void test_ecb( unsigned int const iterations, std::vector<unsigned char> const& key, std::vector<unsigned char> const& plaintext )
@@ -109,6 +251,10 @@ void test_ecb( unsigned int const iterations, std::vector<unsigned char> const&
     // create an aes context for ecb
     aes aes_ecb_ctx( EVP_aes_256_ecb(), key.data(), NULL );
 
+    // allocate the output buffer once so that only the cipher is timed
+    std::vector<unsigned char> output( ciphertext_capacity( 0, plaintext.size() ) );
+    byte_span const out{ output.data(), output.size() };
+
     std::cout << "running ECB encryption test" << std::endl;
 
     // run test iterations
@@ -116,22 +262,24 @@ void test_ecb( unsigned int const iterations, std::vector<unsigned char> const&
         iterations,
         [&]() {
             // perform encryption
-            std::vector<unsigned char> ciphertext{ aes_ecb_ctx.encrypt( plaintext.data(), plaintext.size() ) };
-        }
+            aes_ecb_ctx.encrypt( out, plaintext.data(), plaintext.size() );
+        },
+        plaintext.size()
     );
 
     std::cout << "running ECB decryption test" << std::endl;
 
-    // allocate and populate a ciphertext buffer
-    std::vector<unsigned char> const ciphertext{ plaintext };
+    // decrypt a real ciphertext, padding block included
+    std::vector<unsigned char> const ciphertext = aes_ecb_ctx.encrypt( plaintext.data(), plaintext.size() );
 
     // run test iterations
     test_running_time(
         iterations,
         [&]() {
             // perform decryption
-            std::vector<unsigned char> plain{ aes_ecb_ctx.decrypt( ciphertext.data(), ciphertext.size() ) };
-        }
+            aes_ecb_ctx.decrypt( out, ciphertext.data(), ciphertext.size() );
+        },
+        plaintext.size()
     );
 }
 
@@ -146,6 +294,10 @@ void test_cbc_fixed_iv(
     // create an aes context for cbc
     aes aes_cbc_ctx( EVP_aes_256_cbc(), key.data(), iv.data() );
 
+    // allocate the output buffer once so that only the cipher is timed
+    std::vector<unsigned char> output( ciphertext_capacity( 0, plaintext.size() ) );
+    byte_span const out{ output.data(), output.size() };
+
     std::cout << "running CBC w/ fixed IV encryption test" << std::endl;
 
     // run test iterations
@@ -153,22 +305,24 @@ void test_cbc_fixed_iv(
         iterations,
         [&]() {
             // perform encryption
-            std::vector<unsigned char> ciphertext{ aes_cbc_ctx.encrypt( plaintext.data(), plaintext.size() ) };
-        }
+            aes_cbc_ctx.encrypt( out, plaintext.data(), plaintext.size() );
+        },
+        plaintext.size()
     );
 
     std::cout << "running CBC w/ fixed IV decryption test" << std::endl;
 
-    // allocate and populate a ciphertext buffer
-    std::vector<unsigned char> const ciphertext{ plaintext };
+    // decrypt a real ciphertext, padding block included
+    std::vector<unsigned char> const ciphertext = aes_cbc_ctx.encrypt( plaintext.data(), plaintext.size() );
 
     // run test iterations
     test_running_time(
         iterations,
         [&]() {
             // perform decryption
-            std::vector<unsigned char> plain{ aes_cbc_ctx.decrypt( ciphertext.data(), ciphertext.size() ) };
-        }
+            aes_cbc_ctx.decrypt( out, ciphertext.data(), ciphertext.size() );
+        },
+        plaintext.size()
     );
 }
 
@@ -177,6 +331,9 @@ void test_cbc_random_iv(
     std::vector<unsigned char> const& key,
     std::vector<unsigned char> const& plaintext )
 {
+    // allocate the output buffer once so that only the cipher is timed
+    std::vector<unsigned char> output( ciphertext_capacity( 0, plaintext.size() ) );
+    byte_span const out{ output.data(), output.size() };
 
     std::cout << "running CBC w/ random IV encryption test" << std::endl;
 
@@ -191,14 +348,16 @@ void test_cbc_random_iv(
             aes aes_cbc_ctx( EVP_aes_256_cbc(), key.data(), iv.data() );
 
             // perform encryption
-            std::vector<unsigned char> ciphertext{ aes_cbc_ctx.encrypt( plaintext.data(), plaintext.size() ) };
-        }
+            aes_cbc_ctx.encrypt( out, plaintext.data(), plaintext.size() );
+        },
+        plaintext.size()
     );
 
     std::cout << "running CBC w/ random IV decryption test" << std::endl;
 
-    // allocate and populate a ciphertext buffer
-    std::vector<unsigned char> const ciphertext{ plaintext };
+    // decrypt a real ciphertext, padding block included; a different iv only changes the first block
+    auto const ciphertext_iv = keygen( 128 );
+    std::vector<unsigned char> const ciphertext = aes( EVP_aes_256_cbc(), key.data(), ciphertext_iv.data() ).encrypt( plaintext.data(), plaintext.size() );
 
     // run test iterations
     test_running_time(
@@ -211,13 +370,1080 @@ void test_cbc_random_iv(
             aes aes_cbc_ctx( EVP_aes_256_cbc(), key.data(), iv.data() );
 
             // perform decryption
-            std::vector<unsigned char> plain{ aes_cbc_ctx.decrypt( ciphertext.data(), ciphertext.size() ) };
-        }
+            aes_cbc_ctx.decrypt( out, ciphertext.data(), ciphertext.size() );
+        },
+        plaintext.size()
     );
 }
 
+/**
+ * @brief measure the mean time of an operation over many back to back runs
+ *
+ * @tparam T type of functor object
+ * @param iterations number of iterations
+ * @param f functor object to be timed
+ *
+ * @return mean run time in nanoseconds
+ */
+template<class T>
+static double mean_running_time( unsigned int const iterations, T const& f )
+{
+    // get the time point at the beginning of the test runs
+    const auto start_time = std::chrono::high_resolution_clock::now();
+
+    // run the test repeatedly; timing the whole batch keeps clock overhead out of small messages
+    for ( unsigned int i = 0 ; i < iterations ; ++i ) {
+        f();
+    }
+
+    // get the time point at the end of the test runs
+    const auto end_time = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double, std::nano>( end_time - start_time ).count() / iterations;
+}
+
+/**
+ * @brief compare the per message cost of re-initializing the key for every message against a keyed context
+ *
+ * @param iterations number of messages per measurement
+ * @param key encryption key
+ */
+void test_keyed_context( unsigned int const iterations, std::vector<unsigned char> const& key )
+{
+    // message sizes of typical small records
+    const size_t sizes[] = { 16, 64, 256, 1024, 4096 };
+
+    // use a fresh iv for every message as a service would
+    auto const ivs = keygen( 16 * 256 );
+
+    std::cout << "running CBC per message overhead test" << std::endl;
+    std::cout << " size | op  | full init ns | keyed ns | speedup\n";
+    std::cout << " ---- | --- | ------------ | -------- | -------\n";
+
+    for ( auto const size : sizes ) {
+
+        auto const plaintext = keygen( size );
+
+        // write every message to the same buffer so that only the key handling differs
+        std::vector<unsigned char> output( ciphertext_capacity( 0, size ) );
+        byte_span const out{ output.data(), output.size() };
+
+        // encryption re-initializing the key schedule for every message
+        unsigned int message = 0;
+        double const full_encrypt = mean_running_time( iterations, [&]() {
+            aes aes_cbc_ctx( EVP_aes_256_cbc(), key.data(), ivs.data() + 16 * ( message++ % 256 ) );
+            aes_cbc_ctx.encrypt( out, plaintext.data(), plaintext.size() );
+        } );
+
+        // encryption with the key expanded once
+        keyed_aes keyed_ctx( EVP_aes_256_cbc(), key.data() );
+        double const keyed_encrypt = mean_running_time( iterations, [&]() {
+            keyed_ctx.encrypt( out, ivs.data() + 16 * ( message++ % 256 ), 0, plaintext.data(), plaintext.size() );
+        } );
+
+        // decryption both ways; the plaintext stands in for a ciphertext of whole blocks
+        double const full_decrypt = mean_running_time( iterations, [&]() {
+            aes aes_cbc_ctx( EVP_aes_256_cbc(), key.data(), ivs.data() + 16 * ( message++ % 256 ) );
+            aes_cbc_ctx.decrypt( out, plaintext.data(), plaintext.size() );
+        } );
+
+        double const keyed_decrypt = mean_running_time( iterations, [&]() {
+            keyed_ctx.decrypt( out, ivs.data() + 16 * ( message++ % 256 ), plaintext.data(), plaintext.size() );
+        } );
+
+        std::cout << std::fixed << std::setprecision( 1 )
+            << " " << std::setw( 4 ) << size << " | enc | " << std::setw( 12 ) << full_encrypt << " | " << std::setw( 8 ) << keyed_encrypt
+            << " | " << std::setw( 6 ) << full_encrypt / keyed_encrypt << "x\n"
+            << " " << std::setw( 4 ) << size << " | dec | " << std::setw( 12 ) << full_decrypt << " | " << std::setw( 8 ) << keyed_decrypt
+            << " | " << std::setw( 6 ) << full_decrypt / keyed_decrypt << "x\n";
+    }
+
+    std::cout << std::endl;
+}
+
+/**
+ * @brief compare returning a new vector per message against writing into a caller buffer and in place
+ *
+ * @param iterations number of messages per measurement
+ * @param key encryption key
+ */
+void test_span_api( unsigned int const iterations, std::vector<unsigned char> const& key )
+{
+    // message sizes of typical small records
+    const size_t sizes[] = { 16, 64, 256, 1024, 4096 };
+
+    auto const iv = keygen( AES_BLOCK_SIZE );
+
+    keyed_aes keyed_ctx( EVP_aes_256_cbc(), key.data() );
+
+    std::cout << "running CBC output buffer test (ns per message)" << std::endl;
+    std::cout << " size | vector   | span     | in place | speedup\n";
+    std::cout << " ---- | -------- | -------- | -------- | -------\n";
+
+    for ( auto const size : sizes ) {
+
+        auto const plaintext = keygen( size );
+
+        // allocate and return a ciphertext for every message; the iv is stored separately
+        double const allocating = mean_running_time( iterations, [&]() {
+            std::vector<unsigned char> ciphertext{ keyed_ctx.encrypt( iv.data(), plaintext.data(), plaintext.size() ) };
+        } );
+
+        // write the iv and ciphertext into a buffer allocated once
+        std::vector<unsigned char> output( ciphertext_capacity( AES_BLOCK_SIZE, size ) );
+        byte_span const out{ output.data(), output.size() };
+
+        double const span = mean_running_time( iterations, [&]() {
+            keyed_ctx.encrypt( out, iv.data(), AES_BLOCK_SIZE, plaintext.data(), plaintext.size() );
+        } );
+
+        // encrypt the message where it lies behind the iv slot
+        double const in_place = mean_running_time( iterations, [&]() {
+            std::copy( plaintext.begin(), plaintext.end(), output.begin() + AES_BLOCK_SIZE );
+            keyed_ctx.encrypt( out, iv.data(), AES_BLOCK_SIZE, output.data() + AES_BLOCK_SIZE, size );
+        } );
+
+        // verify the in place ciphertext against the allocating api
+        auto const expected = keyed_ctx.encrypt( iv.data(), plaintext.data(), plaintext.size() );
+
+        if ( !std::equal( expected.begin(), expected.end(), output.begin() + AES_BLOCK_SIZE ) ||
+             !std::equal( iv.begin(), iv.end(), output.begin() ) ) {
+            std::cout << "ERROR: in place ciphertext mismatch for size " << size << std::endl;
+        }
+
+        std::cout << std::fixed << std::setprecision( 1 )
+            << " " << std::setw( 4 ) << size << " | " << std::setw( 8 ) << allocating << " | " << std::setw( 8 ) << span
+            << " | " << std::setw( 8 ) << in_place << " | " << std::setw( 6 ) << allocating / span << "x\n";
+    }
+
+    std::cout << std::endl;
+}
+
+/**
+ * @brief measure how the parallel engine scales with the thread count and check it against the serial result
+ *
+ * @param size size of the test message in bytes
+ * @param key encryption key
+ */
+void test_parallel_scaling( size_t const size, std::vector<unsigned char> const& key )
+{
+    // modes and directions whose chunks are independent
+    struct parallel_case {
+        char const* name;
+        EVP_CIPHER const* mode;
+        bool encrypt;
+    };
+
+    const parallel_case cases[] = {
+        { "ecb enc", EVP_aes_256_ecb(), true },
+        { "ecb dec", EVP_aes_256_ecb(), false },
+        { "cbc dec", EVP_aes_256_cbc(), false },
+        { "ctr enc", EVP_aes_256_ctr(), true },
+    };
+
+    // test up to twice the number of cores to show where scaling stops
+    const unsigned int max_threads = 2 * std::max( 1u, std::thread::hardware_concurrency() );
+
+    auto const iv = keygen( AES_BLOCK_SIZE );
+    auto const input = keygen( size );
+    std::vector<unsigned char> output( size );
+
+    std::cout << "running parallel engine scaling test (" << size / ( 1024 * 1024 ) << " MiB)" << std::endl;
+    std::cout << " mode    | threads | MB/s     | speedup\n";
+    std::cout << " ------- | ------- | -------- | -------\n";
+
+    for ( auto const& test : cases ) {
+
+        // compute the reference result on a single context
+        EVP_CIPHER_CTX* const ctx = EVP_CIPHER_CTX_new();
+        std::vector<unsigned char> expected( size );
+        int len = 0;
+
+        EVP_CipherInit_ex( ctx, test.mode, NULL, key.data(), iv.data(), test.encrypt ? 1 : 0 );
+        EVP_CIPHER_CTX_set_padding( ctx, 0 );
+        EVP_CipherUpdate( ctx, expected.data(), &len, input.data(), static_cast<int>( size ) );
+        EVP_CIPHER_CTX_free( ctx );
+
+        double single = 0;
+
+        for ( unsigned int threads = 1 ; threads <= max_threads ; threads *= 2 ) {
+
+            double const ns = mean_running_time( 4, [&]() {
+                parallel_crypt( test.mode, test.encrypt, key.data(), iv.data(), input.data(), size, output.data(), threads );
+            } );
+
+            // verify the chunks reproduce the serial result
+            if ( output != expected ) {
+                std::cout << " " << test.name << " | " << std::setw( 7 ) << threads << " | MISMATCH\n";
+                continue;
+            }
+
+            single = threads == 1 ? ns : single;
+
+            std::cout << std::fixed << std::setprecision( 1 )
+                << " " << test.name << " | " << std::setw( 7 ) << threads << " | " << std::setw( 8 ) << size / ns * 1000
+                << " | " << std::setw( 6 ) << single / ns << "x\n";
+        }
+    }
+
+    std::cout << std::endl;
+}
+
+/**
+ * @brief compare decrypting a slice of a ctr message from its counter block against decrypting from the start
+ *
+ * @param size size of the test message in bytes
+ * @param key encryption key
+ */
+void test_ctr_range( size_t const size, std::vector<unsigned char> const& key )
+{
+    // slice sizes of typical random access reads
+    const size_t slices[] = { 16, 4096, 1024 * 1024 };
+
+    auto const iv = keygen( AES_BLOCK_SIZE );
+    auto const ciphertext = keygen( size );
+
+    keyed_aes ctr_ctx( EVP_aes_256_ctr(), key.data() );
+
+    // decrypt the whole message once as the reference
+    auto const expected = ctr_ctx.decrypt( iv.data(), ciphertext.data(), ciphertext.size() );
+
+    std::cout << "running CTR range decryption test (" << size / ( 1024 * 1024 ) << " MiB)" << std::endl;
+    std::cout << " slice   | from start ns | seek ns    | speedup\n";
+    std::cout << " ------- | ------------- | ---------- | -------\n";
+
+    for ( auto const slice : slices ) {
+
+        // take the slice from an unaligned offset near the end of the message
+        size_t const offset = size - slice - 7;
+
+        // decrypt everything up to the end of the slice
+        double const from_start = mean_running_time( 4, [&]() {
+            std::vector<unsigned char> plain{ ctr_ctx.decrypt( iv.data(), ciphertext.data(), offset + slice ) };
+        } );
+
+        std::vector<unsigned char> plaintext;
+
+        // decrypt only the blocks covering the slice
+        double const seek = mean_running_time( 4, [&]() {
+            unsigned char counter[AES_BLOCK_SIZE];
+            size_t const start = offset - offset % AES_BLOCK_SIZE;
+            ctr_advance( counter, iv.data(), start / AES_BLOCK_SIZE );
+            plaintext = ctr_ctx.decrypt( counter, ciphertext.data() + start, offset + slice - start );
+            plaintext.erase( plaintext.begin(), plaintext.begin() + ( offset - start ) );
+        } );
+
+        // verify the seek reproduces the matching part of the full decryption
+        if ( !std::equal( plaintext.begin(), plaintext.end(), expected.begin() + offset ) ) {
+            std::cout << " " << std::setw( 7 ) << slice << " | MISMATCH\n";
+            continue;
+        }
+
+        std::cout << std::fixed << std::setprecision( 1 )
+            << " " << std::setw( 7 ) << slice << " | " << std::setw( 13 ) << from_start << " | " << std::setw( 10 ) << seek
+            << " | " << std::setw( 6 ) << from_start / seek << "x\n";
+    }
+
+    std::cout << std::endl;
+}
+
+/**
+ * @brief measure packing and unpacking a chunked container and reading ranges of it
+ *
+ * @param size size of the test file in bytes
+ * @param key encryption key
+ */
+void test_container( size_t const size, std::vector<unsigned char> const& key )
+{
+    char const plaintext_path[] = "container_plaintext.bin";
+    char const container_path[] = "container.bin";
+    char const output_path[]    = "container_output.bin";
+
+    // write a random test file
+    auto const plaintext = keygen( size );
+    FILE* const os = fopen( plaintext_path, "wb" );
+
+    if ( !os || 1 != fwrite( plaintext.data(), plaintext.size(), 1, os ) || fclose( os ) != 0 ) {
+        std::cout << "ERROR: failed to write '" << plaintext_path << "'" << std::endl;
+        return;
+    }
+
+    unsigned int const max_threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+    std::cout << "running container test (" << size / ( 1024 * 1024 ) << " MiB, " << CONTAINER_CHUNK_SIZE / 1024 << " KiB chunks)" << std::endl;
+    std::cout << " mode | threads | pack MB/s | unpack MB/s | 4 KiB read-range us | full unpack us\n";
+    std::cout << " ---- | ------- | --------- | ----------- | ------------------- | --------------\n";
+
+    for ( auto const& test : { std::make_pair( "cbc ", EVP_aes_256_cbc() ), std::make_pair( "gcm ", EVP_aes_256_gcm() ) } ) {
+
+        for ( unsigned int threads = 1 ; threads <= max_threads ; threads *= 2 ) {
+
+            bool status = true;
+
+            double const pack = mean_running_time( 2, [&]() {
+                status = container_pack( test.second, key.data(), plaintext_path, container_path, CONTAINER_CHUNK_SIZE, threads ) && status;
+            } );
+
+            double const unpack = mean_running_time( 2, [&]() {
+                status = container_unpack( key.data(), container_path, output_path, threads ) && status;
+            } );
+
+            // drop the unpacked file so that truncating it is not timed with the first range
+            remove( output_path );
+
+            // read a page from an unaligned offset spanning two chunks near the end of the file
+            uint64_t const offset = size - CONTAINER_CHUNK_SIZE - 2048 - 7;
+
+            double const range = mean_running_time( 16, [&]() {
+                status = container_read_range( key.data(), container_path, offset, 4096, output_path ) && status;
+            } );
+
+            // verify the range against the original file
+            FILE* const is = fopen( output_path, "rb" );
+            std::vector<unsigned char> page( 4096 );
+
+            if ( !is || 1 != fread( page.data(), page.size(), 1, is ) ||
+                 !std::equal( page.begin(), page.end(), plaintext.begin() + offset ) ) {
+                status = false;
+            }
+
+            if ( is ) {
+                fclose( is );
+            }
+
+            if ( !status ) {
+                std::cout << " " << test.first << " | MISMATCH\n";
+                continue;
+            }
+
+            std::cout << std::fixed << std::setprecision( 1 )
+                << " " << test.first << " | " << std::setw( 7 ) << threads << " | " << std::setw( 9 ) << size / pack * 1000
+                << " | " << std::setw( 11 ) << size / unpack * 1000 << " | " << std::setw( 19 ) << range / 1000
+                << " | " << std::setw( 14 ) << unpack / 1000 << "\n";
+        }
+    }
+
+    remove( plaintext_path );
+    remove( container_path );
+    remove( output_path );
+
+    std::cout << std::endl;
+}
+
+/**
+ * @brief compare xts sector encryption of an image against cbc and updating one sector against re-encrypting the image
+ *
+ * @param size size of the test image in bytes; a multiple of the sector size
+ */
+void test_xts( size_t const size )
+{
+    auto const key = keygen( XTS_KEY_SIZE );
+    auto const iv = keygen( AES_BLOCK_SIZE );
+    auto const image = keygen( size );
+
+    xts_sectors xts_ctx( key.data() );
+    keyed_aes cbc_ctx( EVP_aes_256_cbc(), key.data() );
+
+    std::vector<unsigned char> sectors( image );
+    std::vector<unsigned char> output( ciphertext_capacity( AES_BLOCK_SIZE, size ) );
+
+    std::cout << "running XTS sector test (" << size / ( 1024 * 1024 ) << " MiB image, " << XTS_SECTOR_SIZE << " byte sectors)" << std::endl;
+
+    // encrypt the whole image; xts in place and the same length, cbc into a longer buffer
+    double const xts_image = mean_running_time( 4, [&]() {
+        xts_ctx.encrypt( sectors.data(), sectors.size(), 0 );
+    } );
+
+    double const cbc_image = mean_running_time( 4, [&]() {
+        cbc_ctx.encrypt( byte_span{ output.data(), output.size() }, iv.data(), AES_BLOCK_SIZE, image.data(), image.size() );
+    } );
+
+    // encrypt the image once and keep a copy to check which sectors an update touches
+    std::copy( image.begin(), image.end(), sectors.begin() );
+    xts_ctx.encrypt( sectors.data(), sectors.size(), 0 );
+    std::vector<unsigned char> const encrypted( sectors );
+
+    // replace the plaintext of one sector in the middle of the image
+    uint64_t const dirty = size / XTS_SECTOR_SIZE / 2;
+    auto const replacement = keygen( XTS_SECTOR_SIZE );
+    std::vector<unsigned char> sector( XTS_SECTOR_SIZE );
+
+    double const xts_update = mean_running_time( 1000, [&]() {
+        std::copy( replacement.begin(), replacement.end(), sector.begin() );
+        xts_ctx.encrypt( sector.data(), sector.size(), dirty );
+    } );
+
+    std::copy( sector.begin(), sector.end(), sectors.begin() + dirty * XTS_SECTOR_SIZE );
+
+    // verify only the dirty sector changed and the image decrypts to the updated plaintext
+    bool status = true;
+
+    for ( uint64_t i = 0 ; i < size / XTS_SECTOR_SIZE ; ++i ) {
+        bool const changed = !std::equal( sectors.begin() + i * XTS_SECTOR_SIZE, sectors.begin() + ( i + 1 ) * XTS_SECTOR_SIZE,
+                                          encrypted.begin() + i * XTS_SECTOR_SIZE );
+        status = status && changed == ( i == dirty );
+    }
+
+    xts_ctx.decrypt( sectors.data(), sectors.size(), 0 );
+
+    status = status &&
+        std::equal( replacement.begin(), replacement.end(), sectors.begin() + dirty * XTS_SECTOR_SIZE ) &&
+        std::equal( image.begin(), image.begin() + dirty * XTS_SECTOR_SIZE, sectors.begin() ) &&
+        std::equal( image.begin() + ( dirty + 1 ) * XTS_SECTOR_SIZE, image.end(), sectors.begin() + ( dirty + 1 ) * XTS_SECTOR_SIZE );
+
+    if ( !status ) {
+        std::cout << " MISMATCH\n" << std::endl;
+        return;
+    }
+
+    std::cout << std::fixed << std::setprecision( 1 )
+        << " image encryption     | xts " << std::setw( 8 ) << size / xts_image * 1000 << " MB/s | cbc " << std::setw( 8 ) << size / cbc_image * 1000 << " MB/s\n"
+        << " one sector update    | xts " << std::setw( 8 ) << xts_update / 1000 << " us   | cbc " << std::setw( 8 ) << cbc_image / 1000 << " us (re-encrypt)\n"
+        << " output size          | xts " << std::setw( 8 ) << size << " B    | cbc " << std::setw( 8 ) << ciphertext_capacity( AES_BLOCK_SIZE, size ) << " B\n";
+
+    std::cout << std::endl;
+}
+
+/**
+ * @brief compare single pass authenticated encryption against cbc followed by a separate hmac pass
+ *
+ * @param key encryption key; also used as the hmac key
+ */
+void test_aead_throughput( std::vector<unsigned char> const& key )
+{
+    // message sizes from small records up to large files
+    const size_t sizes[] = { 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+
+    auto const iv = keygen( AES_BLOCK_SIZE );
+
+    keyed_aes cbc_ctx( EVP_aes_256_cbc(), key.data() );
+    keyed_aes gcm_ctx( EVP_aes_256_gcm(), key.data() );
+    keyed_aes chacha_ctx( EVP_chacha20_poly1305(), key.data() );
+
+    std::cout << "running authenticated encryption throughput test (MB/s)" << std::endl;
+    std::cout << " size     | cbc+hmac | gcm      | chacha20-poly1305\n";
+    std::cout << " -------- | -------- | -------- | -----------------\n";
+
+    for ( auto const size : sizes ) {
+
+        auto const plaintext = keygen( size );
+        unsigned char tag[EVP_MAX_MD_SIZE];
+
+        // write every message to the same buffer so that allocation stays out of the throughput
+        std::vector<unsigned char> output( ciphertext_capacity( 0, size ) );
+        byte_span const out{ output.data(), output.size() };
+        unsigned int tag_len = 0;
+
+        // keep the total amount of data per measurement roughly constant
+        unsigned int const iterations = std::max<size_t>( 4, 256 * 1024 * 1024 / size / 4 );
+
+        // encrypt then authenticate the ciphertext in a second pass
+        double const cbc_hmac = mean_running_time( iterations, [&]() {
+            size_t const ciphertext_len = cbc_ctx.encrypt( out, iv.data(), 0, plaintext.data(), plaintext.size() );
+            HMAC( EVP_sha256(), key.data(), static_cast<int>( key.size() ), output.data(), ciphertext_len, tag, &tag_len );
+        } );
+
+        // encrypt and authenticate in a single pass
+        double const gcm = mean_running_time( iterations, [&]() {
+            gcm_ctx.encrypt( out, iv.data(), 0, plaintext.data(), plaintext.size() );
+            gcm_ctx.get_tag( tag, 16 );
+        } );
+
+        double const chacha = mean_running_time( iterations, [&]() {
+            chacha_ctx.encrypt( out, iv.data(), 0, plaintext.data(), plaintext.size() );
+            chacha_ctx.get_tag( tag, 16 );
+        } );
+
+        std::cout << std::fixed << std::setprecision( 1 )
+            << " " << std::setw( 8 ) << size << " | " << std::setw( 8 ) << size / cbc_hmac * 1000
+            << " | " << std::setw( 8 ) << size / gcm * 1000 << " | " << std::setw( 8 ) << size / chacha * 1000 << "\n";
+    }
+
+    std::cout << std::endl;
+}
+
+/**
+ * @brief compare multi-buffer cbc encryption of many files against encrypting them one at a time
+ *
+ * @param key encryption key
+ */
+void test_multibuffer_cbc( std::vector<unsigned char> const& key )
+{
+    // file sizes of a typical batch
+    const size_t sizes[] = { 4096, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024 };
+
+    // encrypt about this many bytes per measurement
+    const size_t batch_bytes = 64 * 1024 * 1024;
+
+    std::cout << "running multi-buffer CBC batch encryption test ("
+        << ( multibuffer_cbc_supported() ? "aes-ni" : "no aes-ni; serial fallback" ) << ")" << std::endl;
+    std::cout << " file size | files | serial MB/s | multi-buffer MB/s | speedup\n";
+    std::cout << " --------- | ----- | ----------- | ----------------- | -------\n";
+
+    for ( auto const size : sizes ) {
+
+        // build a batch of files with their own ivs
+        size_t const files = batch_bytes / size;
+        auto const data = keygen( files * size );
+        auto const ivs = keygen( files * AES_BLOCK_SIZE );
+
+        std::vector<cbc_message> messages;
+
+        for ( size_t i = 0 ; i < files ; ++i ) {
+            messages.push_back( { ivs.data() + i * AES_BLOCK_SIZE, data.data() + i * size, size } );
+        }
+
+        std::vector<std::vector<unsigned char>> serial_result;
+        std::vector<std::vector<unsigned char>> multibuffer_result;
+
+        double const serial = mean_running_time( 2, [&]() {
+            serial_result = cbc_encrypt_batch( key.data(), messages, false );
+        } );
+
+        double const multibuffer = mean_running_time( 2, [&]() {
+            multibuffer_result = cbc_encrypt_batch( key.data(), messages, true );
+        } );
+
+        // verify both paths produce the same ciphertexts
+        if ( serial_result != multibuffer_result ) {
+            std::cout << " " << std::setw( 9 ) << size << " | MISMATCH\n";
+            continue;
+        }
+
+        std::cout << std::fixed << std::setprecision( 1 )
+            << " " << std::setw( 9 ) << size << " | " << std::setw( 5 ) << files
+            << " | " << std::setw( 11 ) << batch_bytes / serial * 1000
+            << " | " << std::setw( 17 ) << batch_bytes / multibuffer * 1000
+            << " | " << std::setw( 6 ) << serial / multibuffer << "x\n";
+    }
+
+    std::cout << std::endl;
+}
+
+/**
+ * @brief check the native backends against evp and compare their per message cost
+ *
+ * @param iterations number of messages per measurement
+ * @param key encryption key
+ */
+void test_native_backend( unsigned int const iterations, std::vector<unsigned char> const& key )
+{
+    // modes with native kernels
+    struct native_case {
+        char const* name;
+        EVP_CIPHER const* mode;
+    };
+
+    const native_case cases[] = {
+        { "ecb", EVP_aes_256_ecb() },
+        { "cbc", EVP_aes_256_cbc() },
+        { "ctr", EVP_aes_256_ctr() },
+    };
+
+    // collect the native backends this build and processor run
+    std::vector<aes_backend> backends;
+
+    for ( auto const backend : { aes_backend::AESNI, aes_backend::VAES } ) {
+        if ( aes_backend_supported( backend ) ) {
+            backends.push_back( backend );
+        }
+    }
+
+    std::cout << "running native backend differential test (auto selects " << aes_backend_name( detect_aes_backend() ) << ")" << std::endl;
+
+    if ( backends.empty() ) {
+        std::cout << " no native backend available\n" << std::endl;
+        return;
+    }
+
+    // every length up to several pipelines of blocks, then a few large unaligned ones
+    std::vector<size_t> lengths;
+
+    for ( size_t len = 0 ; len <= 40 * AES_BLOCK_SIZE ; ++len ) {
+        lengths.push_back( len );
+    }
+
+    for ( size_t const len : { 4096, 65536 + 7, 1024 * 1024 + 3 } ) {
+        lengths.push_back( len );
+    }
+
+    auto const data = keygen( lengths.back() + AES_BLOCK_SIZE );
+
+    // a random iv and a counter block about to carry into its high half
+    auto const random_iv = keygen( AES_BLOCK_SIZE );
+    std::vector<unsigned char> carry_iv( random_iv );
+    std::fill( carry_iv.begin() + 8, carry_iv.end(), 0xff );
+
+    std::vector<unsigned char> const* const ivs[] = { &random_iv, &carry_iv };
+
+    unsigned int checks = 0;
+    unsigned int mismatches = 0;
+
+    for ( auto const backend : backends ) {
+        for ( auto const& test : cases ) {
+
+            keyed_aes evp_ctx( test.mode, key.data() );
+            native_aes const native_ctx( backend, EVP_CIPHER_mode( test.mode ), key.data() );
+
+            for ( auto const* iv : ivs ) {
+                for ( auto const len : lengths ) {
+
+                    // compare encryption
+                    bool const encrypt_match =
+                        native_ctx.encrypt( iv->data(), data.data(), len ) == evp_ctx.encrypt( iv->data(), data.data(), len );
+
+                    // compare decryption of whole blocks
+                    bool decrypt_match = true;
+
+                    if ( EVP_CIPHER_mode( test.mode ) == EVP_CIPH_CTR_MODE || len % AES_BLOCK_SIZE == 0 ) {
+                        decrypt_match =
+                            native_ctx.decrypt( iv->data(), data.data(), len ) == evp_ctx.decrypt( iv->data(), data.data(), len );
+                    }
+
+                    if ( !encrypt_match || !decrypt_match ) {
+                        std::cout << " MISMATCH " << aes_backend_name( backend ) << " " << test.name << " length " << len << "\n";
+                        ++mismatches;
+                    }
+
+                    ++checks;
+                }
+            }
+        }
+    }
+
+    std::cout << " " << checks << " cases, " << mismatches << " mismatches\n" << std::endl;
+
+    // message sizes from single blocks up to small files
+    const size_t sizes[] = { 16, 64, 256, 1024, 4096, 65536 };
+
+    auto const iv = keygen( AES_BLOCK_SIZE );
+    std::vector<unsigned char> output( sizes[5] + AES_BLOCK_SIZE );
+
+    std::cout << "running native backend per message test (ns per message)" << std::endl;
+    std::cout << " op      | size  | evp      ";
+
+    for ( auto const backend : backends ) {
+        std::cout << " | " << std::setw( 9 ) << aes_backend_name( backend );
+    }
+
+    std::cout << "\n";
+
+    for ( auto const& test : cases ) {
+
+        keyed_aes evp_ctx( test.mode, key.data() );
+
+        for ( auto const size : sizes ) {
+
+            auto const message = keygen( size );
+
+            // decryption is the direction whose blocks are independent in every mode
+            double const evp = mean_running_time( iterations, [&]() {
+                evp_ctx.decrypt( byte_span{ output.data(), output.size() }, iv.data(), message.data(), message.size() );
+            } );
+
+            std::cout << std::fixed << std::setprecision( 1 )
+                << " " << test.name << " dec | " << std::setw( 5 ) << size << " | " << std::setw( 9 ) << evp;
+
+            for ( auto const backend : backends ) {
+
+                native_aes const native_ctx( backend, EVP_CIPHER_mode( test.mode ), key.data() );
+
+                double const native = mean_running_time( iterations, [&]() {
+                    native_ctx.decrypt( output.data(), iv.data(), message.data(), message.size() );
+                } );
+
+                std::cout << " | " << std::setw( 9 ) << native;
+            }
+
+            std::cout << "\n";
+        }
+    }
+
+    std::cout << std::endl;
+}
+
+/**
+ * @brief measure how many time stamp counter cycles pass per nanosecond
+ *
+ * @return counter frequency in GHz; zero where no counter is available
+ */
+static double tsc_cycles_per_ns()
+{
+#ifdef TEST_TSC
+    // count cycles across a busy wait of a known length
+    const auto start_time = std::chrono::steady_clock::now();
+    const unsigned long long start_cycles = __rdtsc();
+
+    while ( std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds( 100 ) ) {
+    }
+
+    const unsigned long long end_cycles = __rdtsc();
+    const auto end_time = std::chrono::steady_clock::now();
+
+    return ( end_cycles - start_cycles ) / std::chrono::duration<double, std::nano>( end_time - start_time ).count();
+#else
+    return 0.0;
+#endif
+}
+
+/**
+ * @brief collect running time samples of an operation within a time budget
+ *
+ * The operation is warmed up for 20 ms and at least once. Operations shorter than the clock can
+ * resolve are run in batches of at least 20 us and each sample is the mean of its batch, so the
+ * percentiles of small payloads describe batches rather than single calls. Hardware counters
+ * are collected over all samples.
+ *
+ * @tparam T type of functor object
+ * @param budget target time spent sampling
+ * @param f functor object to be timed
+ * @param counters counters to start and stop around the samples
+ * @param operations set to the number of operations run while counting
+ *
+ * @return between 5 and 2000 samples of the time of one operation in nanoseconds
+ */
+template<class T>
+static std::vector<double> sample_running_time(
+    std::chrono::nanoseconds const budget,
+    T const& f,
+    perf_counters& counters,
+    unsigned long long& operations )
+{
+    // warm up and estimate the cost of one operation
+    unsigned long warmup_runs = 0;
+    const auto warmup_start = std::chrono::high_resolution_clock::now();
+    auto warmup_end = warmup_start;
+
+    do {
+        f();
+        ++warmup_runs;
+        warmup_end = std::chrono::high_resolution_clock::now();
+    } while ( warmup_end - warmup_start < std::chrono::milliseconds( 20 ) );
+
+    const double estimate = std::chrono::duration<double, std::nano>( warmup_end - warmup_start ).count() / warmup_runs;
+
+    // size the batches and the number of samples from the estimate
+    const unsigned long batch = std::max( 1.0, std::ceil( 20000.0 / estimate ) );
+    const size_t count = std::min( 2000.0, std::max( 5.0, budget.count() / ( estimate * batch ) ) );
+
+    std::vector<double> samples( count );
+
+    counters.start();
+
+    for ( auto& sample : samples ) {
+
+        const auto start_time = std::chrono::high_resolution_clock::now();
+
+        for ( unsigned long i = 0 ; i < batch ; ++i ) {
+            f();
+        }
+
+        const auto end_time = std::chrono::high_resolution_clock::now();
+
+        sample = std::chrono::duration<double, std::nano>( end_time - start_time ).count() / batch;
+    }
+
+    counters.stop();
+
+    operations = static_cast<unsigned long long>( batch ) * count;
+
+    return samples;
+}
+
+/**
+ * @brief format a payload size with a binary unit
+ */
+static std::string format_size( size_t size )
+{
+    static char const* const units[] = { "B", "KiB", "MiB", "GiB" };
+
+    size_t unit = 0;
+
+    while ( unit < 3 && size >= 1024 && size % 1024 == 0 ) {
+        size /= 1024;
+        ++unit;
+    }
+
+    return std::to_string( size ) + " " + units[unit];
+}
+
+/**
+ * @brief largest payload of the benchmark matrix; keeps every payload within an int length
+ */
+static constexpr size_t MATRIX_MAX_SIZE = 1024 * 1024 * 1024;
+
+/**
+ * @brief benchmark every mode, key size, direction, payload size, and thread count
+ *
+ * Payloads grow by a factor of 16 from 16 bytes and end with the given maximum. Thread counts double up
+ * to the number of hardware threads and apply to the modes parallel_crypt() splits into
+ * PARALLEL_CHUNK_SIZE chunks, for payloads with at least one chunk per thread. Every row reports
+ * percentiles, the standard deviation, and throughput at the median. Where hardware counters are
+ * available, rows add core cycles and instructions per byte, IPC, and cache, branch, and last
+ * level cache load misses per KiB, averaged over all samples. Otherwise cycles per byte are
+ * time stamp counter ticks at the median, which run at a fixed reference rate rather than
+ * the core clock.
+ *
+ * @param max_size largest payload in bytes; a multiple of the block size up to MATRIX_MAX_SIZE
+ * @param budget target sampling time of each row
+ */
+void test_matrix( size_t const max_size, std::chrono::nanoseconds const budget )
+{
+    // whole blocks keep ecb and cbc unpadded in parallel_crypt() and the last xts sector at least a block long
+    if ( max_size < AES_BLOCK_SIZE || max_size % AES_BLOCK_SIZE != 0 || max_size > MATRIX_MAX_SIZE ) {
+        std::cerr << "ERROR: invalid matrix payload size (" << max_size << " is not a multiple of " << AES_BLOCK_SIZE
+                  << " between " << AES_BLOCK_SIZE << " and " << MATRIX_MAX_SIZE << ")" << std::endl;
+        return;
+    }
+
+    struct matrix_mode
+    {
+        char const* name;
+        EVP_CIPHER const* cipher;
+        unsigned int key_bits;
+    };
+
+    std::vector<matrix_mode> const modes{
+        { "ecb",               EVP_aes_128_ecb(),         128 },
+        { "ecb",               EVP_aes_192_ecb(),         192 },
+        { "ecb",               EVP_aes_256_ecb(),         256 },
+        { "cbc",               EVP_aes_128_cbc(),         128 },
+        { "cbc",               EVP_aes_192_cbc(),         192 },
+        { "cbc",               EVP_aes_256_cbc(),         256 },
+        { "ctr",               EVP_aes_128_ctr(),         128 },
+        { "ctr",               EVP_aes_192_ctr(),         192 },
+        { "ctr",               EVP_aes_256_ctr(),         256 },
+        { "gcm",               EVP_aes_128_gcm(),         128 },
+        { "gcm",               EVP_aes_192_gcm(),         192 },
+        { "gcm",               EVP_aes_256_gcm(),         256 },
+        { "chacha20-poly1305", EVP_chacha20_poly1305(),   256 },
+        { "xts",               EVP_aes_256_xts(),         256 },
+    };
+
+    // double the thread count up to the number of hardware threads
+    const unsigned int hardware_threads = std::max( std::thread::hardware_concurrency(), 1u );
+    std::vector<unsigned int> thread_counts{ 1 };
+
+    for ( unsigned int threads = 2 ; threads < hardware_threads ; threads *= 2 ) {
+        thread_counts.push_back( threads );
+    }
+
+    if ( hardware_threads > 1 ) {
+        thread_counts.push_back( hardware_threads );
+    }
+
+    // grow payloads by a factor of 16 and always end with the largest
+    std::vector<size_t> sizes;
+
+    for ( size_t size = 16 ; size < max_size ; size *= 16 ) {
+        sizes.push_back( size );
+    }
+
+    sizes.push_back( max_size );
+
+    // allocate buffers for the largest payload once
+    auto const key = keygen( XTS_KEY_SIZE );
+    auto const iv = keygen( AES_BLOCK_SIZE );
+    auto const plaintext = keygen( max_size );
+
+    std::vector<unsigned char> ciphertext( ciphertext_capacity( 0, max_size ) );
+    std::vector<unsigned char> output( ciphertext_capacity( 0, max_size ) );
+    unsigned char tag[16];
+
+    const double ghz = tsc_cycles_per_ns();
+
+    // count hardware events over the samples of every row
+    perf_counters counters;
+    const bool core_cycles = counters.available( perf_counter::CYCLES );
+
+    std::cout << "running benchmark matrix (16 B to " << format_size( max_size ) << ", threads up to " << thread_counts.back();
+
+    if ( core_cycles ) {
+        std::cout << ", core cycles";
+    } else if ( ghz > 0.0 ) {
+        std::cout << ", time stamp counter at " << std::fixed << std::setprecision( 2 ) << ghz << " GHz";
+    }
+
+    if ( !counters.any_available() ) {
+        std::cout << ", hardware counters unavailable (" << counters.error() << ")";
+    }
+
+    std::cout << ")\n";
+    std::cout << " mode               key dir threads  payload samples      p50 ns      p90 ns      p99 ns    p99.9 ns   stddev ns     MB/s  cyc/B"
+                 "   IPC  ins/B cm/KiB brm/KiB llc/KiB\n";
+
+    for ( auto const& mode : modes ) {
+
+        const int mode_flag = EVP_CIPHER_mode( mode.cipher );
+        const bool aead = ( EVP_CIPHER_flags( mode.cipher ) & EVP_CIPH_FLAG_AEAD_CIPHER ) != 0;
+
+        std::unique_ptr<keyed_aes> aes_ctx;
+        std::unique_ptr<xts_sectors> xts_ctx;
+
+        if ( mode_flag == EVP_CIPH_XTS_MODE ) {
+            xts_ctx.reset( new xts_sectors( key.data() ) );
+        } else {
+            aes_ctx.reset( new keyed_aes( mode.cipher, key.data() ) );
+        }
+
+        for ( const size_t size : sizes ) {
+
+            const int len = static_cast<int>( size );
+            byte_span const ct_span{ ciphertext.data(), ciphertext.size() };
+            byte_span const out_span{ output.data(), output.size() };
+
+            // produce the ciphertext and tag the decryption rows start from
+            size_t ct_len = size;
+
+            if ( aes_ctx ) {
+                ct_len = aes_ctx->encrypt( ct_span, iv.data(), 0, plaintext.data(), len );
+
+                if ( aead ) {
+                    aes_ctx->get_tag( tag, sizeof( tag ) );
+                }
+            }
+
+            for ( const bool encrypt : { true, false } ) {
+                for ( const unsigned int threads : thread_counts ) {
+
+                    // only split payloads that give every thread a chunk
+                    if ( threads > 1 && ( !is_parallel_mode( mode.cipher, encrypt ) || size < threads * PARALLEL_CHUNK_SIZE ) ) {
+                        continue;
+                    }
+
+                    std::vector<double> samples;
+                    unsigned long long operations = 0;
+
+                    // stop timing the operation after its first failure
+                    bool status = true;
+
+                    try {
+                        if ( threads > 1 ) {
+                            samples = sample_running_time( budget, [&]() {
+                                status = status && parallel_crypt( mode.cipher, encrypt, key.data(), iv.data(),
+                                                                   encrypt ? plaintext.data() : ciphertext.data(), size, output.data(), threads );
+                            }, counters, operations );
+                        } else if ( xts_ctx && encrypt ) {
+                            samples = sample_running_time( budget, [&]() {
+                                xts_ctx->encrypt( output.data(), size, 0 );
+                            }, counters, operations );
+                        } else if ( xts_ctx ) {
+                            samples = sample_running_time( budget, [&]() {
+                                xts_ctx->decrypt( output.data(), size, 0 );
+                            }, counters, operations );
+                        } else if ( encrypt ) {
+                            samples = sample_running_time( budget, [&]() {
+                                aes_ctx->encrypt( out_span, iv.data(), 0, plaintext.data(), len );
+
+                                if ( aead ) {
+                                    aes_ctx->get_tag( tag, sizeof( tag ) );
+                                }
+                            }, counters, operations );
+                        } else {
+                            samples = sample_running_time( budget, [&]() {
+                                aes_ctx->decrypt( out_span, iv.data(), ciphertext.data(), static_cast<int>( ct_len ),
+                                                  aead ? tag : NULL, aead ? sizeof( tag ) : 0 );
+                            }, counters, operations );
+                        }
+                    } catch ( char const* const error ) {
+                        std::cerr << "ERROR: " << error << std::endl;
+                        counters.stop();
+                        status = false;
+                    }
+
+                    if ( !status ) {
+                        std::cout << " " << std::left << std::setw( 18 ) << mode.name << std::right
+                            << std::setw( 4 ) << mode.key_bits
+                            << std::setw( 4 ) << ( encrypt ? "enc" : "dec" )
+                            << std::setw( 8 ) << threads
+                            << std::setw( 9 ) << format_size( size )
+                            << "  FAILED\n";
+                        continue;
+                    }
+
+                    const size_t count = samples.size();
+                    const run_stats stats = get_stats( samples );
+
+                    std::cout << " " << std::left << std::setw( 18 ) << mode.name << std::right
+                        << std::setw( 4 ) << mode.key_bits
+                        << std::setw( 4 ) << ( encrypt ? "enc" : "dec" )
+                        << std::setw( 8 ) << threads
+                        << std::setw( 9 ) << format_size( size )
+                        << std::setw( 8 ) << count
+                        << std::fixed << std::setprecision( 0 )
+                        << std::setw( 12 ) << stats.p50
+                        << std::setw( 12 ) << stats.p90
+                        << std::setw( 12 ) << stats.p99
+                        << std::setw( 12 ) << stats.p999
+                        << std::setw( 12 ) << std::sqrt( stats.variance )
+                        << std::setprecision( 1 )
+                        << std::setw( 9 ) << size / stats.p50 * 1000
+                        << std::setprecision( 2 );
+
+                    // output a counter as a ratio to the bytes processed while counting
+                    auto const output_ratio = [&]( perf_counter const counter, int const width, double const unit ) {
+                        const double value = counters.value( counter );
+
+                        if ( value < 0 ) {
+                            std::cout << std::setw( width ) << "-";
+                        } else {
+                            std::cout << std::setw( width ) << value / ( static_cast<double>( operations ) * size / unit );
+                        }
+                    };
+
+                    if ( core_cycles ) {
+                        output_ratio( perf_counter::CYCLES, 7, 1.0 );
+                    } else if ( ghz > 0.0 ) {
+                        std::cout << std::setw( 7 ) << stats.p50 * ghz / size;
+                    } else {
+                        std::cout << std::setw( 7 ) << "-";
+                    }
+
+                    const double cycles = counters.value( perf_counter::CYCLES );
+                    const double instructions = counters.value( perf_counter::INSTRUCTIONS );
+
+                    if ( cycles > 0 && instructions >= 0 ) {
+                        std::cout << std::setw( 6 ) << instructions / cycles;
+                    } else {
+                        std::cout << std::setw( 6 ) << "-";
+                    }
+
+                    output_ratio( perf_counter::INSTRUCTIONS, 7, 1.0 );
+                    output_ratio( perf_counter::CACHE_MISSES, 7, 1024.0 );
+                    output_ratio( perf_counter::BRANCH_MISSES, 8, 1024.0 );
+                    output_ratio( perf_counter::LLC_LOAD_MISSES, 8, 1024.0 );
+
+                    std::cout << "\n";
+                }
+            }
+
+            std::cout << std::flush;
+        }
+    }
+
+    std::cout << std::endl;
+}
+
 int main( int argc, const char* argv[] )
 {
+    // run only the benchmark matrix when asked, up to 1 GiB payloads unless given a maximum
+    if ( argc >= 2 && std::string( argv[1] ) == "matrix" ) {
+
+        char* end = NULL;
+        const unsigned long long max_size = argc >= 3 ? strtoull( argv[2], &end, 0 ) : MATRIX_MAX_SIZE;
+
+        // accept whole blocks up to the largest matrix payload
+        if ( ( end && *end != '\0' ) || max_size < AES_BLOCK_SIZE || max_size % AES_BLOCK_SIZE != 0 || max_size > MATRIX_MAX_SIZE ) {
+            std::cerr << "usage: " << argv[0] << " [matrix [<max_payload_bytes>]]\n"
+                      << "\tmax_payload_bytes is a multiple of " << AES_BLOCK_SIZE << " up to " << MATRIX_MAX_SIZE << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        test_matrix( max_size, std::chrono::milliseconds( 200 ) );
+
+        return EXIT_SUCCESS;
+    }
+
     // set the number of iterations
     constexpr unsigned int const ITERATIONS = 5000;
 
@@ -233,5 +1459,25 @@ int main( int argc, const char* argv[] )
 
     test_cbc_random_iv( ITERATIONS, key, plaintext );
 
+    test_keyed_context( 20 * ITERATIONS, key );
+
+    test_span_api( 20 * ITERATIONS, key );
+
+    test_parallel_scaling( 64 * 1024 * 1024, key );
+
+    test_ctr_range( 64 * 1024 * 1024, key );
+
+    test_container( 64 * 1024 * 1024, key );
+
+    test_xts( 64 * 1024 * 1024 );
+
+    test_aead_throughput( key );
+
+    test_multibuffer_cbc( key );
+
+    test_native_backend( ITERATIONS, key );
+
+    test_matrix( 16 * 1024 * 1024, std::chrono::milliseconds( 50 ) );
+
     return EXIT_SUCCESS;
 }
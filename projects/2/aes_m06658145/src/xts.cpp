@@ -0,0 +1,383 @@
+#include "xts.h"
+#include "chunk_workers.h"
+#include "file_io.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <iostream>
+#include <openssl/aes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief number of bytes a worker processes at a time
+ */
+static size_t const XTS_CHUNK_SIZE = XTS_SECTORS_PER_CHUNK * XTS_SECTOR_SIZE;
+
+/**
+ * @brief check whether an image of a given size can be split into sectors
+ *
+ * @param size size of the image in bytes
+ *
+ * @return true if the image is whole sectors or its last sector holds at least one block; false otherwise;
+ */
+static bool is_valid_image_size( uint64_t size )
+{
+    return size % XTS_SECTOR_SIZE == 0 || size % XTS_SECTOR_SIZE >= AES_BLOCK_SIZE;
+}
+
+/**
+ * @brief get the number of sectors of an image, counting a partial last sector
+ *
+ * @param size size of the image in bytes
+ *
+ * @return number of sectors
+ */
+static uint64_t get_sector_count( uint64_t size )
+{
+    return ( size + XTS_SECTOR_SIZE - 1 ) / XTS_SECTOR_SIZE;
+}
+
+/**
+ * @brief encrypt or decrypt consecutive sectors in place
+ *
+ * @param ctx cipher context holding the expanded key for the direction
+ * @param data sectors
+ * @param length size of the data in bytes
+ * @param first_sector sector number of the first sector in the data
+ */
+static void crypt_sectors( EVP_CIPHER_CTX* ctx, unsigned char* data, size_t length, uint64_t first_sector )
+{
+    for ( size_t offset = 0 ; offset < length ; offset += XTS_SECTOR_SIZE ) {
+
+        size_t const size = std::min( XTS_SECTOR_SIZE, length - offset );
+
+        // ciphertext stealing needs at least one whole block
+        if ( size < AES_BLOCK_SIZE ) {
+            throw "sector shorter than one block";
+        }
+
+        // the tweak is the sector number as a 128-bit little endian value
+        unsigned char tweak[AES_BLOCK_SIZE] = {};
+        uint64_t sector = first_sector + offset / XTS_SECTOR_SIZE;
+
+        for ( size_t i = 0 ; i < sizeof( sector ) ; ++i, sector >>= 8 ) {
+            tweak[i] = static_cast<unsigned char>( sector );
+        }
+
+        // restart the context at the sector's tweak without expanding the key again
+        int len = 0;
+
+        if ( EVP_CipherInit_ex( ctx, NULL, NULL, NULL, tweak, -1 ) != 1 ||
+             EVP_CipherUpdate( ctx, data + offset, &len, data + offset, static_cast<int>( size ) ) != 1 ||
+             len != static_cast<int>( size ) ) {
+            throw "EVP_CipherUpdate() failed";
+        }
+    }
+}
+
+xts_sectors::xts_sectors( unsigned char const* key )
+    : e_ctx( EVP_CIPHER_CTX_new() )
+    , d_ctx( EVP_CIPHER_CTX_new() )
+{
+    if ( !e_ctx || !d_ctx ) {
+        EVP_CIPHER_CTX_free( e_ctx );
+        EVP_CIPHER_CTX_free( d_ctx );
+        throw "EVP_CIPHER_CTX_new() failed";
+    }
+
+    // xts is only secure with independent data and tweak keys
+    if ( memcmp( key, key + XTS_KEY_SIZE / 2, XTS_KEY_SIZE / 2 ) == 0 ) {
+        EVP_CIPHER_CTX_free( e_ctx );
+        EVP_CIPHER_CTX_free( d_ctx );
+        throw "the two halves of the xts key must differ";
+    }
+
+    // expand the key once for each direction
+    if ( EVP_CipherInit_ex( e_ctx, EVP_aes_256_xts(), NULL, key, NULL, 1 ) != 1 ||
+         EVP_CipherInit_ex( d_ctx, EVP_aes_256_xts(), NULL, key, NULL, 0 ) != 1 ) {
+        EVP_CIPHER_CTX_free( e_ctx );
+        EVP_CIPHER_CTX_free( d_ctx );
+        throw "EVP_CipherInit_ex() failed";
+    }
+}
+
+xts_sectors::~xts_sectors()
+{
+    EVP_CIPHER_CTX_free( e_ctx );
+    EVP_CIPHER_CTX_free( d_ctx );
+}
+
+void xts_sectors::encrypt( unsigned char* data, size_t length, uint64_t first_sector )
+{
+    crypt_sectors( e_ctx, data, length, first_sector );
+}
+
+void xts_sectors::decrypt( unsigned char* data, size_t length, uint64_t first_sector )
+{
+    crypt_sectors( d_ctx, data, length, first_sector );
+}
+
+bool xts_crypt_file( bool encrypt, unsigned char const* key, char const* input_path, char const* output_path, unsigned int threads )
+{
+    // open the input image for positioned reads and get its size
+    int const in_fd = open( input_path, O_RDONLY | O_CLOEXEC );
+
+    if ( in_fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << input_path << "'" << std::endl;
+        return false;
+    }
+
+    struct stat st;
+
+    if ( fstat( in_fd, &st ) != 0 ) {
+        std::cerr << "ERROR: failed to read from file '" << input_path << "'" << std::endl;
+        close( in_fd );
+        return false;
+    }
+
+    uint64_t const size = static_cast<uint64_t>( st.st_size );
+
+    if ( !is_valid_image_size( size ) ) {
+        std::cerr << "ERROR: invalid image size (last sector of " << size % XTS_SECTOR_SIZE << " < " << AES_BLOCK_SIZE << " bytes)" << std::endl;
+        close( in_fd );
+        return false;
+    }
+
+    // rewrite the image in place if the output is the input; truncating it would lose the data
+    struct stat out_st;
+    bool const in_place = stat( output_path, &out_st ) == 0 && out_st.st_dev == st.st_dev && out_st.st_ino == st.st_ino;
+
+    int const out_fd = in_place ?
+        open( output_path, O_RDWR | O_CLOEXEC ) :
+        open( output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+
+    if ( out_fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << output_path << "'" << std::endl;
+        close( in_fd );
+        return false;
+    }
+
+    // process chunks of whole sectors, each written back at its own offset
+    uint64_t const chunks = ( size + XTS_CHUNK_SIZE - 1 ) / XTS_CHUNK_SIZE;
+
+    bool status = run_chunk_workers( chunks, threads, [&]( std::atomic<uint64_t>& next_chunk ) {
+
+        try {
+            xts_sectors xts_ctx( key );
+
+            std::vector<unsigned char> buffer( XTS_CHUNK_SIZE );
+
+            for ( uint64_t chunk = next_chunk++ ; chunk < chunks ; chunk = next_chunk++ ) {
+
+                uint64_t const offset = chunk * XTS_CHUNK_SIZE;
+                size_t const length = static_cast<size_t>( std::min<uint64_t>( XTS_CHUNK_SIZE, size - offset ) );
+
+                auto const chunk_read = pread_fully( in_fd, buffer.data(), length, offset );
+
+                if ( !chunk_read.first || chunk_read.second != length ) {
+                    throw "pread() failed";
+                }
+
+                if ( encrypt ) {
+                    xts_ctx.encrypt( buffer.data(), length, offset / XTS_SECTOR_SIZE );
+                } else {
+                    xts_ctx.decrypt( buffer.data(), length, offset / XTS_SECTOR_SIZE );
+                }
+
+                if ( !pwrite_fully( out_fd, buffer.data(), length, offset ) ) {
+                    throw "pwrite() failed";
+                }
+            }
+
+        } catch ( char const* const error ) {
+            // stop the other workers
+            next_chunk = chunks;
+            std::cerr << "ERROR: failed to " << ( encrypt ? "encrypt" : "decrypt" ) << " '" << input_path << "' into '" << output_path << "' (" << error << ")" << std::endl;
+            return false;
+        }
+
+        return true;
+    } );
+
+    // close the files and report any deferred write errors
+    if ( close( out_fd ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << output_path << "'" << std::endl;
+        status = false;
+    }
+
+    close( in_fd );
+
+    return status;
+}
+
+bool xts_write_sectors( unsigned char const* key, char const* image_path, uint64_t first_sector, char const* plaintext_path )
+{
+    // open the files and get their sizes
+    int const image_fd = open( image_path, O_RDWR | O_CLOEXEC );
+
+    if ( image_fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << image_path << "'" << std::endl;
+        return false;
+    }
+
+    int const plaintext_fd = open( plaintext_path, O_RDONLY | O_CLOEXEC );
+
+    if ( plaintext_fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << plaintext_path << "'" << std::endl;
+        close( image_fd );
+        return false;
+    }
+
+    struct stat image_st;
+    struct stat plaintext_st;
+
+    if ( fstat( image_fd, &image_st ) != 0 || fstat( plaintext_fd, &plaintext_st ) != 0 ) {
+        std::cerr << "ERROR: failed to read from files '" << image_path << "' and '" << plaintext_path << "'" << std::endl;
+        close( plaintext_fd );
+        close( image_fd );
+        return false;
+    }
+
+    uint64_t const image_size = static_cast<uint64_t>( image_st.st_size );
+    uint64_t const length = static_cast<uint64_t>( plaintext_st.st_size );
+
+    // the write may start at the end of the image to append sectors but may not leave a gap
+    if ( first_sector > image_size / XTS_SECTOR_SIZE ) {
+        std::cerr << "ERROR: invalid sector (" << first_sector << " > " << image_size / XTS_SECTOR_SIZE << ")" << std::endl;
+        close( plaintext_fd );
+        close( image_fd );
+        return false;
+    }
+
+    uint64_t const offset = first_sector * XTS_SECTOR_SIZE;
+
+    // only the last sector of the image may be partial
+    if ( ( offset + length < image_size && length % XTS_SECTOR_SIZE != 0 ) || !is_valid_image_size( length ) ) {
+        std::cerr << "ERROR: invalid plaintext size (" << length << " is not whole sectors of " << XTS_SECTOR_SIZE
+                  << " bytes or a final sector of at least " << AES_BLOCK_SIZE << ")" << std::endl;
+        close( plaintext_fd );
+        close( image_fd );
+        return false;
+    }
+
+    bool status = true;
+
+    try {
+        xts_sectors xts_ctx( key );
+
+        std::vector<unsigned char> buffer( static_cast<size_t>( std::min<uint64_t>( XTS_CHUNK_SIZE, length ) ) );
+
+        // encrypt the plaintext over the sectors it replaces
+        for ( uint64_t position = 0 ; position < length ; position += buffer.size() ) {
+
+            size_t const chunk = static_cast<size_t>( std::min<uint64_t>( buffer.size(), length - position ) );
+            auto const chunk_read = pread_fully( plaintext_fd, buffer.data(), chunk, position );
+
+            if ( !chunk_read.first || chunk_read.second != chunk ) {
+                throw "pread() failed";
+            }
+
+            xts_ctx.encrypt( buffer.data(), chunk, first_sector + position / XTS_SECTOR_SIZE );
+
+            if ( !pwrite_fully( image_fd, buffer.data(), chunk, offset + position ) ) {
+                throw "pwrite() failed";
+            }
+        }
+
+    } catch ( char const* const error ) {
+        std::cerr << "ERROR: failed to write '" << plaintext_path << "' into '" << image_path << "' (" << error << ")" << std::endl;
+        status = false;
+    }
+
+    // close the files and report any deferred write errors
+    if ( close( image_fd ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << image_path << "'" << std::endl;
+        status = false;
+    }
+
+    close( plaintext_fd );
+
+    return status;
+}
+
+bool xts_read_sectors( unsigned char const* key, char const* image_path, uint64_t first_sector, uint64_t count, char const* plaintext_path )
+{
+    // open the image for positioned reads and get its size
+    int const fd = open( image_path, O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 ) {
+        std::cerr << "ERROR: failed to open file '" << image_path << "'" << std::endl;
+        return false;
+    }
+
+    struct stat st;
+
+    if ( fstat( fd, &st ) != 0 ) {
+        std::cerr << "ERROR: failed to read from file '" << image_path << "'" << std::endl;
+        close( fd );
+        return false;
+    }
+
+    uint64_t const image_size = static_cast<uint64_t>( st.st_size );
+    uint64_t const sector_count = get_sector_count( image_size );
+
+    // verify the sectors lie within the image
+    if ( first_sector > sector_count || count > sector_count - first_sector ) {
+        std::cerr << "ERROR: invalid sector range (" << first_sector << " + " << count << " > " << sector_count << ")" << std::endl;
+        close( fd );
+        return false;
+    }
+
+    FILE* const os = fopen( plaintext_path, "wb" );
+
+    if ( !os ) {
+        std::cerr << "ERROR: failed to open file '" << plaintext_path << "'" << std::endl;
+        close( fd );
+        return false;
+    }
+
+    uint64_t const offset = first_sector * XTS_SECTOR_SIZE;
+    uint64_t const end = std::min( image_size, ( first_sector + count ) * XTS_SECTOR_SIZE );
+
+    bool status = true;
+
+    try {
+        xts_sectors xts_ctx( key );
+
+        std::vector<unsigned char> buffer( static_cast<size_t>( std::min<uint64_t>( XTS_CHUNK_SIZE, end - offset ) ) );
+
+        // decrypt the requested sectors a chunk at a time
+        for ( uint64_t position = offset ; position < end ; position += buffer.size() ) {
+
+            size_t const chunk = static_cast<size_t>( std::min<uint64_t>( buffer.size(), end - position ) );
+            auto const chunk_read = pread_fully( fd, buffer.data(), chunk, position );
+
+            if ( !chunk_read.first || chunk_read.second != chunk ) {
+                throw "pread() failed";
+            }
+
+            xts_ctx.decrypt( buffer.data(), chunk, position / XTS_SECTOR_SIZE );
+
+            if ( 1 != fwrite( buffer.data(), chunk, 1, os ) ) {
+                throw "fwrite() failed";
+            }
+        }
+
+    } catch ( char const* const error ) {
+        std::cerr << "ERROR: failed to read sectors of '" << image_path << "' into '" << plaintext_path << "' (" << error << ")" << std::endl;
+        status = false;
+    }
+
+    // close the files and report any deferred write errors
+    if ( fclose( os ) != 0 && status ) {
+        std::cerr << "ERROR: failed to write to file '" << plaintext_path << "'" << std::endl;
+        status = false;
+    }
+
+    close( fd );
+
+    return status;
+}
@@ -0,0 +1,118 @@
+#ifndef XTS_H
+#define XTS_H
+
+#include <openssl/evp.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief size of a data unit; every sector is encrypted on its own with its number as the tweak
+ */
+constexpr size_t XTS_SECTOR_SIZE = 4096;
+
+/**
+ * @brief size of an aes-256-xts key; the data key followed by the tweak key
+ */
+constexpr size_t XTS_KEY_SIZE = 64;
+
+/**
+ * @brief number of sectors a worker reads, encrypts, and writes at a time
+ */
+constexpr size_t XTS_SECTORS_PER_CHUNK = 256;
+
+/**
+ * @brief aes-256-xts over consecutive sectors of a buffer, in place
+ *
+ * The output has the length of the input. Each sector is tweaked with its sector number as a
+ * 128-bit little endian value, as in IEEE 1619 and the plain64 mode of dm-crypt, so any sector
+ * can be encrypted or decrypted without the others. The last sector of an image may be shorter
+ * than XTS_SECTOR_SIZE and is handled with ciphertext stealing, but must hold at least one block.
+ */
+class xts_sectors
+{
+
+public:
+
+    xts_sectors() = delete;
+
+    /**
+     * @brief expand a key for both directions
+     *
+     * @param key XTS_KEY_SIZE byte key; the two halves must differ
+     */
+    explicit xts_sectors( unsigned char const* key );
+
+    ~xts_sectors();
+
+    xts_sectors( xts_sectors const& ) = delete;
+
+    xts_sectors& operator=( xts_sectors const& ) = delete;
+
+    /**
+     * @brief encrypt sectors in place
+     *
+     * @param data sectors; whole sectors except a last one of at least AES_BLOCK_SIZE bytes
+     * @param length size of the data in bytes
+     * @param first_sector sector number of the first sector in the data
+     */
+    void encrypt( unsigned char* data, size_t length, uint64_t first_sector );
+
+    /**
+     * @brief decrypt sectors in place
+     *
+     * @param data sectors; whole sectors except a last one of at least AES_BLOCK_SIZE bytes
+     * @param length size of the data in bytes
+     * @param first_sector sector number of the first sector in the data
+     */
+    void decrypt( unsigned char* data, size_t length, uint64_t first_sector );
+
+private:
+    EVP_CIPHER_CTX* const e_ctx;
+    EVP_CIPHER_CTX* const d_ctx;
+
+};
+
+/**
+ * @brief encrypt or decrypt a whole image sector by sector
+ *
+ * Chunks of sectors are processed on worker threads with positioned reads and writes, so memory
+ * use stays at one chunk per thread. The image is rewritten in place if both paths name the same file.
+ *
+ * @param encrypt true for encryption; false for decryption
+ * @param key XTS_KEY_SIZE byte key
+ * @param input_path path of the input image
+ * @param output_path path of the output image; may be the input
+ * @param threads number of worker threads
+ *
+ * @return true if successful; false otherwise;
+ */
+bool xts_crypt_file( bool encrypt, unsigned char const* key, char const* input_path, char const* output_path, unsigned int threads );
+
+/**
+ * @brief encrypt plaintext into sectors of an encrypted image in place, leaving every other sector untouched
+ *
+ * The plaintext must be whole sectors unless it reaches the end of the image, which then ends with it.
+ *
+ * @param key XTS_KEY_SIZE byte key
+ * @param image_path path of the encrypted image
+ * @param first_sector number of the first sector to overwrite; at most the number of sectors in the image
+ * @param plaintext_path path of the plaintext file
+ *
+ * @return true if successful; false otherwise;
+ */
+bool xts_write_sectors( unsigned char const* key, char const* image_path, uint64_t first_sector, char const* plaintext_path );
+
+/**
+ * @brief decrypt sectors of an encrypted image without reading the others
+ *
+ * @param key XTS_KEY_SIZE byte key
+ * @param image_path path of the encrypted image
+ * @param first_sector number of the first sector to decrypt
+ * @param count number of sectors to decrypt; the last sector of the image may be partial
+ * @param plaintext_path path of the plaintext file
+ *
+ * @return true if successful; false otherwise;
+ */
+bool xts_read_sectors( unsigned char const* key, char const* image_path, uint64_t first_sector, uint64_t count, char const* plaintext_path );
+
+#endif // XTS_H
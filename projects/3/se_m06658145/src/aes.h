@@ -3,11 +3,33 @@
 
 #include <openssl/aes.h>
 #include <openssl/evp.h>
+#include <stddef.h>
 #include <vector>
 
 constexpr int const IV_SIZE = 16;
 constexpr int const KEY_SIZE = 32;
 
+/**
+ * @brief non-owning view of a writable byte buffer
+ */
+struct byte_span {
+    unsigned char* data;
+    size_t size;
+};
+
+/**
+ * @brief get the buffer size that holds an iv prefix and the encryption of a message
+ *
+ * @param iv_size size of the iv prefix
+ * @param len size of the message
+ *
+ * @return number of bytes needed for the iv and the padded ciphertext
+ */
+inline size_t ciphertext_capacity( size_t iv_size, size_t len )
+{
+    return iv_size + len + AES_BLOCK_SIZE;
+}
+
 class aes
 {
 
@@ -16,20 +38,23 @@ public:
     aes() = delete;
 
     inline aes( EVP_CIPHER const* const mode, unsigned char const* const key, unsigned char const* const iv )
-        : e_ctx()
-        , d_ctx()
+        : e_ctx( EVP_CIPHER_CTX_new() )
+        , d_ctx( EVP_CIPHER_CTX_new() )
         , _key( key )
         , _iv( iv )
         , _mode( mode )
     {
-        EVP_CIPHER_CTX_init( &e_ctx );
-        EVP_CIPHER_CTX_init( &d_ctx );
+        if ( !e_ctx || !d_ctx ) {
+            EVP_CIPHER_CTX_free( e_ctx );
+            EVP_CIPHER_CTX_free( d_ctx );
+            throw "EVP_CIPHER_CTX_new() failed";
+        }
     }
 
     inline ~aes()
     {
-        if ( EVP_CIPHER_CTX_cleanup( &e_ctx ) != 1 ) { }
-        if ( EVP_CIPHER_CTX_cleanup( &d_ctx ) != 1 ) { }
+        EVP_CIPHER_CTX_free( e_ctx );
+        EVP_CIPHER_CTX_free( d_ctx );
     }
 
     aes( aes const& ) = delete;
@@ -40,61 +65,91 @@ public:
 
     aes& operator=( aes&& ) = delete;
 
-    inline std::vector<unsigned char> decrypt( unsigned char const* const ciphertext, int const ciphertext_len )
+    /**
+     * @brief decrypt into a caller provided buffer and remove the padding added by encrypt()
+     *
+     * @param plaintext output; must hold ciphertext_len bytes; may be the ciphertext itself
+     * @param ciphertext ciphertext
+     * @param ciphertext_len size of the ciphertext in bytes
+     *
+     * @return number of plaintext bytes written, excluding the padding
+     */
+    inline size_t decrypt( byte_span const plaintext, unsigned char const* const ciphertext, int const ciphertext_len )
     {
+        if ( plaintext.size < static_cast<size_t>( ciphertext_len ) ) {
+            throw "output buffer too small";
+        }
 
-        if ( EVP_DecryptInit_ex( &d_ctx, _mode, NULL, _key, _iv ) != 1 ) {
+        if ( EVP_DecryptInit_ex( d_ctx, _mode, NULL, _key, _iv ) != 1 ) {
             throw "EVP_DecryptInit_ex() failed";
         }
 
-        EVP_CIPHER_CTX_set_padding( &d_ctx, 0 );
-
-        std::vector<unsigned char> plaintext( ciphertext_len );
-
         int len;
 
-        EVP_DecryptUpdate( &d_ctx, plaintext.data(), &len, ciphertext, ciphertext_len );
+        EVP_DecryptUpdate( d_ctx, plaintext.data, &len, ciphertext, ciphertext_len );
 
         int plaintext_len = len;
 
-        if ( EVP_DecryptFinal_ex( &d_ctx, plaintext.data() + len, &len ) != 1 ) {
+        if ( EVP_DecryptFinal_ex( d_ctx, plaintext.data + len, &len ) != 1 ) {
             throw "EVP_DecryptFinal_ex() failed";
         }
 
-        plaintext_len += len;
+        return plaintext_len + len;
+    }
 
-        plaintext.resize( plaintext_len );
+    inline std::vector<unsigned char> decrypt( unsigned char const* const ciphertext, int const ciphertext_len )
+    {
+        std::vector<unsigned char> plaintext( ciphertext_len );
+
+        plaintext.resize( decrypt( byte_span{ plaintext.data(), plaintext.size() }, ciphertext, ciphertext_len ) );
 
         return plaintext;
     }
 
-    inline std::vector<unsigned char> encrypt( unsigned char const* const plaintext, int const len )
+    /**
+     * @brief encrypt into a caller provided buffer
+     *
+     * @param ciphertext output; must hold len + AES_BLOCK_SIZE bytes; may start at the plaintext itself
+     * @param plaintext plaintext
+     * @param len size of the plaintext in bytes
+     *
+     * @return number of ciphertext bytes written
+     */
+    inline size_t encrypt( byte_span const ciphertext, unsigned char const* const plaintext, int const len )
     {
+        if ( ciphertext.size < ciphertext_capacity( 0, len ) ) {
+            throw "output buffer too small";
+        }
 
-        if ( EVP_EncryptInit_ex( &e_ctx, _mode, NULL, _key, _iv ) != 1 ) {
+        if ( EVP_EncryptInit_ex( e_ctx, _mode, NULL, _key, _iv ) != 1 ) {
             throw "EVP_EncryptInit_ex() failed";
         }
 
-        int c_len = len + AES_BLOCK_SIZE;
-
-        std::vector<unsigned char> ciphertext( c_len );
+        int c_len = 0;
 
-        EVP_EncryptUpdate( &e_ctx, ciphertext.data(), &c_len, plaintext, len );
+        EVP_EncryptUpdate( e_ctx, ciphertext.data, &c_len, plaintext, len );
 
         int f_len = 0;
 
-        if ( EVP_EncryptFinal_ex( &e_ctx, ciphertext.data() + c_len, &f_len ) != 1 ) {
+        if ( EVP_EncryptFinal_ex( e_ctx, ciphertext.data + c_len, &f_len ) != 1 ) {
             throw "EVP_EncryptFinal_ex() failed";
         }
 
-        ciphertext.resize( c_len + f_len );
+        return c_len + f_len;
+    }
+
+    inline std::vector<unsigned char> encrypt( unsigned char const* const plaintext, int const len )
+    {
+        std::vector<unsigned char> ciphertext( ciphertext_capacity( 0, len ) );
+
+        ciphertext.resize( encrypt( byte_span{ ciphertext.data(), ciphertext.size() }, plaintext, len ) );
 
         return ciphertext;
     }
 
 private:
-    EVP_CIPHER_CTX e_ctx;
-    EVP_CIPHER_CTX d_ctx;
+    EVP_CIPHER_CTX* const e_ctx;
+    EVP_CIPHER_CTX* const d_ctx;
     unsigned char const* const _key;
     unsigned char const* const _iv;
     EVP_CIPHER const* const _mode;
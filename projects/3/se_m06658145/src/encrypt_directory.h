@@ -80,16 +80,18 @@ inline int encrypt_directory(
             continue;
         }
 
-        // read plaintext data from file
-        auto const plaintext_file_data = read_file( file->path().c_str() );
+        // read plaintext data from file behind a slot for the iv and ahead of room for padding
+        auto plaintext_file_data = read_file( file->path().c_str(), IV_SIZE, AES_BLOCK_SIZE );
 
         // verify read was successful
         if ( !plaintext_file_data.first ) {
             return EXIT_FAILURE;
         }
 
-        // create an alias for the plaintext data
-        auto const& plaintext = plaintext_file_data.second;
+        // create an alias for the file buffer and get the bounds of the plaintext in it
+        auto& buffer = plaintext_file_data.second;
+        auto const plaintext_begin = buffer.begin() + IV_SIZE;
+        auto const plaintext_end = buffer.end() - AES_BLOCK_SIZE;
 
         // create an array of whitespace delimiter characters
         constexpr std::array<unsigned char, 4> const delimiters{ { ' ', '\n', '\r', '\t' } };
@@ -107,35 +109,35 @@ inline int encrypt_directory(
         // for each token
         for (
             // find first non-delimiter character in plaintext
-            auto token_begin = std::find_if( plaintext.begin(), plaintext.end(), is_not_delimiter ),
+            auto token_begin = std::find_if( plaintext_begin, plaintext_end, is_not_delimiter ),
             // find first delimiter character after non-delimiter
-            token_end = std::find_if( token_begin, plaintext.end(), is_delimiter );
+            token_end = std::find_if( token_begin, plaintext_end, is_delimiter );
             // search entire plaintext
-            token_begin != plaintext.end();
+            token_begin != plaintext_end;
             // find first non-delimiter character after previous token
-            token_begin = std::find_if( token_end, plaintext.end(), is_not_delimiter ),
+            token_begin = std::find_if( token_end, plaintext_end, is_not_delimiter ),
             // find first delimiter character after new token
-            token_end = std::find_if( token_begin, plaintext.end(), is_delimiter )
+            token_end = std::find_if( token_begin, plaintext_end, is_delimiter )
         ) {
             // add the ciphertext and file name to an index data structure
             index.emplace(
                 std::make_pair( prf( prf_key.data(), &*token_begin, token_end - token_begin  ), output_file_path ) );
         }
 
-        // generate a random 128-bit initialization vector (IV)
+        // generate a random 128-bit initialization vector (IV) and store it in its slot
         auto const iv { keygen( IV_SIZE ) };
+        std::copy( iv.begin(), iv.end(), buffer.begin() );
 
         // create an aes crypto context
         aes aes_ctx( EVP_aes_256_cbc(), aes_key.data(), iv.data() );
 
-        // perform aes encryption
-        auto ciphertext( aes_ctx.encrypt( plaintext.data(), plaintext.size() ) );
+        // perform aes encryption in place behind the iv
+        unsigned char* const plaintext = buffer.data() + IV_SIZE;
+        size_t const ciphertext_size = aes_ctx.encrypt(
+            byte_span{ plaintext, buffer.size() - IV_SIZE }, plaintext, plaintext_end - plaintext_begin );
 
-        // prepend the iv to the ciphertext
-        ciphertext.insert( ciphertext.begin(), iv.begin(), iv.end() );
-
-        // write ciphertext to output file
-        if ( !write_file( output_file_path.c_str(), ciphertext ) ) {
+        // write iv and ciphertext to output file
+        if ( !write_file( output_file_path.c_str(), buffer.data(), IV_SIZE + ciphertext_size ) ) {
             return EXIT_FAILURE;
         }
     }
@@ -19,8 +19,11 @@ inline std::array<unsigned char, 16> prf( unsigned char const* key, unsigned cha
     // create an aes crypto context for prf
     aes aes_ctx( EVP_aes_256_ecb(), key, nullptr );
 
+    // ecb encrypts each block on its own; only the first block survives the truncation below
+    std::array<unsigned char, 2 * AES_BLOCK_SIZE> prf_token;
+
     // perform aes 256 ecb encryption as prf
-    auto const prf_token( aes_ctx.encrypt( data, size ) );
+    aes_ctx.encrypt( byte_span{ prf_token.data(), prf_token.size() }, data, std::min<size_t>( size, AES_BLOCK_SIZE ) );
 
     // truncate the prf token to a fixed length of 16 bytes
     std::array<unsigned char, 16> prf_token_truncated;
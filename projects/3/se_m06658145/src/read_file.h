@@ -10,10 +10,12 @@
  * @brief read entire binary file
  *
  * @param path path of file to be read
+ * @param prefix number of bytes reserved before the file data
+ * @param slack number of bytes reserved after the file data
  *
- * @return true and vector of bytes if successful; false otherwise;
+ * @return true and vector of prefix, file data, and slack bytes if successful; false otherwise;
  */
-inline std::pair<bool, std::vector<unsigned char>> read_file( char const* const path )
+inline std::pair<bool, std::vector<unsigned char>> read_file( char const* const path, size_t const prefix = 0, size_t const slack = 0 )
 {
     // open file
     FILE* const is = fopen( path, "rb" );
@@ -29,11 +31,11 @@ inline std::pair<bool, std::vector<unsigned char>> read_file( char const* const
     size_t const file_size = ftell( is );
     fseek( is, 0, SEEK_SET );
 
-    // create a vector to hold the file data
-    std::vector<unsigned char> data( file_size );
+    // create a vector to hold the file data and the reserved bytes
+    std::vector<unsigned char> data( prefix + file_size + slack );
 
     // read from file
-    if ( 1 != fread( data.data(), file_size, 1, is ) ) {
+    if ( 1 != fread( data.data() + prefix, file_size, 1, is ) ) {
         fclose( is );
         std::cerr << "ERROR: failed to read from file '" << path << "'" << std::endl;
         return std::make_pair( false, std::vector<unsigned char> {} );
@@ -102,7 +102,7 @@ inline int search_token(
         output << file << ": ";
 
         // read encrypted file
-        auto const read_operation = read_file( file.c_str() );
+        auto read_operation = read_file( file.c_str() );
 
         // verify file read status
         if ( !read_operation.first ) {
@@ -110,7 +110,7 @@ inline int search_token(
         }
 
         // create an alias for the encrypted file data
-        auto const& file_data = read_operation.second;
+        auto& file_data = read_operation.second;
 
         // verify that the file data contains enough data for the iv
         if ( file_data.size() < IV_SIZE ) {
@@ -121,11 +121,20 @@ inline int search_token(
         // create an aes crypto context
         aes ctx{ EVP_aes_256_cbc(), aes_key.data(), file_data.data() };
 
-        // decrypt file data
-        auto const decrypted_data{ ctx.decrypt( file_data.data() + IV_SIZE, file_data.size() - IV_SIZE ) };
+        // decrypt file data in place behind the iv; the padding is not part of the output
+        unsigned char* const decrypted_data = file_data.data() + IV_SIZE;
+        size_t decrypted_size = 0;
 
-        // output decrypted file to cout
-        output << (char const*) decrypted_data.data() << "\n";
+        try {
+            decrypted_size = ctx.decrypt(
+                byte_span{ decrypted_data, file_data.size() - IV_SIZE }, decrypted_data, file_data.size() - IV_SIZE );
+        } catch ( char const* const error ) {
+            output << "DECRYPTION FAILED (" << error << ")" << std::endl;
+            continue;
+        }
+
+        // output decrypted file to cout; the file data is not null terminated
+        output.write( reinterpret_cast<char const*>( decrypted_data ), decrypted_size ) << "\n";
     }
 
     return EXIT_SUCCESS;
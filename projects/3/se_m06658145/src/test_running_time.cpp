@@ -1,6 +1,7 @@
 #include "add_token_to_file.h"
 #include "encrypt_directory.h"
 #include "keygen_to_file.h"
+#include "perf_counters.h"
 #include "search_token.h"
 #include <algorithm>
 #include <chrono>
@@ -70,19 +71,86 @@ static void output_stats( std::vector<std::chrono::high_resolution_clock::durati
     std::cout << std::endl;
 }
 
+/**
+ * @brief output hardware counter totals per iteration and per byte
+ *
+ * @param counters counters stopped after the measured iterations
+ * @param iterations number of measured iterations
+ * @param bytes bytes processed per iteration; zero to omit the per byte ratios
+ */
+static void output_counters( perf_counters const& counters, unsigned int const iterations, size_t const bytes )
+{
+    if ( !counters.any_available() ) {
+        std::cout << "hardware counters unavailable (" << counters.error() << ")\n" << std::endl;
+        return;
+    }
+
+    const auto flags = std::cout.flags();
+    const auto precision = std::cout.precision( 2 );
+
+    std::cout << std::fixed;
+    std::cout << "hardware counter results" << ( bytes ? " (per iteration | per byte)\n" : " (per iteration)\n" );
+
+    // output a count per iteration and per byte
+    auto const output = [&]( char const* const name, perf_counter const counter ) {
+        const double count = counters.value( counter );
+
+        std::cout << " " << name << " = ";
+
+        if ( count < 0 ) {
+            std::cout << std::setw( 12 ) << "unavailable" << "\n";
+            return;
+        }
+
+        std::cout << std::setw( 12 ) << count / iterations;
+
+        if ( bytes ) {
+            std::cout << " | " << std::setw( 10 ) << std::setprecision( 4 ) << count / iterations / bytes << std::setprecision( 2 );
+        }
+
+        std::cout << "\n";
+    };
+
+    output( "cycles           ", perf_counter::CYCLES );
+    output( "instructions     ", perf_counter::INSTRUCTIONS );
+    output( "cache misses     ", perf_counter::CACHE_MISSES );
+    output( "branch misses    ", perf_counter::BRANCH_MISSES );
+    output( "LLC load misses  ", perf_counter::LLC_LOAD_MISSES );
+
+    // instructions per cycle
+    const double cycles = counters.value( perf_counter::CYCLES );
+    const double instructions = counters.value( perf_counter::INSTRUCTIONS );
+
+    if ( cycles > 0 && instructions >= 0 ) {
+        std::cout << " IPC               = " << std::setw( 12 ) << instructions / cycles << "\n";
+    }
+
+    std::cout << std::endl;
+
+    std::cout.flags( flags );
+    std::cout.precision( precision );
+}
+
 /**
  * @brief Runs a functor object the given number of iterations, tracks elapsed runtime, and outputs statistics
  *
+ * Hardware counters are collected over all iterations.
+ *
  * @tparam T type of functor object
  * @param iterations number of iterations
  * @param f functor object to be timed
+ * @param bytes bytes processed per iteration; zero to omit the per byte counter ratios
  */
 template<class T>
-static void test_running_time( unsigned int const iterations, T const& f )
+static void test_running_time( unsigned int const iterations, T const& f, size_t const bytes = 0 )
 {
     // allocate an array with an element for each test run
     std::vector<std::chrono::high_resolution_clock::duration> results( iterations );
 
+    // count hardware events across the runs
+    perf_counters counters;
+    counters.start();
+
     // run the test repeatedly
     for ( unsigned int i = 0 ; i < iterations ; ++i ) {
 
@@ -103,8 +171,11 @@ static void test_running_time( unsigned int const iterations, T const& f )
 
     }
 
+    counters.stop();
+
     // calculate and output statistics for our test iterations
     output_stats( results );
+    output_counters( counters, iterations, bytes );
 }
 
 void test_search_time(
@@ -131,6 +202,70 @@ void test_search_time(
     );
 }
 
+/**
+ * @brief verify that search outputs every matching file exactly as its plaintext
+ *
+ * @param index_file path to index file
+ * @param token_file path to token file
+ * @param plaintext_dir path to the plaintext directory that was encrypted
+ * @param ciphertext_dir path to ciphertext directory
+ * @param aes_key_file path to the aes key file
+ *
+ * @return true if the output of every matching file equals its plaintext; false otherwise;
+ */
+bool test_search_output(
+    char const* const index_file,
+    char const* const token_file,
+    char const* const plaintext_dir,
+    char const* const ciphertext_dir,
+    char const* const aes_key_file )
+{
+    std::cout << "running encrypted index search output test" << std::endl;
+
+    // run the search
+    std::ostringstream oss;
+
+    if ( EXIT_SUCCESS != search_token( index_file, token_file, ciphertext_dir, aes_key_file, oss ) ) {
+        std::cout << " FAILED (search failed)\n" << std::endl;
+        return false;
+    }
+
+    std::string const output = oss.str();
+    unsigned int matches = 0;
+
+    for ( auto&& file : boost::filesystem::directory_iterator( plaintext_dir ) ) {
+
+        // get the name search outputs before the file data
+        std::ostringstream name;
+        name << boost::filesystem::path( ciphertext_dir ) / file.path().filename() << ": ";
+
+        // skip files that do not contain the token
+        if ( output.find( name.str() ) == std::string::npos ) {
+            continue;
+        }
+
+        auto const plaintext = read_file( file.path().c_str() );
+
+        // the file data must follow its name exactly, without padding
+        std::string const expected = name.str() + std::string( plaintext.second.begin(), plaintext.second.end() ) + "\n";
+
+        if ( !plaintext.first || output.find( expected ) == std::string::npos ) {
+            std::cout << " FAILED (" << file.path().filename() << " does not match its plaintext)\n" << std::endl;
+            return false;
+        }
+
+        ++matches;
+    }
+
+    if ( matches == 0 ) {
+        std::cout << " FAILED (no matching files)\n" << std::endl;
+        return false;
+    }
+
+    std::cout << " " << matches << " matching files equal their plaintext\n" << std::endl;
+    return true;
+}
+
 void test_encrypt_time(
     unsigned int const iterations,
     char const* const prf_key_file,
@@ -185,6 +320,11 @@ int main( int argc, const char* argv[] )
         return EXIT_FAILURE;
     }
 
+    // verify the search output before timing it
+    if ( !test_search_output( index_file, token_file, plaintext_dir, ciphertext_dir, aes_key_file ) ) {
+        return EXIT_FAILURE;
+    }
+
     // perform token search timing test
     test_search_time( ITERATIONS, index_file, token_file, ciphertext_dir, aes_key_file );
 
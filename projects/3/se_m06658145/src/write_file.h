@@ -7,14 +7,15 @@
 #include <iostream>
 
 /**
- * @brief write an array of binary data to file
+ * @brief write a range of binary data to file
  *
  * @param path path to file to be written to
- * @param data array of binary data to be written
+ * @param data binary data to be written
+ * @param size size of the data in bytes
  *
  * @return true if successful; false otherwise;
  */
-inline bool write_file( const char* path, std::vector<unsigned char> const& data )
+inline bool write_file( const char* path, unsigned char const* const data, size_t const size )
 {
     // open file
     FILE* const os = fopen( path, "wb" );
@@ -26,7 +27,7 @@ inline bool write_file( const char* path, std::vector<unsigned char> const& data
     }
 
     // write to file
-    if ( 1 != fwrite( data.data(), data.size(), 1, os ) ) {
+    if ( size > 0 && 1 != fwrite( data, size, 1, os ) ) {
         std::cerr << "ERROR: failed to write to file '" << path << "'" << std::endl;
         fclose( os );
         return false;
@@ -38,4 +39,17 @@ inline bool write_file( const char* path, std::vector<unsigned char> const& data
     return true;
 }
 
+/**
+ * @brief write an array of binary data to file
+ *
+ * @param path path to file to be written to
+ * @param data array of binary data to be written
+ *
+ * @return true if successful; false otherwise;
+ */
+inline bool write_file( const char* path, std::vector<unsigned char> const& data )
+{
+    return write_file( path, data.data(), data.size() );
+}
+
 #endif // WRITE_FILE_HPP
@@ -0,0 +1,247 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * @brief hardware events counted by perf_counters
+ */
+enum class perf_counter : unsigned int
+{
+    CYCLES,
+    INSTRUCTIONS,
+    CACHE_MISSES,
+    BRANCH_MISSES,
+    LLC_LOAD_MISSES,
+};
+
+/**
+ * @brief number of events in perf_counter
+ */
+constexpr size_t PERF_COUNTER_COUNT = 5;
+
+/**
+ * @brief hardware performance counters of the calling thread and the threads it starts
+ *
+ * Each event is opened on its own with perf_event_open() so that an event the processor or a
+ * virtual machine does not provide leaves the others usable. Only user space is counted, which
+ * an unprivileged process may do while kernel.perf_event_paranoid is at most 2. Counts are
+ * scaled up when the kernel multiplexes more events than the processor has counters for.
+ */
+class perf_counters
+{
+
+public:
+
+    /**
+     * @brief open every counter disabled; counters that cannot be opened stay unavailable
+     */
+    inline perf_counters()
+    {
+        for ( size_t i = 0 ; i < PERF_COUNTER_COUNT ; ++i ) {
+            fds[i] = open_counter( static_cast<perf_counter>( i ) );
+
+            // keep the reason the first counter failed for the report
+            if ( fds[i] < 0 && open_error == 0 ) {
+                open_error = errno;
+            }
+        }
+    }
+
+    inline ~perf_counters()
+    {
+        for ( auto const fd : fds ) {
+            if ( fd >= 0 ) {
+                close( fd );
+            }
+        }
+    }
+
+    perf_counters( perf_counters const& ) = delete;
+
+    perf_counters& operator=( perf_counters const& ) = delete;
+
+    perf_counters( perf_counters&& ) = delete;
+
+    perf_counters& operator=( perf_counters&& ) = delete;
+
+    /**
+     * @brief check whether a counter was opened
+     */
+    inline bool available( perf_counter const counter ) const
+    {
+        return fds[static_cast<size_t>( counter )] >= 0;
+    }
+
+    /**
+     * @brief check whether any counter was opened
+     */
+    inline bool any_available() const
+    {
+        for ( size_t i = 0 ; i < PERF_COUNTER_COUNT ; ++i ) {
+            if ( available( static_cast<perf_counter>( i ) ) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief get the reason the first unavailable counter could not be opened
+     *
+     * @return description of the error; empty if every counter was opened
+     */
+    inline char const* error() const
+    {
+        return open_error ? strerror( open_error ) : "";
+    }
+
+    /**
+     * @brief enable every available counter, counting from this call
+     */
+    inline void start()
+    {
+#ifdef __linux__
+        for ( size_t i = 0 ; i < PERF_COUNTER_COUNT ; ++i ) {
+            if ( fds[i] >= 0 ) {
+
+                // a reset leaves the counts inherited from exited threads, so keep the totals so far instead
+                if ( !read_totals( fds[i], baselines[i] ) ) {
+                    memset( baselines[i], 0, sizeof( baselines[i] ) );
+                }
+
+                ioctl( fds[i], PERF_EVENT_IOC_ENABLE, 0 );
+            }
+        }
+#endif
+    }
+
+    /**
+     * @brief disable every available counter, keeping the counts since start()
+     */
+    inline void stop()
+    {
+#ifdef __linux__
+        for ( auto const fd : fds ) {
+            if ( fd >= 0 ) {
+                ioctl( fd, PERF_EVENT_IOC_DISABLE, 0 );
+            }
+        }
+#endif
+    }
+
+    /**
+     * @brief get the count of an event between start() and stop()
+     *
+     * @param counter event to read
+     *
+     * @return count scaled for multiplexing; negative if the counter is unavailable or unreadable
+     */
+    inline double value( perf_counter const counter ) const
+    {
+        size_t const i = static_cast<size_t>( counter );
+        uint64_t data[3];
+
+        if ( fds[i] < 0 || !read_totals( fds[i], data ) ) {
+            return -1.0;
+        }
+
+        // take away the totals recorded by start()
+        uint64_t const count = data[0] - baselines[i][0];
+        uint64_t const enabled = data[1] - baselines[i][1];
+        uint64_t const running = data[2] - baselines[i][2];
+
+        // extrapolate from the fraction of time the event held a hardware counter
+        return running > 0 ? static_cast<double>( count ) * enabled / running : 0.0;
+    }
+
+private:
+
+    /**
+     * @brief read the totals of a counter, including threads that have exited
+     *
+     * @param fd descriptor of the counter
+     * @param data the raw count followed by the time enabled and the time running
+     *
+     * @return true if successful; false otherwise;
+     */
+    static inline bool read_totals( int const fd, uint64_t ( &data )[3] )
+    {
+        return read( fd, data, sizeof( data ) ) == static_cast<ssize_t>( sizeof( data ) );
+    }
+
+    /**
+     * @brief open one counter for the calling thread on any cpu
+     *
+     * @return descriptor of the counter; negative with errno set on failure
+     */
+    static inline int open_counter( perf_counter const counter )
+    {
+#ifdef __linux__
+        struct perf_event_attr attr;
+        memset( &attr, 0, sizeof( attr ) );
+
+        attr.size = sizeof( attr );
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        switch ( counter ) {
+
+            case perf_counter::CYCLES:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+
+            case perf_counter::INSTRUCTIONS:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+
+            case perf_counter::CACHE_MISSES:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                break;
+
+            case perf_counter::BRANCH_MISSES:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+
+            case perf_counter::LLC_LOAD_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_LL |
+                    ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+                    ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+                break;
+        }
+
+        return static_cast<int>( syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 ) );
+#else
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    int fds[PERF_COUNTER_COUNT];
+    int open_error = 0;
+
+    // totals of each counter when start() was last called
+    uint64_t baselines[PERF_COUNTER_COUNT][3] = {};
+
+};
+
+#endif // PERF_COUNTERS_H
@@ -10,16 +10,21 @@ class sha256
 public:
 
     inline sha256()
-        : ctx()
+        : ctx( EVP_MD_CTX_new() )
     {
-        if ( EVP_DigestInit_ex( &ctx, EVP_sha256(), nullptr ) != 1 ) {
+        if ( !ctx ) {
+            throw "EVP_MD_CTX_new() failed";
+        }
+
+        if ( EVP_DigestInit_ex( ctx, EVP_sha256(), nullptr ) != 1 ) {
+            EVP_MD_CTX_free( ctx );
             throw "EVP_DigestInit_ex() failed";
         }
     }
 
     inline ~sha256()
     {
-        if ( EVP_MD_CTX_cleanup( &ctx ) != 1 ) { }
+        EVP_MD_CTX_free( ctx );
     }
 
     sha256( sha256 const& ) = delete;
@@ -32,14 +37,14 @@ public:
 
     inline std::array<unsigned char, 32> hash( unsigned char const* const data, int const len )
     {
-        if ( EVP_DigestUpdate( &ctx, data, len ) != 1 ) {
+        if ( EVP_DigestUpdate( ctx, data, len ) != 1 ) {
             throw "EVP_DigestUpdate() failed";
         }
 
         std::array<unsigned char, 32> hash;
         unsigned int hash_size = sizeof( hash );
 
-        if ( EVP_DigestFinal_ex( &ctx, hash.data(), &hash_size ) != 1 ) {
+        if ( EVP_DigestFinal_ex( ctx, hash.data(), &hash_size ) != 1 ) {
             throw "EVP_DigestFinal_ex() failed";
         }
 
@@ -52,7 +57,7 @@ public:
 
 private:
 
-    EVP_MD_CTX ctx;
+    EVP_MD_CTX* const ctx;
 
 };
 
@@ -1,4 +1,5 @@
 #include "generate_solution.h"
+#include "perf_counters.h"
 #include "target_generation.h"
 #include <algorithm>
 #include <chrono>
@@ -30,19 +31,19 @@ static void output_stats( std::vector<std::chrono::high_resolution_clock::durati
     std::sort( results.begin(), results.end() );
 
     // calculate stats
-    const auto min    = std::chrono::duration_cast<std::chrono::milliseconds>( results[0] ).count();
-    const auto max    = std::chrono::duration_cast<std::chrono::milliseconds>( results[results.size() - 1] ).count();
-    const auto total  = std::chrono::duration_cast<std::chrono::milliseconds>( total_runtime ).count();
-    const auto mean   = std::chrono::duration_cast<std::chrono::milliseconds>( total_runtime / results.size() ).count();;
+    const auto min    = std::chrono::duration_cast<std::chrono::nanoseconds>( results[0] ).count();
+    const auto max    = std::chrono::duration_cast<std::chrono::nanoseconds>( results[results.size() - 1] ).count();
+    const auto total  = std::chrono::duration_cast<std::chrono::nanoseconds>( total_runtime ).count();
+    const auto mean   = std::chrono::duration_cast<std::chrono::nanoseconds>( total_runtime / results.size() ).count();;
 
     // calculate the median
-    const auto median = std::chrono::duration_cast<std::chrono::milliseconds>(
+    const auto median = std::chrono::duration_cast<std::chrono::nanoseconds>(
         ( results.size() % 1 ) ?
         results[results.size() / 2 + 1] :
         ( results[results.size() / 2] + results[results.size() / 2 + 1] ) / 2 ).count();
 
     // calculate the variance
-    const auto variance = std::chrono::duration_cast<std::chrono::milliseconds>(
+    const auto variance = std::chrono::duration_cast<std::chrono::nanoseconds>(
         std::accumulate(
             results.begin(),
             results.end(),
@@ -60,28 +61,95 @@ static void output_stats( std::vector<std::chrono::high_resolution_clock::durati
 
     // output results to the cli
     std::cout << "run time test results\n";
-    std::cout << " min run time      = " << std::setw( 10 ) << min      << " ms\n";
-    std::cout << " max run time      = " << std::setw( 10 ) << max      << " ms\n";
-    std::cout << " mean run time     = " << std::setw( 10 ) << mean     << " ms\n";
-    std::cout << " run time variance = " << std::setw( 10 ) << variance << " ms\n";
-    std::cout << " median run time   = " << std::setw( 10 ) << median   << " ms\n";
-    std::cout << " total run time    = " << std::setw( 10 ) << total    << " ms\n";
+    std::cout << " min run time      = " << std::setw( 10 ) << min      << " ns\n";
+    std::cout << " max run time      = " << std::setw( 10 ) << max      << " ns\n";
+    std::cout << " mean run time     = " << std::setw( 10 ) << mean     << " ns\n";
+    std::cout << " run time variance = " << std::setw( 10 ) << variance << " ns\n";
+    std::cout << " median run time   = " << std::setw( 10 ) << median   << " ns\n";
+    std::cout << " total run time    = " << std::setw( 10 ) << total    << " ns\n";
     std::cout << std::endl;
 }
 
+/**
+ * @brief output hardware counter totals per iteration and per byte
+ *
+ * @param counters counters stopped after the measured iterations
+ * @param iterations number of measured iterations
+ * @param bytes bytes processed per iteration; zero to omit the per byte ratios
+ */
+static void output_counters( perf_counters const& counters, unsigned int const iterations, size_t const bytes )
+{
+    if ( !counters.any_available() ) {
+        std::cout << "hardware counters unavailable (" << counters.error() << ")\n" << std::endl;
+        return;
+    }
+
+    const auto flags = std::cout.flags();
+    const auto precision = std::cout.precision( 2 );
+
+    std::cout << std::fixed;
+    std::cout << "hardware counter results" << ( bytes ? " (per iteration | per byte)\n" : " (per iteration)\n" );
+
+    // output a count per iteration and per byte
+    auto const output = [&]( char const* const name, perf_counter const counter ) {
+        const double count = counters.value( counter );
+
+        std::cout << " " << name << " = ";
+
+        if ( count < 0 ) {
+            std::cout << std::setw( 12 ) << "unavailable" << "\n";
+            return;
+        }
+
+        std::cout << std::setw( 12 ) << count / iterations;
+
+        if ( bytes ) {
+            std::cout << " | " << std::setw( 10 ) << std::setprecision( 4 ) << count / iterations / bytes << std::setprecision( 2 );
+        }
+
+        std::cout << "\n";
+    };
+
+    output( "cycles           ", perf_counter::CYCLES );
+    output( "instructions     ", perf_counter::INSTRUCTIONS );
+    output( "cache misses     ", perf_counter::CACHE_MISSES );
+    output( "branch misses    ", perf_counter::BRANCH_MISSES );
+    output( "LLC load misses  ", perf_counter::LLC_LOAD_MISSES );
+
+    // instructions per cycle
+    const double cycles = counters.value( perf_counter::CYCLES );
+    const double instructions = counters.value( perf_counter::INSTRUCTIONS );
+
+    if ( cycles > 0 && instructions >= 0 ) {
+        std::cout << " IPC               = " << std::setw( 12 ) << instructions / cycles << "\n";
+    }
+
+    std::cout << std::endl;
+
+    std::cout.flags( flags );
+    std::cout.precision( precision );
+}
+
 /**
  * @brief Runs a functor object the given number of iterations, tracks elapsed runtime, and outputs statistics
  *
+ * Hardware counters are collected over all iterations.
+ *
  * @tparam T type of functor object
  * @param iterations number of iterations
  * @param f functor object to be timed
+ * @param bytes bytes processed per iteration; zero to omit the per byte counter ratios
  */
 template<class T>
-static void test_running_time( unsigned int const iterations, T const& f )
+static void test_running_time( unsigned int const iterations, T const& f, size_t const bytes = 0 )
 {
     // allocate an array with an element for each test run
     std::vector<std::chrono::high_resolution_clock::duration> results( iterations );
 
+    // count hardware events across the runs
+    perf_counters counters;
+    counters.start();
+
     // run the test repeatedly
     for ( unsigned int i = 0 ; i < iterations ; ++i ) {
 
@@ -102,8 +170,11 @@ static void test_running_time( unsigned int const iterations, T const& f )
 
     }
 
+    counters.stop();
+
     // calculate and output statistics for our test iterations
     output_stats( results );
+    output_counters( counters, iterations, bytes );
 }
 
 void test_solution_generation_running_time(
@@ -133,6 +204,37 @@ void test_solution_generation_running_time(
     );
 }
 
+void test_hash_running_time( unsigned int const iterations, char const* const input_file_path )
+{
+    // read input from file
+    auto const input_file_data = read_file( input_file_path );
+
+    // verify read operation
+    if ( !input_file_data.first ) {
+        std::cerr << "ERROR: failed to read input file" << std::endl;
+        return;
+    }
+
+    // hash the same subject as solution generation; the input followed by a candidate solution
+    std::vector<unsigned char> subject{ input_file_data.second };
+    std::vector<unsigned char> const solution{ generate_random( subject.size() ) };
+    subject.insert( subject.end(), solution.begin(), solution.end() );
+
+    std::cout << "running hash running time test" << std::endl;
+    std::cout << " subject size = " << subject.size() << " bytes, one hash per iteration" << std::endl;
+    std::cout << std::endl;
+
+    // run test iterations
+    test_running_time(
+        iterations,
+        [&]() {
+            // hash the candidate subject
+            sha256().hash( subject.data(), subject.size() );
+        },
+        subject.size()
+    );
+}
+
 int main( int argc, const char* argv[] )
 {
     // set the number of iterations
@@ -143,6 +245,9 @@ int main( int argc, const char* argv[] )
     char const* const input_file_path    = "../data/input.txt";
     char const* const solution_file_path = "../data/solution.txt";
 
+    // measure the cost of a single hash, which solution generation repeats until it meets the target
+    test_hash_running_time( 100000, input_file_path );
+
     // run multiple iterations of the test at increasing levels of difficulty
     for ( unsigned int difficulty = 21 ; difficulty <= 26 ; ++difficulty ) {
         test_solution_generation_running_time(